@@ -14,5 +14,13 @@ CONFIG( tests ) {
         lib/lastfm/core/tests/test_libcore.pro \
         lib/lastfm/types/tests/test_libtypes.pro \
         lib/lastfm/scrobble/tests/test_libscrobble.pro \
-        lib/listener/tests/test_liblistener.pro
+        lib/listener/tests/test_liblistener.pro \
+        lib/listener/tests/test_playercommandprocessor.pro \
+        app/twiddly/tests/test_playcountsdiff.pro \
+        app/client/Bootstrapper/tests/test_itunestrackscanner.pro \
+        app/client/Bootstrapper/tests/test_uploaddevices.pro \
+        lib/unicorn/tests/test_imagedecoder.pro
+
+    unix:!mac:SUBDIRS += lib/listener/tests/test_listenerload.pro \
+                         app/client/MediaDevices/tests/test_ipodplaycountdiff.pro
 }
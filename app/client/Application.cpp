@@ -56,6 +56,7 @@
 
 #include "Dialogs/LicensesDialog.h"
 #include "MediaDevices/DeviceScrobbler.h"
+#include "Services/MetadataService.h"
 #include "Services/ScrobbleService.h"
 #include "Services/AnalyticsService.h"
 #include "Widgets/PointyArrow.h"
@@ -337,6 +338,7 @@ Application::init()
 
     connect( &ScrobbleService::instance(), SIGNAL(trackStarted(lastfm::Track,lastfm::Track)), SLOT(onTrackStarted(lastfm::Track,lastfm::Track)));
     connect( &ScrobbleService::instance(), SIGNAL(paused(bool)), SLOT(onTrackPaused(bool)));
+    connect( &ScrobbleService::instance(), SIGNAL(nextTrackChanged(lastfm::Track)), &MetadataService::instance(), SLOT(prefetch(lastfm::Track)));
 
     // clicking on a system tray message should show the scrobbler
     connect( m_tray, SIGNAL(messageClicked()), m_show_window_action, SLOT(trigger()));
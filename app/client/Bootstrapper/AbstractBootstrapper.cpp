@@ -30,7 +30,8 @@
 #include <QDir>
 #include <QTextStream>
 
-#include "zlib.h"
+#include "GzipDevice.h"
+#include "MultipartDevice.h"
 
 AbstractBootstrapper::AbstractBootstrapper( QObject* parent )
                      :QObject( parent )
@@ -46,25 +47,32 @@ AbstractBootstrapper::~AbstractBootstrapper(void)
 bool
 AbstractBootstrapper::zipFiles( const QString& inFileName, const QString& outFileName ) const
 {
-    QDir temp = QDir::temp();
-
-    temp.remove( outFileName );
-
-    gzFile outFile = gzopen( outFileName.toLocal8Bit(), "wb" );
-    if ( !outFile )
-        return false;
-
     QFile inFile( inFileName );
     if ( !inFile.open( QIODevice::ReadOnly | QIODevice::Text ) )
         return false;
 
-    if ( gzputs( outFile, inFile.readAll().data() ) < 1 )
+    QFile outFile( outFileName );
+    if ( !outFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+
+    // a chunk at a time so we never hold the whole file
+    GzipDevice gzip( &outFile );
+    if ( !gzip.open( QIODevice::WriteOnly ) )
         return false;
 
-    gzclose( outFile );
-    inFile.close();
+    QByteArray chunk;
+    while ( !( chunk = inFile.read( 64 * 1024 ) ).isEmpty() )
+    {
+        if ( gzip.write( chunk ) != chunk.size() )
+            return false;
+    }
+
+    bool const finished = gzip.finish();
+
+    // closing flushes, which is when a full disk shows up
+    outFile.close();
 
-    return true;
+    return finished && outFile.error() == QFile::NoError;
 }
 
 
@@ -95,8 +103,7 @@ AbstractBootstrapper::sendZip( const QString& inFile )
         url.addEncodedQueryItem( key, value );
     }
 
-    QFile* zipFile = new QFile( this );
-    zipFile->setFileName( inFile );
+    QFile* zipFile = new QFile( inFile );
     zipFile->open( QIODevice::ReadOnly );
 
     QNetworkRequest request( url );
@@ -104,39 +111,42 @@ AbstractBootstrapper::sendZip( const QString& inFile )
     request.setRawHeader( "Cache-Control", "no-cache" );
     request.setRawHeader( "Accept", "*/*" );
 
-    QByteArray bytes;
-    bytes.append( "--AaB03x\r\n" );
-    bytes.append( "content-disposition: " );
-    bytes.append( "form-data; name=\"agency\"\r\n" );
-    bytes.append( "\r\n" );
-    bytes.append( "0\r\n" );
-    bytes.append( "--AaB03x\r\n" );
-    bytes.append( "content-disposition: " );
-    bytes.append( "form-data; name=\"bootstrap\"; filename=\"" + zipFile->fileName() + "\"\r\n" );
-    bytes.append( "Content-Transfer-Encoding: binary\r\n" );
-    bytes.append( "\r\n" );
-
-    bytes.append( zipFile->readAll() );
-    zipFile->close();
-
-    bytes.append( "\r\n" );
-    bytes.append( "--AaB03x--" );
-    request.setHeader( QNetworkRequest::ContentLengthHeader, bytes.length() );
+    QByteArray head;
+    head.append( "--AaB03x\r\n" );
+    head.append( "content-disposition: " );
+    head.append( "form-data; name=\"agency\"\r\n" );
+    head.append( "\r\n" );
+    head.append( "0\r\n" );
+    head.append( "--AaB03x\r\n" );
+    head.append( "content-disposition: " );
+    head.append( "form-data; name=\"bootstrap\"; filename=\"" + zipFile->fileName() + "\"\r\n" );
+    head.append( "Content-Transfer-Encoding: binary\r\n" );
+    head.append( "\r\n" );
+
+    QByteArray tail;
+    tail.append( "\r\n" );
+    tail.append( "--AaB03x--" );
+
+    // the zip is read from disk as it is sent
+    MultipartDevice* body = new MultipartDevice( head, zipFile, tail, this );
+    request.setHeader( QNetworkRequest::ContentLengthHeader, body->size() );
 
     qDebug() << "Sending " << url;
 
     emit percentageUploaded( 0 );
 
-    QNetworkReply* reply = lastfm::nam()->post( request, bytes );
+    QNetworkReply* reply = lastfm::nam()->post( request, body );
     connect( reply, SIGNAL(uploadProgress(qint64,qint64)), SLOT( onUploadProgress(qint64,qint64)));
     connect( reply, SIGNAL(finished()), SLOT(onUploadDone()));
+    connect( reply, SIGNAL(finished()), body, SLOT(deleteLater()));
 }
 
 
 void
 AbstractBootstrapper::onUploadProgress( qint64 done, qint64 total )
 {
-    emit percentageUploaded( int( float(done / total) * 100.0 ) );
+    if ( total > 0 )
+        emit percentageUploaded( int( done * 100 / total ) );
 }
 
 
@@ -20,8 +20,7 @@
 
 #include "AbstractFileBootstrapper.h"
 #include <lastfm/misc.h>
-#include <QFile>
-#include <QTextStream>
+#include "GzipDevice.h"
 
 static const int k_maxPlaysPerTrack = 10000;
 static const int k_maxTotalPlays = 300000;
@@ -31,53 +30,75 @@ static const QString XML_VERSION = "1.0";
 
 AbstractFileBootstrapper::AbstractFileBootstrapper( QString product, QObject* parent )
                          : AbstractBootstrapper( parent ),
+                           m_product( product ),
+                           m_gzip( 0 ),
                            m_runningPlayCount( 0 )
 {
-    m_bootstrapElement = m_xmlDoc.createElement( "bootstrap" );
-    m_xmlDoc.appendChild( m_bootstrapElement );
-    m_bootstrapElement.setAttribute( "product", product );
-    m_bootstrapElement.setAttribute( "version", XML_VERSION );
-
-    m_savePath = lastfm::dir::runtimeData().path() + "/" +  product + "_bootstrap.xml";
+    m_savePath = lastfm::dir::runtimeData().path() + "/" +  product + "_bootstrap.xml.gz";
+    m_file.setFileName( m_savePath );
 }
 
 
 AbstractFileBootstrapper::~AbstractFileBootstrapper(void)
 {
+    closeDocument();
+}
+
+
+bool
+AbstractFileBootstrapper::startDocument()
+{
+    if ( m_gzip )
+        return true;
+
+    if ( !m_file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+
+    m_gzip = new GzipDevice( &m_file, this );
+    m_gzip->open( QIODevice::WriteOnly );
+
+    m_xml.setDevice( m_gzip );
+    m_xml.setCodec( "UTF-8" );
+    m_xml.writeStartDocument();
+    m_xml.writeStartElement( "bootstrap" );
+    m_xml.writeAttribute( "product", m_product );
+    m_xml.writeAttribute( "version", XML_VERSION );
+
+    return true;
+}
+
+
+bool
+AbstractFileBootstrapper::closeDocument()
+{
+    if ( !m_gzip )
+        return false;
+
+    m_xml.setDevice( 0 );
+
+    bool const finished = m_gzip->finish();
+    delete m_gzip;
+    m_gzip = 0;
+
+    m_file.close();
+
+    return finished && m_file.error() == QFile::NoError;
 }
 
 
-static QDomElement
-trackToDom( const Track& t, QDomDocument& d )
+static void
+writeTrack( const Track& t, QXmlStreamWriter& xml )
 {
-    QDomElement item = d.createElement( "item" );
-    QDomElement artist = d.createElement( "artist" );
-    QDomElement album = d.createElement( "album" );
-    QDomElement track = d.createElement( "track" );
-    QDomElement duration = d.createElement( "duration" );
-    QDomElement timestamp = d.createElement( "timestamp" );
-    QDomElement playcount = d.createElement( "playcount" );
-    QDomElement filename = d.createElement( "filename" );
-    QDomElement uniqueid = d.createElement( "uniqueID" );
-
-    artist.appendChild( d.createTextNode( t.artist()));
-    album.appendChild( d.createTextNode( t.album()));
-    track.appendChild( d.createTextNode( t.title()));
-    duration.appendChild( d.createTextNode( QString::number( t.duration())));
-    timestamp.appendChild( d.createTextNode( QString::number( t.timestamp().toTime_t())));
-    playcount.appendChild( d.createTextNode( t.extra( "playcount" )));
-    filename.appendChild( d.createTextNode( t.url().toString()));
-    uniqueid.appendChild( d.createTextNode( t.extra( "unique_id" )));
-    
-    item.appendChild( artist );
-    item.appendChild( album );
-    item.appendChild( track );
-    item.appendChild( duration );
-    item.appendChild( timestamp );
-    item.appendChild( playcount );
-    item.appendChild( filename );
-    item.appendChild( uniqueid );
-    return item;
+    xml.writeStartElement( "item" );
+    xml.writeTextElement( "artist", t.artist() );
+    xml.writeTextElement( "album", t.album() );
+    xml.writeTextElement( "track", t.title() );
+    xml.writeTextElement( "duration", QString::number( t.duration() ) );
+    xml.writeTextElement( "timestamp", QString::number( t.timestamp().toTime_t() ) );
+    xml.writeTextElement( "playcount", t.extra( "playcount" ) );
+    xml.writeTextElement( "filename", t.url().toString() );
+    xml.writeTextElement( "uniqueID", t.extra( "unique_id" ) );
+    xml.writeEndElement();
 }
 
 
@@ -92,11 +113,20 @@ AbstractFileBootstrapper::appendTrack(Track& track)
 //        LOGL( 2, "Playcount for bootstrap exceeded maximum allowed. Track: " <<
 //            track.playCount() << ", total: " << m_runningPlayCount );
 
+        closeDocument();
+        QFile::remove( m_savePath );
+
         emit done( Bootstrap_Spam );
         return false;
     }
-    const QDomElement& i = trackToDom( track,  m_xmlDoc );
-    m_bootstrapElement.appendChild( i );
+
+    if ( !startDocument() )
+    {
+        emit done( Bootstrap_UploadError );
+        return false;
+    }
+
+    writeTrack( track, m_xml );
     return true;
 }
 
@@ -104,19 +134,20 @@ AbstractFileBootstrapper::appendTrack(Track& track)
 void
 AbstractFileBootstrapper::zipAndSend()
 {
-    QFile file( m_savePath );
-    file.open( QIODevice::WriteOnly | QIODevice::Text );
-    QTextStream stream( &file );
-
-    stream.setCodec( "UTF-8" );
-    stream << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
-    stream << m_xmlDoc.toString();
+    if ( !startDocument() )
+    {
+        emit done( Bootstrap_UploadError );
+        return;
+    }
 
-    file.close();
+    m_xml.writeEndElement();
+    m_xml.writeEndDocument();
 
-    QString zipPath = m_savePath + ".gz";
-    zipFiles( m_savePath, zipPath );
+    if ( !closeDocument() )
+    {
+        emit done( Bootstrap_UploadError );
+        return;
+    }
 
-    sendZip( zipPath );
+    sendZip( m_savePath );
 }
-
@@ -23,6 +23,8 @@
 
 #include "AbstractBootstrapper.h"
 #include <lastfm/Track.h>
+#include <QFile>
+#include <QXmlStreamWriter>
 
 /**
   * @author Jono Cole <jono@last.fm>
@@ -33,6 +35,9 @@
   * Bootstrapping classes using this base class should call the appendTrack
   * method for each track that it has processed from the file before calling
   * the zipAndSend method to submit the bootstrap.
+  *
+  * Tracks are written straight into a gzipped file as they are appended,
+  * so memory use doesn't grow with the size of the library.
   */
 class AbstractFileBootstrapper : public AbstractBootstrapper
 {
@@ -51,10 +56,17 @@ signals:
     void trackProcessed( int percentDone, const Track track );
 
 private:
-    QDomDocument m_xmlDoc;
-    QDomElement  m_bootstrapElement;
+    bool startDocument();
+    bool closeDocument();
+
+private:
+    QString m_product;
     QString m_savePath;
 
+    QFile m_file;
+    class GzipDevice* m_gzip;
+    QXmlStreamWriter m_xml;
+
     int m_runningPlayCount;
 };
 
@@ -0,0 +1,148 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDebug>
+
+#include "zlib.h"
+
+#include "GzipDevice.h"
+
+// the compressed bytes are written to the device in chunks this big
+#define kBufferSize ( 64 * 1024 )
+
+// 15 is the largest window, adding 16 asks zlib for a gzip header and trailer
+#define kGzipWindowBits ( 15 + 16 )
+
+GzipDevice::GzipDevice( QIODevice* device, QObject* parent )
+    :QIODevice( parent ), m_device( device ), m_stream( 0 )
+{
+}
+
+GzipDevice::~GzipDevice()
+{
+    close();
+}
+
+bool
+GzipDevice::open( OpenMode mode )
+{
+    if ( mode != WriteOnly || !m_device->isWritable() )
+        return false;
+
+    m_stream = new z_stream;
+    m_stream->zalloc = Z_NULL;
+    m_stream->zfree = Z_NULL;
+    m_stream->opaque = Z_NULL;
+
+    if ( deflateInit2( m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kGzipWindowBits, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+    {
+        qWarning() << "deflateInit2 failed" << m_stream->msg;
+        delete m_stream;
+        m_stream = 0;
+        return false;
+    }
+
+    m_buffer.resize( kBufferSize );
+
+    return QIODevice::open( mode );
+}
+
+bool
+GzipDevice::finish()
+{
+    if ( !isOpen() )
+        return false;
+
+    bool const finished = deflate( Z_FINISH );
+
+    if ( !finished )
+        qWarning() << "Couldn't finish the gzip stream:" << errorString();
+
+    deflateEnd( m_stream );
+    delete m_stream;
+    m_stream = 0;
+
+    m_buffer.clear();
+
+    // closing clears the error string
+    QString const error = errorString();
+    QIODevice::close();
+
+    if ( !finished )
+        setErrorString( error );
+
+    return finished;
+}
+
+void
+GzipDevice::close()
+{
+    finish();
+}
+
+qint64
+GzipDevice::readData( char*, qint64 )
+{
+    return -1;
+}
+
+qint64
+GzipDevice::writeData( const char* data, qint64 size )
+{
+    m_stream->next_in = reinterpret_cast<Bytef*>( const_cast<char*>( data ) );
+    m_stream->avail_in = size;
+
+    if ( !deflate( Z_NO_FLUSH ) )
+        return -1;
+
+    return size;
+}
+
+bool
+GzipDevice::deflate( int flush )
+{
+    int result;
+
+    do
+    {
+        m_stream->next_out = reinterpret_cast<Bytef*>( m_buffer.data() );
+        m_stream->avail_out = m_buffer.size();
+
+        result = ::deflate( m_stream, flush );
+
+        if ( result == Z_STREAM_ERROR )
+        {
+            setErrorString( "zlib stream error" );
+            return false;
+        }
+
+        qint64 const have = m_buffer.size() - m_stream->avail_out;
+
+        if ( have && m_device->write( m_buffer.constData(), have ) != have )
+        {
+            setErrorString( m_device->errorString() );
+            return false;
+        }
+    }
+    // zlib only stops short of filling the buffer once it has taken all the
+    // input, or, when finishing, written the trailer
+    while ( m_stream->avail_out == 0 || ( flush == Z_FINISH && result != Z_STREAM_END ) );
+
+    return true;
+}
@@ -0,0 +1,62 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GZIP_DEVICE_H
+#define GZIP_DEVICE_H
+
+#include <QIODevice>
+
+/** A write-only device that gzips what is written to it into another device
+  * as it goes, so only a small buffer is ever held in memory.
+  *
+  * finish() or close() finishes the gzip stream. The other device is not
+  * closed.
+  */
+class GzipDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    /** device must already be open for writing */
+    GzipDevice( QIODevice* device, QObject* parent = 0 );
+    ~GzipDevice();
+
+    /** Only WriteOnly is supported */
+    bool open( OpenMode mode );
+
+    /** Writes the rest of the gzip stream and closes this device.
+      * @returns false if the stream couldn't be finished, see errorString() */
+    bool finish();
+    void close();
+
+    bool isSequential() const { return true; }
+
+protected:
+    qint64 readData( char* data, qint64 maxSize );
+    qint64 writeData( const char* data, qint64 size );
+
+private:
+    bool deflate( int flush );
+
+private:
+    QIODevice* m_device;
+    struct z_stream_s* m_stream;
+    QByteArray m_buffer;
+};
+
+#endif // GZIP_DEVICE_H
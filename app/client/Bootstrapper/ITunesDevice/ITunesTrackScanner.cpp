@@ -0,0 +1,179 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDateTime>
+#include <QUrl>
+
+#include "ITunesTrackScanner.h"
+
+ITunesTrackScanner::ITunesTrackScanner( QIODevice* device )
+    :m_xml( device ), m_inTracks( false ), m_finished( false )
+{
+}
+
+ITunesTrackScanner::Key
+ITunesTrackScanner::key( const QStringRef& name )
+{
+    // the length rules out all but one or two keys before comparing
+    switch ( name.size() )
+    {
+        case 4:
+            if ( name == QLatin1String( "Name" ) ) return NameKey;
+            break;
+        case 5:
+            if ( name == QLatin1String( "Album" ) ) return AlbumKey;
+            break;
+        case 6:
+            if ( name == QLatin1String( "Artist" ) ) return ArtistKey;
+            if ( name == QLatin1String( "Tracks" ) ) return TracksKey;
+            break;
+        case 8:
+            if ( name == QLatin1String( "Location" ) ) return LocationKey;
+            break;
+        case 10:
+            if ( name == QLatin1String( "Play Count" ) ) return PlayCountKey;
+            if ( name == QLatin1String( "Total Time" ) ) return TotalTimeKey;
+            break;
+        case 13:
+            if ( name == QLatin1String( "Persistent ID" ) ) return PersistentIdKey;
+            if ( name == QLatin1String( "Play Date UTC" ) ) return PlayDateUtcKey;
+            break;
+    }
+
+    return OtherKey;
+}
+
+/** Reads the key element we are on, leaving the reader on its end */
+ITunesTrackScanner::Key
+ITunesTrackScanner::readKey()
+{
+    Key k = OtherKey;
+
+    if ( m_xml.readNext() == QXmlStreamReader::Characters )
+    {
+        k = key( m_xml.text() );
+        m_xml.readNext();
+    }
+
+    // the text came in pieces, none of the keys we want do that
+    while ( !m_xml.isEndElement() && !m_xml.atEnd() )
+    {
+        k = OtherKey;
+        m_xml.readNext();
+    }
+
+    return k;
+}
+
+/** Moves the reader into the dict that follows the "Tracks" key */
+bool
+ITunesTrackScanner::findTracks()
+{
+    while ( m_xml.readNextStartElement() || !m_xml.atEnd() )
+    {
+        if ( m_xml.isStartElement() && m_xml.name() == QLatin1String( "key" ) && readKey() == TracksKey )
+        {
+            m_inTracks = m_xml.readNextStartElement() && m_xml.name() == QLatin1String( "dict" );
+            return m_inTracks;
+        }
+    }
+
+    return false;
+}
+
+Track
+ITunesTrackScanner::nextTrack()
+{
+    if ( m_finished )
+        return Track();
+
+    if ( !m_inTracks && !findTracks() )
+    {
+        m_finished = true;
+        return Track();
+    }
+
+    // The tracks dict alternates a key with the track's id and a dict of the
+    // track. We stop when we reach its end, so the playlists are left unread.
+    while ( m_xml.readNextStartElement() )
+    {
+        if ( m_xml.name() != QLatin1String( "dict" ) )
+        {
+            m_xml.skipCurrentElement();
+            continue;
+        }
+
+        Track track = readTrack();
+
+        if ( !track.isNull() && track.extra( "playcount" ).toInt() > 0 )
+            return track;
+    }
+
+    // we don't need anything after the tracks
+    m_inTracks = false;
+    m_finished = true;
+
+    return Track();
+}
+
+/** Reads the track dict we are on, leaving the reader on its end */
+Track
+ITunesTrackScanner::readTrack()
+{
+    MutableTrack track;
+
+    while ( m_xml.readNextStartElement() )
+    {
+        if ( m_xml.name() != QLatin1String( "key" ) )
+        {
+            m_xml.skipCurrentElement();
+            continue;
+        }
+
+        Key const k = readKey();
+
+        if ( !m_xml.readNextStartElement() )
+            break;
+
+        if ( k == OtherKey || k == TracksKey )
+        {
+            m_xml.skipCurrentElement();
+            continue;
+        }
+
+        QString const value = m_xml.readElementText().trimmed();
+
+        switch ( k )
+        {
+            case NameKey: track.setTitle( value ); break;
+            case ArtistKey: track.setArtist( value ); break;
+            case AlbumKey: track.setAlbum( value ); break;
+            case TotalTimeKey: track.setDuration( value.toInt() / 1000 ); break;
+            case PlayCountKey: track.setExtra( "playcount", value ); break;
+            case LocationKey: track.setUrl( QUrl( value ) ); break;
+            case PersistentIdKey: track.setExtra( "unique_id", value ); break;
+            case PlayDateUtcKey: track.setTimeStamp( QDateTime::fromString( value, Qt::ISODate ) ); break;
+            default: break;
+        }
+    }
+
+    track.setSource( Track::MediaDevice );
+
+    return track;
+}
@@ -0,0 +1,74 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITUNES_TRACK_SCANNER_H
+#define ITUNES_TRACK_SCANNER_H
+
+#include <QXmlStreamReader>
+
+#include <lastfm/Track.h>
+
+/** Pulls the played tracks out of an iTunes Music Library.xml one at a time.
+  *
+  * The library is a plist whose top level dict has a "Tracks" dict of track
+  * dicts. Only that part of the file is read, the playlists after it are
+  * never parsed. Keys are matched to a token once, without making a string,
+  * and only the values of the keys we want are read as text.
+  */
+class ITunesTrackScanner
+{
+public:
+    /** device must be open for reading and stay open while scanning */
+    ITunesTrackScanner( QIODevice* device );
+
+    /** The next track with a play count, or a null track once there are
+      * no more or the file turns out to be broken */
+    Track nextTrack();
+
+    bool hasError() const { return m_xml.hasError(); }
+    QString errorString() const { return m_xml.errorString(); }
+
+private:
+    enum Key
+    {
+        OtherKey,
+        TracksKey,
+        NameKey,
+        ArtistKey,
+        AlbumKey,
+        TotalTimeKey,
+        PlayCountKey,
+        LocationKey,
+        PersistentIdKey,
+        PlayDateUtcKey
+    };
+
+    static Key key( const QStringRef& name );
+
+    Key readKey();
+    bool findTracks();
+    Track readTrack();
+
+private:
+    QXmlStreamReader m_xml;
+    bool m_inTracks;
+    bool m_finished;
+};
+
+#endif // ITUNES_TRACK_SCANNER_H
@@ -22,7 +22,7 @@
 #include <QDir>
 #include <QSettings>
 #include "itunesdevice.h"
-#include "ITunesParser.h"
+#include "ITunesTrackScanner.h"
 
 #ifdef WIN32
     #include "windows.h"
@@ -147,11 +147,9 @@ ITunesDevice::LibraryPath()
 }
 
 ITunesDevice::ITunesDevice() :
-      m_totalSize( 0 ),
+      m_lastPercentage( -1 ),
       m_file( 0 ),
-      m_handler( 0 ),
-      m_xmlReader( 0 ),
-      m_xmlInput( 0 )
+      m_scanner( 0 )
 {
 
 }
@@ -165,25 +163,15 @@ ITunesDevice::firstTrack( const QString& file )
     if ( !m_file )
     {
         m_file = new QFile( file );
-        if ( !m_file->open( QIODevice::ReadOnly | QIODevice::Text ) )
+        if ( !m_file->open( QIODevice::ReadOnly ) )
         {
             qDebug() << "Could not open iTunes Library" << m_database;
+            delete m_file;
+            m_file = 0;
             return Track();
         }
 
-        m_totalSize = m_file->size();
-        m_xmlReader = new QXmlSimpleReader();
-        m_xmlInput = new QXmlInputSource();
-
-        m_handler = new ITunesParser();
-        m_xmlReader->setContentHandler( m_handler );
-
-        m_xmlInput->setData( m_file->read( 32768 ) );
-        if ( !m_xmlReader->parse( m_xmlInput, true ) )
-        {
-            qDebug() << "Couldn't read file: " << m_database;
-            return Track();
-        }
+        m_scanner = new ITunesTrackScanner( m_file );
     }
 
     return nextTrack();
@@ -193,29 +181,37 @@ ITunesDevice::firstTrack( const QString& file )
 Track
 ITunesDevice::nextTrack()
 {
-    while ( m_handler->trackCount() < 20 && !m_file->atEnd() )
-    {
-        m_xmlInput->setData( m_file->read( 32768 ) );
-        m_xmlReader->parseContinue();
+    if ( !m_file )
+        return Track();
 
-        emit progress( (float)( (float)m_file->pos() / (float)m_file->size() ) * 100.0, m_handler->peekTrack() );
-    }
+    Track t = m_scanner->nextTrack();
 
-    Track t = m_handler->takeTrack();
     if ( !t.isNull() )
     {
+        // only tell anyone when the percentage actually moves on
+        int const percentage = m_file->size() ? m_file->pos() * 100 / m_file->size() : 0;
+
+        if ( percentage != m_lastPercentage )
+        {
+            m_lastPercentage = percentage;
+            emit progress( percentage, t );
+        }
+
         return t;
     }
 
-    if ( m_file->atEnd() )
-    {
-        // Finished with the database, let's close our stuff
+    // Finished with the database, let's close our stuff
+    if ( m_scanner->hasError() )
+        qDebug() << "Couldn't read file: " << m_database << m_scanner->errorString();
+    else
         qDebug() << "Finished reading";
 
-        m_file->close();
-        delete m_file;
-        m_file = 0;
-    }
+    delete m_scanner;
+    m_scanner = 0;
+
+    m_file->close();
+    delete m_file;
+    m_file = 0;
 
     return Track();
 }
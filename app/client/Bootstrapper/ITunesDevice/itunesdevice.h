@@ -51,12 +51,10 @@ signals:
 private:
     QString m_iTunesLibraryPath;
     QString m_database;
-    int m_totalSize;
+    int m_lastPercentage;
 
     class QFile* m_file;
-    class ITunesParser* m_handler;
-    class QXmlSimpleReader* m_xmlReader;
-    class QXmlInputSource* m_xmlInput;
+    class ITunesTrackScanner* m_scanner;
 };
 
 #endif //ITUNES_DEVICE_H
@@ -0,0 +1,94 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+
+#include "MultipartDevice.h"
+
+MultipartDevice::MultipartDevice( const QByteArray& head, QIODevice* file, const QByteArray& tail, QObject* parent )
+    :QIODevice( parent ), m_head( head ), m_file( file ), m_tail( tail ), m_pos( 0 )
+{
+    m_file->setParent( this );
+
+    // we keep track of where we are ourselves, so no read ahead
+    QIODevice::open( ReadOnly | Unbuffered );
+}
+
+qint64
+MultipartDevice::size() const
+{
+    return m_head.size() + m_file->size() + m_tail.size();
+}
+
+bool
+MultipartDevice::seek( qint64 pos )
+{
+    if ( pos < 0 || pos > size() )
+        return false;
+
+    m_pos = pos;
+    return QIODevice::seek( pos );
+}
+
+qint64
+MultipartDevice::readData( char* data, qint64 maxSize )
+{
+    const qint64 headEnd = m_head.size();
+    const qint64 fileEnd = headEnd + m_file->size();
+    const qint64 end = fileEnd + m_tail.size();
+
+    qint64 read = 0;
+
+    while ( read < maxSize && m_pos < end )
+    {
+        qint64 n;
+
+        if ( m_pos < headEnd )
+        {
+            n = qMin( maxSize - read, headEnd - m_pos );
+            std::memcpy( data + read, m_head.constData() + m_pos, n );
+        }
+        else if ( m_pos < fileEnd )
+        {
+            if ( m_file->pos() != m_pos - headEnd && !m_file->seek( m_pos - headEnd ) )
+                return read ? read : -1;
+
+            n = m_file->read( data + read, qMin( maxSize - read, fileEnd - m_pos ) );
+
+            if ( n <= 0 )
+                return read ? read : -1;
+        }
+        else
+        {
+            n = qMin( maxSize - read, end - m_pos );
+            std::memcpy( data + read, m_tail.constData() + ( m_pos - fileEnd ), n );
+        }
+
+        read += n;
+        m_pos += n;
+    }
+
+    return read;
+}
+
+qint64
+MultipartDevice::writeData( const char*, qint64 )
+{
+    return -1;
+}
@@ -0,0 +1,54 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MULTIPART_DEVICE_H
+#define MULTIPART_DEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+/** A read-only device that is a multipart body: the head, then the contents
+  * of a file, then the tail. The file is read as the body is, so it is never
+  * all in memory. It is seekable so QNetworkAccessManager can send it as it
+  * reads it rather than buffering it first.
+  */
+class MultipartDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    /** takes ownership of file, which must be open for reading */
+    MultipartDevice( const QByteArray& head, QIODevice* file, const QByteArray& tail, QObject* parent = 0 );
+
+    bool isSequential() const { return false; }
+    qint64 size() const;
+    bool seek( qint64 pos );
+
+protected:
+    qint64 readData( char* data, qint64 maxSize );
+    qint64 writeData( const char* data, qint64 size );
+
+private:
+    QByteArray m_head;
+    QIODevice* m_file;
+    QByteArray m_tail;
+
+    qint64 m_pos;
+};
+
+#endif // MULTIPART_DEVICE_H
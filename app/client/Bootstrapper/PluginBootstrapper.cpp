@@ -129,7 +129,12 @@ PluginBootstrapper::submitBootstrap()
     QString savePath = lastfm::dir::runtimeData().filePath( lastfm::ws::Username + "_" + m_pluginId + "_bootstrap.xml" );
     QString zipPath = savePath + ".gz";
 
-    zipFiles( savePath, zipPath );
+    if ( !zipFiles( savePath, zipPath ) )
+    {
+        emit done( Bootstrap_UploadError );
+        return;
+    }
+
     sendZip( zipPath );
 }
 
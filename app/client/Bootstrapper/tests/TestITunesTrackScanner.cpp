@@ -0,0 +1,240 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+
+#include "ITunesDevice/ITunesTrackScanner.h"
+
+
+/** An iTunes Music Library.xml with count tracks, every fourth of which has
+  * never been played, followed by a playlist of all of them */
+static QByteArray
+syntheticLibrary( int count )
+{
+    QByteArray xml;
+    QTextStream s( &xml );
+    s.setCodec( "UTF-8" );
+
+    s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         "<!DOCTYPE plist PUBLIC \"-//Apple Computer//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+         "<plist version=\"1.0\">\n"
+         "<dict>\n"
+         "\t<key>Major Version</key><integer>1</integer>\n"
+         "\t<key>Minor Version</key><integer>1</integer>\n"
+         "\t<key>Application Version</key><string>10.6.3</string>\n"
+         "\t<key>Show Content Ratings</key><true/>\n"
+         "\t<key>Tracks</key>\n"
+         "\t<dict>\n";
+
+    for (int i = 0; i < count; ++i)
+    {
+        s << "\t\t<key>" << i << "</key>\n"
+             "\t\t<dict>\n"
+             "\t\t\t<key>Track ID</key><integer>" << i << "</integer>\n"
+             "\t\t\t<key>Name</key><string>Track " << i << "</string>\n"
+             "\t\t\t<key>Artist</key><string>Artist " << i % 500 << " &#38; Friends</string>\n"
+             "\t\t\t<key>Album</key><string>Album " << i % 2000 << "</string>\n"
+             "\t\t\t<key>Genre</key><string>Electronic</string>\n"
+             "\t\t\t<key>Kind</key><string>MPEG audio file</string>\n"
+             "\t\t\t<key>Size</key><integer>" << 4000000 + i << "</integer>\n"
+             "\t\t\t<key>Total Time</key><integer>" << 180000 + i % 120000 << "</integer>\n"
+             "\t\t\t<key>Date Added</key><date>2010-01-01T12:00:00Z</date>\n";
+
+        if (i % 4)
+            s << "\t\t\t<key>Play Count</key><integer>" << i % 37 + 1 << "</integer>\n"
+                 "\t\t\t<key>Play Date</key><integer>3400000000</integer>\n"
+                 "\t\t\t<key>Play Date UTC</key><date>2011-06-01T10:00:00Z</date>\n";
+
+        s << "\t\t\t<key>Compilation</key><true/>\n"
+             "\t\t\t<key>Persistent ID</key><string>" << QString::number( 0x1000000000000000ULL + i, 16 ).toUpper() << "</string>\n"
+             "\t\t\t<key>Track Type</key><string>File</string>\n"
+             "\t\t\t<key>Location</key><string>file://localhost/Users/test/Music/Track%20" << i << ".mp3</string>\n"
+             "\t\t</dict>\n";
+    }
+
+    s << "\t</dict>\n"
+         "\t<key>Playlists</key>\n"
+         "\t<array>\n"
+         "\t\t<dict>\n"
+         "\t\t\t<key>Name</key><string>Library</string>\n"
+         "\t\t\t<key>Playlist Items</key>\n"
+         "\t\t\t<array>\n";
+
+    for (int i = 0; i < count; ++i)
+        s << "\t\t\t\t<dict><key>Track ID</key><integer>" << i << "</integer></dict>\n";
+
+    s << "\t\t\t</array>\n"
+         "\t\t</dict>\n"
+         "\t</array>\n"
+         "</dict>\n"
+         "</plist>\n";
+
+    s.flush();
+    return xml;
+}
+
+
+static QList<Track>
+scan( QIODevice* device )
+{
+    QList<Track> tracks;
+    ITunesTrackScanner scanner( device );
+
+    for (Track t = scanner.nextTrack(); !t.isNull(); t = scanner.nextTrack())
+        tracks << t;
+
+    return tracks;
+}
+
+
+class TestITunesTrackScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testReadsTrack();
+    void testSkipsUnplayed();
+    void testReadsEveryField();
+    void testBrokenFile();
+
+    void benchmarkScan();
+};
+
+
+void
+TestITunesTrackScanner::testReadsTrack()
+{
+    QByteArray xml = syntheticLibrary( 2 );
+    QBuffer buffer( &xml );
+    buffer.open( QIODevice::ReadOnly );
+
+    QList<Track> tracks = scan( &buffer );
+    QCOMPARE( tracks.count(), 1 );
+
+    Track t = tracks.first();
+    QCOMPARE( t.title(), QString( "Track 1" ) );
+    QCOMPARE( t.artist().toString(), QString( "Artist 1 & Friends" ) );
+    QCOMPARE( t.album().toString(), QString( "Album 1" ) );
+    QCOMPARE( t.duration(), 180 );
+    QCOMPARE( t.extra( "playcount" ), QString( "2" ) );
+    QCOMPARE( t.extra( "unique_id" ), QString( "1000000000000001" ) );
+    QCOMPARE( t.url(), QUrl( "file://localhost/Users/test/Music/Track%201.mp3" ) );
+    QCOMPARE( t.timestamp(), QDateTime::fromString( "2011-06-01T10:00:00Z", Qt::ISODate ) );
+    QCOMPARE( t.source(), Track::MediaDevice );
+}
+
+
+void
+TestITunesTrackScanner::testSkipsUnplayed()
+{
+    QByteArray xml = syntheticLibrary( 100 );
+    QBuffer buffer( &xml );
+    buffer.open( QIODevice::ReadOnly );
+
+    QList<Track> tracks = scan( &buffer );
+    QCOMPARE( tracks.count(), 75 );
+
+    foreach (const Track& t, tracks)
+        QVERIFY( t.extra( "playcount" ).toInt() > 0 );
+}
+
+
+void
+TestITunesTrackScanner::testReadsEveryField()
+{
+    QByteArray xml = syntheticLibrary( 3000 );
+    QBuffer buffer( &xml );
+    buffer.open( QIODevice::ReadOnly );
+
+    QList<Track> tracks = scan( &buffer );
+    QCOMPARE( tracks.count(), 2250 );
+
+    // the played tracks, in library order, with what syntheticLibrary wrote
+    int n = 0;
+    for (int i = 0; i < 3000; ++i)
+    {
+        if (i % 4 == 0)
+            continue;
+
+        Track const& t = tracks[n++];
+        QCOMPARE( t.title(), QString( "Track %1" ).arg( i ) );
+        QCOMPARE( t.artist().toString(), QString( "Artist %1 & Friends" ).arg( i % 500 ) );
+        QCOMPARE( t.album().toString(), QString( "Album %1" ).arg( i % 2000 ) );
+        QCOMPARE( t.duration(), ( 180000 + i % 120000 ) / 1000 );
+        QCOMPARE( t.extra( "playcount" ), QString::number( i % 37 + 1 ) );
+        QCOMPARE( t.extra( "unique_id" ), QString::number( 0x1000000000000000ULL + i, 16 ).toUpper() );
+        QCOMPARE( t.url(), QUrl( QString( "file://localhost/Users/test/Music/Track%20%1.mp3" ).arg( i ) ) );
+        QCOMPARE( t.timestamp(), QDateTime::fromString( "2011-06-01T10:00:00Z", Qt::ISODate ) );
+    }
+}
+
+
+void
+TestITunesTrackScanner::testBrokenFile()
+{
+    QByteArray xml = syntheticLibrary( 100 );
+    xml.truncate( xml.indexOf( "<key>50</key>" ) + 3 );
+
+    QBuffer buffer( &xml );
+    buffer.open( QIODevice::ReadOnly );
+
+    ITunesTrackScanner scanner( &buffer );
+
+    int count = 0;
+    while ( !scanner.nextTrack().isNull() )
+        ++count;
+
+    // the tracks before the break still count
+    QCOMPARE( count, 37 );
+    QVERIFY( scanner.hasError() );
+    QVERIFY( scanner.nextTrack().isNull() );
+}
+
+
+/** Reads the tracks out of a 50k track library from a file, the way
+  * ITunesDevice does, and reports the throughput */
+void
+TestITunesTrackScanner::benchmarkScan()
+{
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    file.write( syntheticLibrary( 50000 ) );
+    file.seek( 0 );
+
+    QList<Track> tracks;
+    QElapsedTimer timer;
+
+    QBENCHMARK_ONCE
+    {
+        timer.start();
+        tracks = scan( &file );
+    }
+
+    qint64 const ms = qMax( timer.elapsed(), qint64( 1 ) );
+    qDebug() << file.size() / 1024 / 1024 << "MB in" << ms << "ms:"
+             << double( file.size() ) / 1024 / 1024 / ms * 1000 << "MB/s";
+
+    QCOMPARE( tracks.count(), 37500 );
+}
+
+
+QTEST_MAIN( TestITunesTrackScanner )
+#include "TestITunesTrackScanner.moc"
@@ -0,0 +1,260 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QBuffer>
+
+#include "zlib.h"
+
+#include "GzipDevice.h"
+#include "MultipartDevice.h"
+
+
+/** A bootstrap-like document big enough to take several of GzipDevice's
+  * buffers, with enough variety that it doesn't compress to nothing */
+static QByteArray
+syntheticDocument( int count )
+{
+    QByteArray xml;
+    QTextStream s( &xml );
+
+    s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<bootstrap product=\"test\" version=\"1.0\">\n";
+
+    for (int i = 0; i < count; ++i)
+        s << "<track artist=\"Artist " << i % 500 << "\" track=\"Track " << i
+          << "\" playcount=\"" << ( i * 7919 ) % 97 << "\" timestamp=\"" << 1300000000 + i * 61 << "\"/>\n";
+
+    s << "</bootstrap>\n";
+    s.flush();
+
+    return xml;
+}
+
+
+/** @returns the data in a gzip stream, or a null array if it isn't one */
+static QByteArray
+gunzip( const QByteArray& gzip )
+{
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( gzip.constData() ) );
+    stream.avail_in = gzip.size();
+
+    if ( inflateInit2( &stream, 15 + 16 ) != Z_OK )
+        return QByteArray();
+
+    QByteArray data( "" );
+    char buffer[4096];
+    int result;
+
+    do
+    {
+        stream.next_out = reinterpret_cast<Bytef*>( buffer );
+        stream.avail_out = sizeof( buffer );
+
+        result = inflate( &stream, Z_NO_FLUSH );
+
+        if ( result != Z_OK && result != Z_STREAM_END )
+            break;
+
+        data.append( buffer, sizeof( buffer ) - stream.avail_out );
+    }
+    while ( result != Z_STREAM_END );
+
+    inflateEnd( &stream );
+
+    return result == Z_STREAM_END ? data : QByteArray();
+}
+
+
+/** A device that takes limit bytes and then fails every write, like a full
+  * disk */
+class FullDevice : public QIODevice
+{
+public:
+    FullDevice( qint64 limit ) : m_limit( limit ), m_written( 0 )
+    {
+        open( WriteOnly );
+    }
+
+protected:
+    qint64 readData( char*, qint64 ) { return -1; }
+
+    qint64 writeData( const char*, qint64 size )
+    {
+        if ( m_written + size > m_limit )
+        {
+            setErrorString( "No space left on device" );
+            return -1;
+        }
+
+        m_written += size;
+        return size;
+    }
+
+private:
+    qint64 m_limit;
+    qint64 m_written;
+};
+
+
+class TestUploadDevices : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testGzipRoundTrip_data();
+    void testGzipRoundTrip();
+    void testGzipFinishFails();
+
+    void testMultipartBody();
+    void testMultipartSeek();
+};
+
+
+void
+TestUploadDevices::testGzipRoundTrip_data()
+{
+    QTest::addColumn<QByteArray>( "data" );
+    QTest::addColumn<int>( "chunkSize" );
+
+    QTest::newRow( "empty" ) << QByteArray() << 1;
+    QTest::newRow( "small" ) << syntheticDocument( 10 ) << 7;
+    QTest::newRow( "several buffers" ) << syntheticDocument( 50000 ) << 4093;
+    QTest::newRow( "one write" ) << syntheticDocument( 50000 ) << 64 * 1024 * 1024;
+}
+
+
+void
+TestUploadDevices::testGzipRoundTrip()
+{
+    QFETCH( QByteArray, data );
+    QFETCH( int, chunkSize );
+
+    QBuffer out;
+    out.open( QIODevice::WriteOnly );
+
+    GzipDevice gzip( &out );
+    QVERIFY( gzip.open( QIODevice::WriteOnly ) );
+
+    for (int i = 0; i < data.size(); i += chunkSize)
+    {
+        QByteArray const chunk = data.mid( i, chunkSize );
+        QCOMPARE( gzip.write( chunk ), qint64( chunk.size() ) );
+    }
+
+    QVERIFY( gzip.finish() );
+    QVERIFY( !gzip.isOpen() );
+
+    // the other device is left open
+    QVERIFY( out.isOpen() );
+
+    QByteArray const unzipped = gunzip( out.data() );
+    QVERIFY( !unzipped.isNull() );
+    QCOMPARE( unzipped, data );
+}
+
+
+void
+TestUploadDevices::testGzipFinishFails()
+{
+    // the header fits but the rest of the stream doesn't
+    FullDevice full( 16 );
+
+    GzipDevice gzip( &full );
+    QVERIFY( gzip.open( QIODevice::WriteOnly ) );
+
+    // small enough that zlib holds it all until the stream is finished
+    QByteArray const data = syntheticDocument( 10 );
+    QCOMPARE( gzip.write( data ), qint64( data.size() ) );
+
+    QVERIFY( !gzip.finish() );
+    QCOMPARE( gzip.errorString(), QString( "No space left on device" ) );
+    QVERIFY( !gzip.isOpen() );
+}
+
+
+void
+TestUploadDevices::testMultipartBody()
+{
+    QByteArray const head = "--AaB03x\r\n"
+                            "content-disposition: form-data; name=\"agency\"\r\n\r\n"
+                            "lastfm\r\n"
+                            "--AaB03x\r\n"
+                            "content-disposition: form-data; name=\"bootstrap\"; filename=\"bootstrap.xml.gz\"\r\n"
+                            "Content-Transfer-Encoding: binary\r\n\r\n";
+    QByteArray const tail = "\r\n--AaB03x--";
+    QByteArray const contents = syntheticDocument( 2000 );
+
+    QBuffer* file = new QBuffer;
+    file->setData( contents );
+    file->open( QIODevice::ReadOnly );
+
+    MultipartDevice body( head, file, tail );
+
+    QByteArray const expected = head + contents + tail;
+
+    QCOMPARE( body.size(), qint64( expected.size() ) );
+
+    // odd sized reads so they straddle the head, the file and the tail
+    QByteArray read;
+    QByteArray chunk;
+    while ( !( chunk = body.read( 1021 ) ).isEmpty() )
+        read += chunk;
+
+    QCOMPARE( read, expected );
+    QVERIFY( body.atEnd() );
+}
+
+
+void
+TestUploadDevices::testMultipartSeek()
+{
+    QByteArray const head = "head\r\n";
+    QByteArray const tail = "\r\ntail";
+    QByteArray const contents = syntheticDocument( 100 );
+
+    QBuffer* file = new QBuffer;
+    file->setData( contents );
+    file->open( QIODevice::ReadOnly );
+
+    MultipartDevice body( head, file, tail );
+
+    QByteArray const expected = head + contents + tail;
+
+    // QNetworkAccessManager rewinds the body if it has to resend it
+    body.readAll();
+    QVERIFY( body.seek( 0 ) );
+    QCOMPARE( body.readAll(), expected );
+
+    // into the file, then into the tail
+    QVERIFY( body.seek( head.size() + 10 ) );
+    QCOMPARE( body.read( 20 ), expected.mid( head.size() + 10, 20 ) );
+
+    QVERIFY( body.seek( expected.size() - 3 ) );
+    QCOMPARE( body.readAll(), expected.right( 3 ) );
+
+    QVERIFY( !body.seek( expected.size() + 1 ) );
+}
+
+
+QTEST_MAIN( TestUploadDevices )
+#include "TestUploadDevices.moc"
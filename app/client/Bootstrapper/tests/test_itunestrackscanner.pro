@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = test_itunestrackscanner
+QT = core testlib
+CONFIG += lastfm
+CONFIG -= app_bundle
+INCLUDEPATH += ..
+include( ../../../../admin/include.qmake )
+
+DEFINES += LASTFM_COLLAPSE_NAMESPACE
+SOURCES = TestITunesTrackScanner.cpp \
+          ../ITunesDevice/ITunesTrackScanner.cpp
+HEADERS = ../ITunesDevice/ITunesTrackScanner.h
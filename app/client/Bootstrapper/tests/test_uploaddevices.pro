@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = test_uploaddevices
+QT = core testlib
+CONFIG -= app_bundle
+INCLUDEPATH += ..
+include( ../../../../admin/include.qmake )
+
+!win32:LIBS += -lz
+
+SOURCES = TestUploadDevices.cpp \
+          ../GzipDevice.cpp \
+          ../MultipartDevice.cpp
+HEADERS = ../GzipDevice.h \
+          ../MultipartDevice.h
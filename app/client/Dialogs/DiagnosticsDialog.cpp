@@ -19,9 +19,11 @@
 */
 
 #include "lib/unicorn/UnicornCoreApplication.h"
+#include "lib/unicorn/ImageCache.h"
 
 #include "ui_DiagnosticsDialog.h"
 #include "DiagnosticsDialog.h"
+#include "../Services/MetadataService/MetadataService.h"
 #include "../Services/ScrobbleService/ScrobbleService.h"
 #include "../MediaDevices/DeviceScrobbler.h"
 
@@ -75,8 +77,12 @@ DiagnosticsDialog::DiagnosticsDialog( QWidget *parent )
     connect( qApp, SIGNAL(scrobblePointReached( Track )), SLOT(onScrobblePointReached()), Qt::QueuedConnection ); // queued because otherwise cache isn't filled yet
     connect( ui->ipod_scrobble_button, SIGNAL(clicked()), SLOT(onScrobbleIPodClicked()) );
     connect( ui->logs_button, SIGNAL(clicked()), SLOT(onSendLogsClicked()) );
+    connect( &unicorn::ImageCache::instance(), SIGNAL(statsChanged()), SLOT(onImageCacheStatsChanged()) );
+    connect( &MetadataService::instance(), SIGNAL(statsChanged()), SLOT(onPrefetchStatsChanged()) );
 
     onScrobblePointReached();
+    onImageCacheStatsChanged();
+    onPrefetchStatsChanged();
 
 #ifndef Q_WS_X11
     QString path = unicorn::CoreApplication::log( "iPodScrobbler" ).absoluteFilePath();
@@ -225,6 +231,38 @@ DiagnosticsDialog::onScrobbleIPodClicked()
 }
 
 
+void
+DiagnosticsDialog::onImageCacheStatsChanged()
+{
+    unicorn::ImageCache& cache = unicorn::ImageCache::instance();
+
+    int const hits = cache.memoryHits() + cache.diskHits() + cache.revalidated() + cache.coalesced();
+    int const total = hits + cache.misses();
+
+    QStringList lines;
+    lines << tr( "Hits: %1 (%2 from memory, %3 from disk, %4 revalidated, %5 shared a download)" )
+                .arg( hits ).arg( cache.memoryHits() ).arg( cache.diskHits() ).arg( cache.revalidated() ).arg( cache.coalesced() );
+    lines << tr( "Misses: %1" ).arg( cache.misses() );
+    lines << tr( "Hit rate: %1%" ).arg( total ? ( hits * 100 ) / total : 0 );
+    lines << tr( "On disk: %1 of %2 MB" ).arg( cache.diskSize() / ( 1024 * 1024 ) ).arg( cache.maxDiskSize() / ( 1024 * 1024 ) );
+
+    ui->image_cache_stats->setText( lines.join( "\n" ) );
+}
+
+
+void
+DiagnosticsDialog::onPrefetchStatsChanged()
+{
+    MetadataService& metadata = MetadataService::instance();
+
+    QStringList lines;
+    lines << tr( "Next tracks prefetched: %1" ).arg( metadata.prefetched() );
+    lines << tr( "Played next: %1 (%2%)" ).arg( metadata.prefetchHits() ).arg( metadata.prefetched() ? ( metadata.prefetchHits() * 100 ) / metadata.prefetched() : 0 );
+
+    ui->prefetch_stats->setText( lines.join( "\n" ) );
+}
+
+
 void 
 DiagnosticsDialog::onSendLogsClicked()
 {
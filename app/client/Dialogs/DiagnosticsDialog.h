@@ -53,6 +53,8 @@ private slots:
 	void onScrobbleIPodClicked();
 	void onSendLogsClicked();
 	void poll();
+	void onImageCacheStatsChanged();
+	void onPrefetchStatsChanged();
 
 private:
     Ui::DiagnosticsDialog* ui;
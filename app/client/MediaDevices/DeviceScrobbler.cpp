@@ -31,10 +31,15 @@
 
 #ifdef Q_WS_X11
 #include <QFileDialog>
+#include "IpodMountWatcher_linux.h"
 #endif
 #include <QDebug>
 #include <QDirIterator>
+#include <QDomDocument>
 #include <QTimer>
+#include <QXmlStreamReader>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 
 #ifdef Q_OS_MAC
 // Check for iTunes playcount difference once every 3 minutes
@@ -48,21 +53,104 @@
 
 QString getIpodMountPath();
 
+namespace
+{
+    /** Copies the element the reader is on, and everything in it, into doc */
+    QDomElement
+    readElement( QXmlStreamReader& xml, QDomDocument& doc )
+    {
+        QDomElement element = doc.createElement( xml.name().toString() );
+
+        foreach ( const QXmlStreamAttribute& attribute, xml.attributes() )
+            element.setAttribute( attribute.name().toString(), attribute.value().toString() );
+
+        while ( !xml.atEnd() )
+        {
+            xml.readNext();
+
+            if ( xml.isStartElement() )
+                element.appendChild( readElement( xml, doc ) );
+            else if ( xml.isCharacters() && !xml.isWhitespace() )
+                element.appendChild( doc.createTextNode( xml.text().toString() ) );
+            else if ( xml.isEndElement() )
+                break;
+        }
+
+        return element;
+    }
+
+    /** Reads the track elements in one file. The file is streamed and each
+      * track gets a QDomDocument of its own. */
+    struct TrackElementsFromFile
+    {
+        typedef QList<QDomElement> result_type;
+
+        QList<QDomElement>
+        operator()( const QString& file ) const
+        {
+            QList<QDomElement> elements;
+
+            QFile iPodScrobbleFile( file );
+
+            if ( !iPodScrobbleFile.open( QIODevice::ReadOnly | QIODevice::Text ) )
+                return elements;
+
+            QXmlStreamReader xml( &iPodScrobbleFile );
+
+            while ( !xml.atEnd() )
+            {
+                if ( xml.readNext() != QXmlStreamReader::StartElement || xml.name() != QLatin1String( "track" ) )
+                    continue;
+
+                QDomDocument doc;
+                elements << readElement( xml, doc );
+            }
+
+            if ( xml.hasError() )
+                qWarning() << "Error reading" << file << xml.errorString();
+
+            return elements;
+        }
+    };
+
+    void
+    appendElements( QList<QDomElement>& elements, const QList<QDomElement>& fileElements )
+    {
+        elements += fileElements;
+    }
+}
+
 DeviceScrobbler::DeviceScrobbler( QObject *parent )
     :QObject( parent )
 {
     connect( this, SIGNAL(error(QString)), aApp, SIGNAL(error(QString)));
 
+    m_scrobblesReader = new QFutureWatcher<QList<QDomElement> >( this );
+    connect( m_scrobblesReader, SIGNAL(finished()), SLOT(onScrobblesRead()) );
+
+#ifdef Q_WS_X11
+    // there's no iTunes for twiddly to check, we're told when an iPod turns up
+    m_twiddlyTimer = 0;
+    m_ipodManual = false;
+    m_ipodManualQueued = false;
+
+    m_mountWatcher = new IpodMountWatcher( this );
+    connect( m_mountWatcher, SIGNAL(databaseChanged(QString)), SLOT(onIpodDatabaseChanged(QString)) );
+#else
     m_twiddlyTimer = new QTimer( this );
     connect( m_twiddlyTimer, SIGNAL(timeout()), SLOT(twiddle()) );
     m_twiddlyTimer->start( BACKGROUND_CHECK_INTERVAL );
 
     // run once 3 seconds after starting up
     QTimer::singleShot( 3 * 1000, this, SLOT(twiddle()) );
+#endif
 }
 
 DeviceScrobbler::~DeviceScrobbler()
 {
+    // the files are read again next time
+    m_scrobblesReader->waitForFinished();
+
     if ( m_confirmDialog )
         m_confirmDialog->deleteLater();
 
@@ -222,57 +310,110 @@ DeviceScrobbler::scrobbleIpodFiles( const QStringList& files )
 {
     qDebug() << files;
 
-    bool removeFiles = false;
+    if ( !unicorn::OldeAppSettings().deviceScrobblingEnabled() )
+    {
+        // device scrobbling is disabled so remove these files
+        foreach ( QString file, files )
+            QFile::remove( file );
+
+        return;
+    }
+
+    foreach ( const QString& file, files )
+        if ( !m_pendingFiles.contains( file ) && !m_readingFiles.contains( file ) )
+            m_pendingFiles << file;
+
+    // anything that comes in while we're reading is read straight after
+    if ( !m_scrobblesReader->isRunning() )
+        readPendingFiles();
+}
+
+void
+DeviceScrobbler::readPendingFiles()
+{
+    m_readingFiles = m_pendingFiles;
+    m_pendingFiles.clear();
+
+    m_scrobblesReader->setFuture( QtConcurrent::run( &DeviceScrobbler::trackElementsFromFiles, m_readingFiles ) );
+}
+
+void
+DeviceScrobbler::onScrobblesRead()
+{
+    QStringList files = m_readingFiles;
+    m_readingFiles.clear();
+
+    // the settings are read once, here
+    ScrobbleFilter const filter = ScrobbleService::instance().filter();
 
-    if ( unicorn::OldeAppSettings().deviceScrobblingEnabled() )
+    QList<lastfm::Track> scrobbles;
+
+    foreach ( const QDomElement& element, m_scrobblesReader->result() )
     {
-        QList<lastfm::Track> scrobbles = scrobblesFromFiles( files );
+        lastfm::Track track( element );
 
-        // TODO: fix the root cause of this problem
-        // If there are more than 4000 scrobbles we assume there was an error with the
-        // iPod scrobbling diff checker so discard these scrobbles.
-        // 4000 because 16 waking hours a day, for two weeks, with 3.5 minute songs
-        if ( scrobbles.count() >= 4000 )
-            removeFiles = true;
-        else
+        // don't add tracks to the list if they don't have an artist
+        // don't add podcasts to the list if podcast scrobbling is off
+        // don't add videos to the list (well, videos that aren't "music video")
+        // don't add tracks if they are in excluded folders
+
+        if ( filter.accepts( track ) )
+            scrobbles << track;
+    }
+
+    // sort the iPod scrobbles before caching them
+    if ( scrobbles.count() > 1 )
+        qSort( scrobbles.begin(), scrobbles.end() );
+
+    scrobbleIpodScrobbles( files, scrobbles );
+
+    if ( !m_pendingFiles.isEmpty() )
+        readPendingFiles();
+}
+
+void
+DeviceScrobbler::scrobbleIpodScrobbles( const QStringList& files, const QList<lastfm::Track>& scrobbles )
+{
+    bool removeFiles = false;
+
+    // TODO: fix the root cause of this problem
+    // If there are more than 4000 scrobbles we assume there was an error with the
+    // iPod scrobbling diff checker so discard these scrobbles.
+    // 4000 because 16 waking hours a day, for two weeks, with 3.5 minute songs
+    if ( scrobbles.count() >= 4000 )
+        removeFiles = true;
+    else
+    {
+        if ( scrobbles.count() > 0 )
         {
-            if ( scrobbles.count() > 0 )
+            if ( unicorn::AppSettings().alwaysAsk()
+                 || scrobbles.count() >= 200 ) // always get them to check scrobbles over 200
             {
-                if ( unicorn::AppSettings().alwaysAsk()
-                     || scrobbles.count() >= 200 ) // always get them to check scrobbles over 200
+                if ( !m_confirmDialog )
                 {
-                    if ( !m_confirmDialog )
-                    {
-                        m_confirmDialog = new ScrobbleConfirmationDialog( scrobbles, aApp->mainWindow() );
-                        connect( m_confirmDialog, SIGNAL(finished(int)), SLOT(onScrobblesConfirmationFinished(int)) );
-                    }
-                    else
-                        m_confirmDialog->addTracks( scrobbles );
-
-                    // add the files so it can delete them when the user has decided what to do
-                    m_confirmDialog->addFiles( files );
-                    m_confirmDialog->show();
+                    m_confirmDialog = new ScrobbleConfirmationDialog( scrobbles, aApp->mainWindow() );
+                    connect( m_confirmDialog, SIGNAL(finished(int)), SLOT(onScrobblesConfirmationFinished(int)) );
                 }
                 else
-                {
-                    // sort the iPod scrobbles before caching them
-                    if ( scrobbles.count() > 1 )
-                        qSort ( scrobbles.begin(), scrobbles.end() );
+                    m_confirmDialog->addTracks( scrobbles );
 
-                    emit foundScrobbles( scrobbles );
-
-                    // we're scrobbling them so remove the source files
-                    removeFiles = true;
-                }
+                // add the files so it can delete them when the user has decided what to do
+                m_confirmDialog->addFiles( files );
+                m_confirmDialog->show();
             }
             else
-                // there were no scrobbles in the files so remove them
+            {
+                // already sorted by onScrobblesRead
+                emit foundScrobbles( scrobbles );
+
+                // we're scrobbling them so remove the source files
                 removeFiles = true;
+            }
         }
+        else
+            // there were no scrobbles in the files so remove them
+            removeFiles = true;
     }
-    else
-        // device scrobbling is disabled so remove these files
-        removeFiles = true;
 
     if ( removeFiles )
         foreach ( QString file, files )
@@ -280,40 +421,14 @@ DeviceScrobbler::scrobbleIpodFiles( const QStringList& files )
 
 }
 
-QList<lastfm::Track>
-DeviceScrobbler::scrobblesFromFiles( const QStringList& files  )
+//static
+QList<QDomElement>
+DeviceScrobbler::trackElementsFromFiles( const QStringList& files )
 {
-    QList<lastfm::Track> scrobbles;
-
-    foreach ( const QString file, files )
-    {
-        QFile iPodScrobbleFile( file );
-
-        if ( iPodScrobbleFile.open( QIODevice::ReadOnly | QIODevice::Text ) )
-        {
-            QDomDocument iPodScrobblesDoc;
-            iPodScrobblesDoc.setContent( &iPodScrobbleFile );
-            QDomNodeList tracks = iPodScrobblesDoc.elementsByTagName( "track" );
-
-            for ( int i(0) ; i < tracks.count() ; ++i )
-            {
-                lastfm::Track track( tracks.at(i).toElement() );
-
-                // don't add tracks to the list if they don't have an artist
-                // don't add podcasts to the list if podcast scrobbling is off
-                // don't add videos to the list (well, videos that aren't "music video")
-                // don't add tracks if they are in excluded folders
-
-                if ( !track.artist().isNull()
-                     && ( unicorn::UserSettings().value( "podcasts", true ).toBool() || !track.isPodcast() )
-                     && !track.isVideo()
-                     && !ScrobbleService::isDirExcluded( track ) )
-                    scrobbles << track;
-            }
-        }
-    }
-
-    return scrobbles;
+    return QtConcurrent::blockingMappedReduced<QList<QDomElement> >( files,
+                                                                    TrackElementsFromFile(),
+                                                                    appendElements,
+                                                                    QtConcurrent::UnorderedReduce );
 }
 
 void
@@ -344,28 +459,97 @@ void
 DeviceScrobbler::onScrobbleIpodTriggered() {
     if ( iPod )
     {
-        qDebug() << "deleting ipod...";
-        delete iPod;
+        // let the one in progress finish, a manual one is run straight after
+        if ( !m_ipodManual )
+            m_ipodManualQueued = true;
+        return;
     }
-    qDebug() << "here";
+
     iPod = new IpodDeviceLinux;
+    m_ipodManual = true;
     QString path;
     bool autodetectionSuceeded = true;
 
     if ( !iPod->autodetectMountPath() )
     {
-        path = getIpodMountPath();
+        // only ask where it is if we haven't seen exactly one mounted
+        QStringList mounted = m_mountWatcher->mountPaths();
+        path = mounted.count() == 1 ? mounted.first() : getIpodMountPath();
         iPod->setMountPath( path );
         autodetectionSuceeded = false;
     }
 
     if ( autodetectionSuceeded || !path.isEmpty() )
+        scrobbleIpod();
+    else
+        finishIpod();
+}
+
+
+void
+DeviceScrobbler::onIpodDatabaseChanged( const QString& mountPath )
+{
+    // we only scrobble the iPods the user has already said are theirs,
+    // anything else waits for them to ask
+    if ( !unicorn::OldeAppSettings().deviceScrobblingEnabled() || !isAssociatedMountPath( mountPath ) )
+        return;
+
+    if ( iPod )
+    {
+        if ( !m_ipodQueue.contains( mountPath ) )
+            m_ipodQueue << mountPath;
+        return;
+    }
+
+    iPod = new IpodDeviceLinux;
+    m_ipodManual = false;
+    iPod->setMountPath( mountPath, true );
+    scrobbleIpod();
+}
+
+
+bool
+DeviceScrobbler::isAssociatedMountPath( const QString& mountPath ) const
+{
+    unicorn::UserSettings us;
+    int count = us.beginReadArray( "associatedDevices" );
+    bool associated = false;
+
+    for ( int i = 0; i < count && !associated; i++ )
+    {
+        us.setArrayIndex( i );
+        associated = us.value( "mountPath" ).toString() == mountPath;
+    }
+
+    us.endArray();
+
+    return associated;
+}
+
+
+void
+DeviceScrobbler::scrobbleIpod()
+{
+    connect( iPod, SIGNAL( scrobblingCompleted( int ) ), this, SLOT( scrobbleIpodTracks( int ) ) );
+    connect( iPod, SIGNAL( calculatingScrobbles( int ) ), this, SLOT( onCalculatingScrobbles( int ) ) );
+    connect( iPod, SIGNAL( errorOccurred() ), this, SLOT( onIpodScrobblingError() ) );
+    iPod->fetchTracksToScrobble();
+}
+
+
+void
+DeviceScrobbler::finishIpod()
+{
+    iPod->deleteLater();
+    iPod = 0;
+
+    if ( m_ipodManualQueued )
     {
-        connect( iPod, SIGNAL( scrobblingCompleted( int ) ), this, SLOT( scrobbleIpodTracks( int ) ) );
-        connect( iPod, SIGNAL( calculatingScrobbles( int ) ), this, SLOT( onCalculatingScrobbles( int ) ) );
-        connect( iPod, SIGNAL( errorOccurred() ), this, SLOT( onIpodScrobblingError() ) );
-        iPod->fetchTracksToScrobble();
+        m_ipodManualQueued = false;
+        onScrobbleIpodTriggered();
     }
+    else if ( !m_ipodQueue.isEmpty() )
+        onIpodDatabaseChanged( m_ipodQueue.takeFirst() );
 }
 
 
@@ -390,17 +574,19 @@ QString getIpodMountPath()
 void 
 DeviceScrobbler::onCalculatingScrobbles( int trackCount )
 {
-    qApp->setOverrideCursor( Qt::WaitCursor );
+    if ( m_ipodManual )
+        qApp->setOverrideCursor( Qt::WaitCursor );
 }
 
 void 
 DeviceScrobbler::scrobbleIpodTracks( int trackCount )
 {
-    qApp->restoreOverrideCursor();
+    if ( m_ipodManual )
+        qApp->restoreOverrideCursor();
     qDebug() << trackCount << " new tracks to scrobble.";
 
     bool bootStrapping = false;
-    if ( iPod->lastError() != IpodDeviceLinux::NoError && !iPod->isDeviceKnown() )
+    if ( m_ipodManual && iPod->lastError() != IpodDeviceLinux::NoError && !iPod->isDeviceKnown() )
     {
         bootStrapping = true;
         qDebug() << "Should we save it?";
@@ -456,15 +642,17 @@ DeviceScrobbler::scrobbleIpodTracks( int trackCount )
                     qSort ( tracks.begin(), tracks.end() );
 
                 emit foundScrobbles( tracks );
-                QMessageBoxBuilder( 0 )
-                    .setIcon( QMessageBox::Information )
-                    .setTitle( tr( "Scrobble iPod" ) )
-                    .setText( tr( "%1 tracks scrobbled." ).arg( tracks.count() ) )
-                    .exec();
+
+                if ( m_ipodManual )
+                    QMessageBoxBuilder( 0 )
+                        .setIcon( QMessageBox::Information )
+                        .setTitle( tr( "Scrobble iPod" ) )
+                        .setText( tr( "%1 tracks scrobbled." ).arg( tracks.count() ) )
+                        .exec();
             }
         }
     }
-    else if ( !iPod->lastError() )
+    else if ( m_ipodManual && !iPod->lastError() )
     {
         QMessageBoxBuilder( 0 )
             .setIcon( QMessageBox::Information )
@@ -473,14 +661,23 @@ DeviceScrobbler::scrobbleIpodTracks( int trackCount )
             .exec();
         qDebug() << "No tracks to scrobble";
     }
-    delete iPod;
-    iPod = 0;
+
+    finishIpod();
 }
 
 void 
 DeviceScrobbler::onIpodScrobblingError()
 {
     qDebug() << "iPod Error";
+
+    if ( !m_ipodManual )
+    {
+        // we weren't asked, so don't bother them about it
+        qDebug() << "automatic iPod scrobble failed:" << iPod->lastError();
+        finishIpod();
+        return;
+    }
+
     qApp->restoreOverrideCursor();
     QString path;
     switch( iPod->lastError() )
@@ -493,6 +690,8 @@ DeviceScrobbler::onIpodScrobblingError()
                 iPod->setMountPath( path );
                 iPod->fetchTracksToScrobble();
             }
+            else
+                finishIpod();
             break;
 
         case IpodDeviceLinux::AccessError:
@@ -501,8 +700,7 @@ DeviceScrobbler::onIpodScrobblingError()
                 .setTitle( tr( "Scrobble iPod" ) )
                 .setText( tr( "The iPod database could not be opened." ) )
                 .exec();
-            delete iPod;
-            iPod = 0;
+            finishIpod();
             break;
         case IpodDeviceLinux::UnknownError:
             QMessageBoxBuilder( 0 )
@@ -510,11 +708,11 @@ DeviceScrobbler::onIpodScrobblingError()
                 .setTitle( tr( "Scrobble iPod" ) )
                 .setText( tr( "An unknown error occurred while trying to access the iPod database." ) )
                 .exec();
-            delete iPod;
-            iPod = 0;
+            finishIpod();
             break;
         default:
             qDebug() << "untracked error:" << iPod->lastError();
+            finishIpod();
     }
 }
 
@@ -22,6 +22,8 @@
 #define DEVICE_SCROBBLER_H_
 
 #include <QDialogButtonBox>
+#include <QDomElement>
+#include <QFutureWatcher>
 #include <QProcess>
 
 #include "lib/unicorn/UnicornSession.h"
@@ -32,6 +34,7 @@
 #ifdef Q_WS_X11
 #include <QPointer>
 #include "IpodDevice_linux.h"
+class IpodMountWatcher;
 #endif
 
 using unicorn::Session;
@@ -67,6 +70,7 @@ public slots:
 
 private slots:
 #ifdef Q_WS_X11
+    void onIpodDatabaseChanged( const QString& mountPath );
     void onCalculatingScrobbles( int trackCount );
     void scrobbleIpodTracks( int trackCount );
     void onIpodScrobblingError();
@@ -77,6 +81,7 @@ private slots:
 
     void onScrobblesConfirmationFinished( int result );
     void checkCachedIPodScrobbles();
+    void onScrobblesRead();
 
 public:
     void handleMessage( const QStringList& );
@@ -84,13 +89,27 @@ public:
 
 private:
 #ifdef Q_WS_X11
+    void scrobbleIpod();
+    void finishIpod();
+    bool isAssociatedMountPath( const QString& mountPath ) const;
+
     QPointer<IpodDeviceLinux> iPod;
+    bool m_ipodManual; // or found by m_mountWatcher, so keep quiet
+    QStringList m_ipodQueue; // mount paths that changed while iPod was busy
+    bool m_ipodManualQueued; // asked for while an automatic scrobble ran
+    IpodMountWatcher* m_mountWatcher;
 #endif
     bool isITunesPluginInstalled();
 
     void twiddled( const QStringList& arguments );
     void scrobbleIpodFiles( const QStringList& files );
-    QList<lastfm::Track> scrobblesFromFiles( const QStringList& files );
+    void readPendingFiles();
+    void scrobbleIpodScrobbles( const QStringList& files, const QList<lastfm::Track>& scrobbles );
+
+    /** Reads the files a thread each, off the GUI thread. Only the XML of
+      * the tracks comes back, onScrobblesRead() makes the Tracks so their
+      * signal proxies live on the GUI thread. */
+    static QList<QDomElement> trackElementsFromFiles( const QStringList& files );
 
     lastfm::User associatedUser( QString deviceId );
 
@@ -98,6 +117,10 @@ private:
     QPointer<QProcess> m_twiddly;
     QTimer* m_twiddlyTimer;
     QPointer<ScrobbleConfirmationDialog> m_confirmDialog;
+
+    QFutureWatcher<QList<QDomElement> >* m_scrobblesReader;
+    QStringList m_readingFiles; // by m_scrobblesReader
+    QStringList m_pendingFiles; // that came while it was busy
 };
 
 #endif //DEVICE_SCROBBLER_H_
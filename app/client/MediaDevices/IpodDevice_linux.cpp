@@ -20,6 +20,7 @@
 
 #include "Application.h"
 #include "IpodDevice_linux.h"
+#include "IpodPlayCountDiff.h"
 #include "lib/unicorn/QMessageBoxBuilder.h"
 #include "lib/unicorn/UnicornSettings.h"
 #include "lib/unicorn/UnicornSession.h"
@@ -50,12 +51,14 @@ void
 IpodTracksFetcher::run()
 {
     fetchTracks();
-    exec();
 }
 
 void
 IpodTracksFetcher::fetchTracks()
 {
+    IpodPlayCountDiff playCounts( m_scrobblesdb, m_tableName );
+    playCounts.load();
+
     GList *cur;
     for ( cur = m_itdb->tracks; cur; cur = cur->next )
     {
@@ -63,37 +66,25 @@ IpodTracksFetcher::fetchTracks()
         if ( !iTrack )
             continue;
 
-        int newPlayCount = iTrack->playcount - previousPlayCount( iTrack );
-        QDateTime time;
-        time.setTime_t( iTrack->time_played );
-
-        if ( time.toTime_t() == 0 )
-            continue;
-
-        QDateTime prevPlayTime = previousPlayTime( iTrack );
+        int newPlayCount = playCounts.newPlays( iTrack->id, iTrack->playcount, iTrack->time_played );
 
-        //this logic takes into account that sometimes the itdb track play count is not
-        //updated correctly (or libgpod doesn't get it right),
-        //so we rely on the track play time too, which seems to be right most of the time
-        if ( ( iTrack->playcount > 0 && newPlayCount > 0 ) || time > prevPlayTime )
+        if ( newPlayCount > 0 )
         {
             Track lstTrack;
             setTrackInfo( lstTrack, iTrack );
 
-            if ( newPlayCount == 0 )
-                newPlayCount++;
-
             //add the track to the list as many times as the updated playcount.
             for ( int i = 0; i < newPlayCount; i++ )
             {
                 m_tracksToScrobble.append( lstTrack );
             }
-
-            commit( iTrack );
         }
     }
+
+    qDebug() << "committing" << playCounts.changes() << "play count changes";
+    playCounts.commit();
+
     qDebug() << "tracks fetching finished";
-    exit();
 }
 
 void
@@ -114,43 +105,6 @@ IpodTracksFetcher::setTrackInfo( Track& lstTrack, Itdb_Track* iTrack )
     MutableTrack( lstTrack ).setExtra( "playerName", "iPod " + m_ipodModel );
 }
 
-void
-IpodTracksFetcher::commit( Itdb_Track* iTrack )
-{
-    QSqlQuery query( m_scrobblesdb );
-    QString sql = "REPLACE INTO " + m_tableName + " ( playcount, lastplaytime, id ) VALUES( %1, %2, %3 )";
-
-    query.exec( sql.arg( iTrack->playcount ).arg( iTrack->time_played ).arg( iTrack->id  ) );
-    if( query.lastError().type() != QSqlError::NoError )
-        qWarning() << query.lastError().text();
-}
-
-uint
-IpodTracksFetcher::previousPlayCount( Itdb_Track* track ) const
-{
-    QSqlQuery query( m_scrobblesdb );
-    QString sql = "SELECT playcount FROM " + m_tableName + " WHERE id=" + QString::number( track->id );
-
-    query.exec( sql );
-
-    if( query.next() )
-        return query.value( 0 ).toUInt();
-    return 0;
-}
-
-QDateTime
-IpodTracksFetcher::previousPlayTime( Itdb_Track* track ) const
-{
-    QSqlQuery query( m_scrobblesdb );
-    QString sql = "SELECT lastplaytime FROM " + m_tableName  + " WHERE id=" + QString::number( track->id );
-
-    query.exec( sql );
-
-    if( query.next() )
-        return QDateTime::fromTime_t( query.value( 0 ).toUInt() );
-    return QDateTime::fromTime_t( 0 );
-}
-
 IpodDeviceLinux::IpodDeviceLinux()
     : m_itdb( 0 )
     , m_mpl( 0 )
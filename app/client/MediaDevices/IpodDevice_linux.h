@@ -37,10 +37,7 @@ public:
     void run();
 private:
     void fetchTracks();
-    void commit( Itdb_Track* iTrack );
     void setTrackInfo( Track& lstTrack, Itdb_Track* iTrack );
-    uint previousPlayCount( Itdb_Track* iTrack ) const;
-    QDateTime previousPlayTime( Itdb_Track* track ) const;
 
 private:
     Itdb_iTunesDB* m_itdb;
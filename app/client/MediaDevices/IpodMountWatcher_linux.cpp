@@ -0,0 +1,202 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IpodMountWatcher_linux.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#define MOUNT_INFO "/proc/self/mountinfo"
+
+// how long to let a mount or a sync settle before we look
+#define SETTLE_INTERVAL 1000
+
+// when we can't be told about mounts we look this often instead
+#define POLL_INTERVAL 5000
+
+IpodMountWatcher::IpodMountWatcher( QObject* parent )
+    : QObject( parent )
+    , m_notifier( 0 )
+    , m_pollTimer( 0 )
+{
+    m_settleTimer = new QTimer( this );
+    m_settleTimer->setSingleShot( true );
+    m_settleTimer->setInterval( SETTLE_INTERVAL );
+    connect( m_settleTimer, SIGNAL(timeout()), SLOT(scan()) );
+
+    m_databaseWatcher = new QFileSystemWatcher( this );
+    connect( m_databaseWatcher, SIGNAL(fileChanged(QString)), SLOT(onDatabaseChanged(QString)) );
+
+    m_mounts = new QFile( MOUNT_INFO, this );
+
+    if ( m_mounts->open( QIODevice::ReadOnly | QIODevice::Unbuffered ) )
+    {
+        // mountinfo polls as exceptional, not readable, when it changes
+        m_notifier = new QSocketNotifier( m_mounts->handle(), QSocketNotifier::Exception, this );
+        connect( m_notifier, SIGNAL(activated(int)), SLOT(onMountsChanged()) );
+    }
+    else
+    {
+        qWarning() << "Couldn't watch" << MOUNT_INFO << "so polling it instead";
+
+        m_pollTimer = new QTimer( this );
+        m_pollTimer->setInterval( POLL_INTERVAL );
+        connect( m_pollTimer, SIGNAL(timeout()), SLOT(onMountsChanged()) );
+        m_pollTimer->start();
+    }
+
+    // for the iPods that were plugged in before we started
+    readMounts();
+    m_settleTimer->start();
+}
+
+QString
+IpodMountWatcher::databasePath( const QString& mountPath )
+{
+    return mountPath + "/iPod_Control/iTunes/iTunesDB";
+}
+
+/** Reads the mount table, returns true if it is different to last time */
+bool
+IpodMountWatcher::readMounts()
+{
+    QByteArray mountInfo;
+
+    if ( m_mounts->isOpen() )
+    {
+        // reading it from the start is also what clears the notification
+        m_mounts->seek( 0 );
+        mountInfo = m_mounts->readAll();
+    }
+    else
+    {
+        QFile file( MOUNT_INFO );
+        if ( file.open( QIODevice::ReadOnly ) )
+            mountInfo = file.readAll();
+    }
+
+    if ( mountInfo == m_mountInfo )
+        return false;
+
+    m_mountInfo = mountInfo;
+    return true;
+}
+
+/** The mount points of the filesystems an iPod could be, unescaped */
+QStringList
+IpodMountWatcher::mountPoints( const QByteArray& mountInfo )
+{
+    QStringList mountPoints;
+
+    foreach ( const QByteArray& line, mountInfo.split( '\n' ) )
+    {
+        // id parent major:minor root mountpoint options [optional...] - fstype source superoptions
+        QList<QByteArray> fields = line.split( ' ' );
+        int const separator = fields.indexOf( "-" );
+
+        if ( fields.count() < 5 || separator == -1 || separator + 1 >= fields.count() )
+            continue;
+
+        // iPods are FAT or HFS+, and this keeps us away from network mounts
+        QByteArray const type = fields[separator + 1];
+        if ( type != "vfat" && type != "msdos" && type != "hfsplus" && type != "fuseblk" )
+            continue;
+
+        // spaces and the like come as three digit octal escapes
+        QByteArray const escaped = fields[4];
+        QByteArray path;
+
+        for ( int i = 0 ; i < escaped.size() ; ++i )
+        {
+            if ( escaped[i] == '\\' && i + 3 < escaped.size() )
+            {
+                path += char( escaped.mid( i + 1, 3 ).toInt( 0, 8 ) );
+                i += 3;
+            }
+            else
+                path += escaped[i];
+        }
+
+        mountPoints << QFile::decodeName( path );
+    }
+
+    return mountPoints;
+}
+
+void
+IpodMountWatcher::onMountsChanged()
+{
+    if ( readMounts() )
+        m_settleTimer->start();
+}
+
+void
+IpodMountWatcher::onDatabaseChanged( const QString& path )
+{
+    // iTunesDB is usually replaced rather than written to, which drops the watch
+    if ( QFile::exists( path ) && !m_databaseWatcher->files().contains( path ) )
+        m_databaseWatcher->addPath( path );
+
+    m_settleTimer->start();
+}
+
+void
+IpodMountWatcher::scan()
+{
+    QStringList mountPaths;
+
+    foreach ( const QString& mountPoint, mountPoints( m_mountInfo ) )
+        if ( QFile::exists( databasePath( mountPoint ) ) )
+            mountPaths << mountPoint;
+
+    // forget the iPods that went away so they're reported when they're back
+    foreach ( const QString& mountPath, m_mountPaths )
+    {
+        if ( !mountPaths.contains( mountPath ) )
+        {
+            m_databaseWatcher->removePath( databasePath( mountPath ) );
+            m_reported.remove( mountPath );
+        }
+    }
+
+    m_mountPaths = mountPaths;
+
+    foreach ( const QString& mountPath, m_mountPaths )
+    {
+        QString const path = databasePath( mountPath );
+
+        if ( !m_databaseWatcher->files().contains( path ) )
+            m_databaseWatcher->addPath( path );
+
+        QDateTime const modified = QFileInfo( path ).lastModified();
+
+        // nothing has been synced since we last looked
+        if ( m_reported.value( mountPath ) == modified )
+            continue;
+
+        m_reported[mountPath] = modified;
+
+        qDebug() << "iPod database changed:" << path;
+        emit databaseChanged( mountPath );
+    }
+}
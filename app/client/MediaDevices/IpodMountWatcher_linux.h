@@ -0,0 +1,84 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IPOD_MOUNT_WATCHER_LINUX_H
+#define IPOD_MOUNT_WATCHER_LINUX_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+class QFile;
+class QFileSystemWatcher;
+class QSocketNotifier;
+class QTimer;
+
+/** Tells us when an iPod is mounted, or the iTunesDB on a mounted iPod is
+  * written to, without polling.
+  *
+  * The kernel flags /proc/self/mountinfo as exceptional whenever the mount
+  * table changes, so a QSocketNotifier on it wakes us up for mounts and
+  * unmounts. Each mounted iPod's iTunesDB is then watched with inotify, via
+  * QFileSystemWatcher, so a sync while it stays mounted is noticed too. If
+  * the notifier can't be set up we fall back to reading mountinfo every few
+  * seconds.
+  *
+  * Bursts of changes are settled for a second before we look, and an
+  * iTunesDB is only reported when its modification time has moved on since
+  * we last reported it.
+  */
+class IpodMountWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    IpodMountWatcher( QObject* parent = 0 );
+
+    /** the mount points of the iPods mounted at the last look */
+    QStringList mountPaths() const { return m_mountPaths; }
+
+    static QString databasePath( const QString& mountPath );
+
+signals:
+    /** an iPod was mounted or its iTunesDB was written since we last said */
+    void databaseChanged( const QString& mountPath );
+
+private slots:
+    void onMountsChanged();
+    void onDatabaseChanged( const QString& path );
+    void scan();
+
+private:
+    bool readMounts();
+    static QStringList mountPoints( const QByteArray& mountInfo );
+
+private:
+    QFile* m_mounts;
+    QByteArray m_mountInfo;
+
+    QSocketNotifier* m_notifier;
+    QTimer* m_pollTimer;
+    QTimer* m_settleTimer;
+    QFileSystemWatcher* m_databaseWatcher;
+
+    QStringList m_mountPaths;
+    QHash<QString, QDateTime> m_reported; // database modified time by mount path
+};
+
+#endif // IPOD_MOUNT_WATCHER_LINUX_H
@@ -0,0 +1,112 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "IpodPlayCountDiff.h"
+
+IpodPlayCountDiff::IpodPlayCountDiff( QSqlDatabase db, const QString& tableName )
+    :m_db( db ), m_tableName( tableName )
+{
+}
+
+bool
+IpodPlayCountDiff::load()
+{
+    m_previous = unicorn::PlayCountsMerge();
+
+    QSqlQuery query( m_db );
+    query.setForwardOnly( true );
+
+    // id is the primary key so this is just a walk of its index
+    if ( !query.exec( "SELECT id, playcount, lastplaytime FROM " + m_tableName + " ORDER BY id" ) )
+    {
+        qWarning() << query.lastError().text();
+        return false;
+    }
+
+    while ( query.next() )
+        m_previous.addPrevious( query.value( 0 ).toUInt(), query.value( 1 ).toUInt(), query.value( 2 ).toUInt() );
+
+    return true;
+}
+
+int
+IpodPlayCountDiff::newPlays( quint32 id, quint32 playCount, uint timePlayed )
+{
+    if ( timePlayed == 0 )
+        return 0; // never been played
+
+    const unicorn::PlayCountsMerge::PlayCount* previous = m_previous.find( id );
+
+    int newPlayCount = playCount - ( previous ? previous->playCount : 0 );
+    uint lastPlayTime = previous ? previous->lastPlayed : 0;
+
+    //this logic takes into account that sometimes the itdb track play count is not
+    //updated correctly (or libgpod doesn't get it right),
+    //so we rely on the track play time too, which seems to be right most of the time
+    if ( ( playCount > 0 && newPlayCount > 0 ) || timePlayed > lastPlayTime )
+    {
+        m_ids << id;
+        m_playCounts << playCount;
+        m_lastPlayTimes << timePlayed;
+
+        // a newer play time counts as one play even if the count didn't go up
+        return newPlayCount == 0 ? 1 : qMax( newPlayCount, 0 );
+    }
+
+    return 0;
+}
+
+bool
+IpodPlayCountDiff::commit()
+{
+    if ( m_ids.isEmpty() )
+        return true;
+
+    if ( !m_db.transaction() )
+        qWarning() << m_db.lastError().text();
+
+    QSqlQuery query( m_db );
+    query.prepare( "REPLACE INTO " + m_tableName + " ( id, playcount, lastplaytime ) VALUES ( ?, ?, ? )" );
+    query.addBindValue( m_ids );
+    query.addBindValue( m_playCounts );
+    query.addBindValue( m_lastPlayTimes );
+
+    if ( !query.execBatch() )
+    {
+        qWarning() << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    if ( !m_db.commit() )
+    {
+        qWarning() << m_db.lastError().text();
+        return false;
+    }
+
+    m_ids.clear();
+    m_playCounts.clear();
+    m_lastPlayTimes.clear();
+
+    return true;
+}
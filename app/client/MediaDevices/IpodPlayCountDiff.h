@@ -0,0 +1,64 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IPOD_PLAY_COUNT_DIFF_H
+#define IPOD_PLAY_COUNT_DIFF_H
+
+#include <QSqlDatabase>
+#include <QVariantList>
+
+#include "lib/unicorn/PlayCountsMerge.h"
+
+/** The play counts an iPod's tracks had at the last sync, and the diff
+  * against the counts they have now.
+  *
+  * The device table is read in one scan, in id order, and tracks are
+  * looked up against it in memory. The itdb track list isn't in id order,
+  * so each lookup is a search of O(log n). The new counts are written back with
+  * one prepared statement inside one transaction.
+  */
+class IpodPlayCountDiff
+{
+public:
+    IpodPlayCountDiff( QSqlDatabase db, const QString& tableName );
+
+    /** Reads the play counts from the last sync */
+    bool load();
+
+    /** Returns how many times the track has been played since the last
+      * sync, and queues its current counts to be committed if it changed.
+      * timePlayed is when it was last played, 0 if it never has been. */
+    int newPlays( quint32 id, quint32 playCount, uint timePlayed );
+
+    /** Writes the queued counts back to the table */
+    bool commit();
+
+    int changes() const { return m_ids.count(); }
+
+private:
+    QSqlDatabase m_db;
+    QString m_tableName;
+
+    unicorn::PlayCountsMerge m_previous;
+
+    QVariantList m_ids;
+    QVariantList m_playCounts;
+    QVariantList m_lastPlayTimes;
+};
+
+#endif // IPOD_PLAY_COUNT_DIFF_H
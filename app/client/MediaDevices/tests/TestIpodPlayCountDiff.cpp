@@ -0,0 +1,281 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryFile>
+#include "IpodPlayCountDiff.h"
+
+#define kTable "testuser_iPod_1234"
+
+
+/** the fields of an Itdb_Track that the diff looks at */
+struct FakeItdbTrack
+{
+    quint32 id;
+    quint32 playcount;
+    quint32 time_played;
+};
+
+/** stands in for the track list of an Itdb_iTunesDB with count tracks. Track
+  * i has id 1000 + 7i, was played 1 + i % 13 times and last played a minute
+  * after the one before it, so every track has been played */
+static QList<FakeItdbTrack>
+syntheticTracks( int count )
+{
+    QList<FakeItdbTrack> tracks;
+
+    for (int i = 0; i < count; ++i)
+    {
+        FakeItdbTrack t;
+        t.id = 1000 + i * 7;
+        t.playcount = 1 + i % 13;
+        t.time_played = 1300000000 + i * 60;
+        tracks << t;
+    }
+
+    return tracks;
+}
+
+
+class TestIpodPlayCountDiff : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryFile* m_file;
+    QSqlDatabase m_db;
+
+    int fetchTracks( const QList<FakeItdbTrack>& tracks );
+    QList<QVariantList> table();
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testFirstSync();
+    void testMorePlays();
+    void testNewerPlayTimeOnly();
+    void testPlayCountReset();
+    void testUnchangedWritesNothing();
+    void testMixedSync();
+
+    void benchmarkSync_data();
+    void benchmarkSync();
+};
+
+
+void
+TestIpodPlayCountDiff::init()
+{
+    // a real file so that commits cost what they do on disk
+    m_file = new QTemporaryFile;
+    m_file->open();
+
+    m_db = QSqlDatabase::addDatabase( "QSQLITE", "TestIpodPlayCountDiff" );
+    m_db.setDatabaseName( m_file->fileName() );
+    QVERIFY( m_db.open() );
+
+    QSqlQuery q( m_db );
+    QVERIFY( q.exec( "CREATE TABLE " kTable " ( "
+                     "id           INTEGER PRIMARY KEY, "
+                     "playcount    INTEGER, "
+                     "lastplaytime INTEGER )" ) );
+}
+
+
+void
+TestIpodPlayCountDiff::cleanup()
+{
+    m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase( "TestIpodPlayCountDiff" );
+    delete m_file;
+}
+
+
+/** what IpodTracksFetcher does, minus building the lastfm::Tracks */
+int
+TestIpodPlayCountDiff::fetchTracks( const QList<FakeItdbTrack>& tracks )
+{
+    IpodPlayCountDiff diff( m_db, kTable );
+    if (!diff.load())
+        return -1;
+
+    int plays = 0;
+
+    foreach (const FakeItdbTrack& t, tracks)
+        plays += diff.newPlays( t.id, t.playcount, t.time_played );
+
+    if (!diff.commit())
+        return -1;
+
+    return plays;
+}
+
+
+QList<QVariantList>
+TestIpodPlayCountDiff::table()
+{
+    QList<QVariantList> rows;
+
+    QSqlQuery q( m_db );
+    q.exec( "SELECT id, playcount, lastplaytime FROM " kTable " ORDER BY id" );
+
+    while (q.next())
+        rows << ( QVariantList() << q.value( 0 ).toUInt() << q.value( 1 ).toUInt() << q.value( 2 ).toUInt() );
+
+    return rows;
+}
+
+
+void
+TestIpodPlayCountDiff::testFirstSync()
+{
+    QList<FakeItdbTrack> tracks;
+    FakeItdbTrack played = { 1, 3, 1300000000 };
+    FakeItdbTrack neverPlayed = { 2, 0, 0 };
+    tracks << played << neverPlayed;
+
+    QCOMPARE( fetchTracks( tracks ), 3 );
+    QCOMPARE( table(), QList<QVariantList>() << ( QVariantList() << 1u << 3u << 1300000000u ) );
+}
+
+
+void
+TestIpodPlayCountDiff::testMorePlays()
+{
+    FakeItdbTrack t = { 1, 3, 1300000000 };
+    QCOMPARE( fetchTracks( QList<FakeItdbTrack>() << t ), 3 );
+
+    t.playcount = 5;
+    t.time_played += 600;
+    QCOMPARE( fetchTracks( QList<FakeItdbTrack>() << t ), 2 );
+}
+
+
+void
+TestIpodPlayCountDiff::testNewerPlayTimeOnly()
+{
+    FakeItdbTrack t = { 1, 3, 1300000000 };
+    fetchTracks( QList<FakeItdbTrack>() << t );
+
+    // libgpod doesn't always get the play count right
+    t.time_played += 600;
+    QCOMPARE( fetchTracks( QList<FakeItdbTrack>() << t ), 1 );
+}
+
+
+void
+TestIpodPlayCountDiff::testPlayCountReset()
+{
+    FakeItdbTrack t = { 1, 10, 1300000000 };
+    fetchTracks( QList<FakeItdbTrack>() << t );
+
+    // the iPod was restored, nothing to scrobble but remember the new count
+    t.playcount = 2;
+    t.time_played += 600;
+    QCOMPARE( fetchTracks( QList<FakeItdbTrack>() << t ), 0 );
+
+    t.playcount = 3;
+    t.time_played += 600;
+    QCOMPARE( fetchTracks( QList<FakeItdbTrack>() << t ), 1 );
+}
+
+
+void
+TestIpodPlayCountDiff::testUnchangedWritesNothing()
+{
+    QList<FakeItdbTrack> tracks = syntheticTracks( 100 );
+    fetchTracks( tracks );
+
+    IpodPlayCountDiff diff( m_db, kTable );
+    QVERIFY( diff.load() );
+
+    foreach (const FakeItdbTrack& t, tracks)
+        QCOMPARE( diff.newPlays( t.id, t.playcount, t.time_played ), 0 );
+
+    QCOMPARE( diff.changes(), 0 );
+}
+
+
+void
+TestIpodPlayCountDiff::testMixedSync()
+{
+    QList<FakeItdbTrack> tracks = syntheticTracks( 4 );
+    QCOMPARE( fetchTracks( tracks ), 1 + 2 + 3 + 4 );
+
+    // played twice more, a newer time only, reset and a new track
+    tracks[0].playcount += 2;
+    tracks[0].time_played += 3600;
+    tracks[1].time_played += 3600;
+    tracks[2].playcount = 0;
+    tracks[2].time_played += 7200;
+    tracks << syntheticTracks( 5 ).last();
+
+    QCOMPARE( fetchTracks( tracks ), 2 + 1 + 0 + 0 + 5 );
+
+    QList<QVariantList> rows;
+    rows << ( QVariantList() << 1000u << 3u << 1300003600u )
+         << ( QVariantList() << 1007u << 2u << 1300003660u )
+         << ( QVariantList() << 1014u << 0u << 1300007320u )
+         << ( QVariantList() << 1021u << 4u << 1300000180u )
+         << ( QVariantList() << 1028u << 5u << 1300000240u );
+    QCOMPARE( table(), rows );
+}
+
+
+void
+TestIpodPlayCountDiff::benchmarkSync_data()
+{
+    QTest::addColumn<int>( "count" );
+
+    QTest::newRow( "2000 tracks" ) << 2000;
+    QTest::newRow( "30000 tracks" ) << 30000;
+}
+
+
+/** A sync where the table knows half the tracks and every track has been
+  * played since */
+void
+TestIpodPlayCountDiff::benchmarkSync()
+{
+    QFETCH( int, count );
+
+    QList<FakeItdbTrack> tracks = syntheticTracks( count );
+    fetchTracks( tracks.mid( 0, count / 2 ) );
+
+    for (int i = 0; i < tracks.count(); ++i)
+    {
+        tracks[i].playcount += 1;
+        tracks[i].time_played += 3600;
+    }
+
+    int plays = 0;
+
+    QBENCHMARK_ONCE
+    {
+        plays = fetchTracks( tracks );
+    }
+
+    QVERIFY( plays > count );
+}
+
+
+QTEST_MAIN(TestIpodPlayCountDiff)
+#include "TestIpodPlayCountDiff.moc"
@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = test_ipodplaycountdiff
+QT = core sql testlib
+CONFIG -= app_bundle
+INCLUDEPATH += ..
+include( ../../../../admin/include.qmake )
+
+# PlayCountsMerge is built in rather than linked from libunicorn
+DEFINES += _UNICORN_DLLEXPORT
+
+SOURCES = TestIpodPlayCountDiff.cpp \
+          ../IpodPlayCountDiff.cpp \
+          $$ROOT_DIR/lib/unicorn/PlayCountsMerge.cpp
+HEADERS = ../IpodPlayCountDiff.h
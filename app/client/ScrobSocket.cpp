@@ -32,6 +32,8 @@ ScrobSocket::ScrobSocket( const QString& clientId, QObject* parent )
 : QLocalSocket( parent )
 , m_bInConnect( false )
 , m_clientId( clientId )
+, m_paused( false )
+, m_replayStart( false )
 {
     connect( this, SIGNAL(readyRead()), SLOT(onReadyRead()) );    
     connect( this, SIGNAL(error( QLocalSocket::LocalSocketError )), SLOT(onError( QLocalSocket::LocalSocketError )) );
@@ -50,23 +52,93 @@ ScrobSocket::~ScrobSocket()
 void
 ScrobSocket::transmit( const QString& data )
 {
-    m_msgQueue.enqueue( data );
-    qDebug() << "Connection state == " << state();
-    if( state() == QLocalSocket::UnconnectedState ) {
+    enqueue( data );
+
+    if( state() == QLocalSocket::ConnectedState )
+        sendQueue();
+    else if( state() == QLocalSocket::UnconnectedState )
         doConnect();
+}
+
+
+static inline QString command( const QString& data )
+{
+    return data.section( ' ', 0, 0 );
+}
+
+
+void
+ScrobSocket::enqueue( const QString& data )
+{
+    QString const c = command( data );
+
+    if ( c == "PAUSE" || c == "RESUME" )
+    {
+        if ( !m_msgQueue.isEmpty() )
+        {
+            QString const last = command( m_msgQueue.last() );
+
+            // a pause and a resume we haven't sent yet cancel each other out
+            if ( ( c == "PAUSE" && last == "RESUME" ) || ( c == "RESUME" && last == "PAUSE" ) )
+            {
+                m_msgQueue.removeLast();
+                return;
+            }
+
+            if ( c == last )
+                return;
+        }
+    }
+    else if ( c == "START" )
+    {
+        // nothing we haven't sent for the previous track matters any more
+        while ( !m_msgQueue.isEmpty() )
+        {
+            QString const last = command( m_msgQueue.last() );
+            if ( last != "START" && last != "PAUSE" && last != "RESUME" )
+                break;
+            m_msgQueue.removeLast();
+        }
     }
+
+    m_msgQueue.enqueue( data );
+}
+
+
+void
+ScrobSocket::sendQueue()
+{
+    if ( m_msgQueue.isEmpty() )
+        return;
+
+    QByteArray bytes;
+    while ( !m_msgQueue.isEmpty() )
+        bytes += m_msgQueue.dequeue().toUtf8();
+
+    qDebug() << bytes.trimmed();
+    write( bytes );
+    flush();
 }
 
 
 void 
 ScrobSocket::onConnected()
 {
-    if( !m_msgQueue.empty() )
+    if ( m_replayStart && !m_lastStart.isEmpty() )
     {
-        qDebug() << m_msgQueue.head().trimmed();
-        write( m_msgQueue.takeFirst().toUtf8());
-        flush();
+        // the listener missed something, tell it what is playing first
+        // unless what we're about to send does that anyway
+        QString const first = m_msgQueue.isEmpty() ? QString() : command( m_msgQueue.head() );
+        if ( first != "START" && first != "STOP" )
+        {
+            if ( m_paused && first != "RESUME" )
+                m_msgQueue.prepend( "PAUSE c=" + m_clientId + "\n" );
+            m_msgQueue.prepend( m_lastStart );
+        }
     }
+
+    m_replayStart = false;
+    sendQueue();
 }
 
 void
@@ -92,6 +164,9 @@ ScrobSocket::doConnect()
 void 
 ScrobSocket::onDisconnected()
 {
+    // the listener went away, it may not be the same one when we reconnect
+    m_replayStart = true;
+
     if( !m_msgQueue.empty())
         doConnect();
 }
@@ -103,17 +178,21 @@ ScrobSocket::onError( QLocalSocket::LocalSocketError error )
     switch (error)
     {
         case SocketTimeoutError:
-            // TODO look, really we should store at least one start message forever
-            // then if last time we didn't connect and this time it's a pause we 
-            // send the start first
+        case ConnectionRefusedError: // happens if client isn't running
+        {
+            // what we queued is stale by now, but we keep the last start
+            // and send it first when we next connect, so the state isn't lost.
+            // A stop has nothing to replay it, so that we keep as well
+            QString const last = m_msgQueue.isEmpty() ? QString() : m_msgQueue.last();
             m_msgQueue.clear();
+            if ( command( last ) == "STOP" )
+                m_msgQueue.enqueue( last );
+            m_replayStart = true;
             break;
+        }
         
         case PeerClosedError:
-            // expected
-            break;
-        
-        case ConnectionRefusedError: // happens if client isn't running
+            // handled in onDisconnected
             break;
 
         default: // may as well
@@ -132,18 +211,21 @@ void
 ScrobSocket::start( const Track& t )
 {
     m_track = t;
-    transmit( "START c=" + m_clientId + "&"
+    m_paused = false;
+    m_lastStart = "START c=" + m_clientId + "&"
                     "a=" + encodeAmp( t.artist() ) + "&"
                     "t=" + encodeAmp( t.title() ) + "&"
                     "b=" + encodeAmp( t.album().title() == "[unknown]" ? QString("") : t.album().title() ) + "&"     // todo: and when album.isNull?
                     "l=" + QString::number( t.duration() ) + "&"
-                    "p=" + encodeAmp( t.url().path() ) + '\n' );
+                    "p=" + encodeAmp( t.url().path() ) + '\n';
+    transmit( m_lastStart );
 }
 
 
 void
 ScrobSocket::pause()
 {
+    m_paused = true;
     transmit( "PAUSE c=" + m_clientId + "\n" );
 }
 
@@ -151,6 +233,7 @@ ScrobSocket::pause()
 void
 ScrobSocket::resume()
 {
+    m_paused = false;
     transmit( "RESUME c=" + m_clientId + "\n" );
 }
 
@@ -158,6 +241,8 @@ ScrobSocket::resume()
 void
 ScrobSocket::stop()
 {
+    m_lastStart.clear();
+    m_paused = false;
     transmit( "STOP c=" + m_clientId + "\n" );
 }
 
@@ -165,8 +250,11 @@ ScrobSocket::stop()
 void
 ScrobSocket::onReadyRead()
 {
-    QByteArray bytes = readAll();
-    if (bytes != "OK\n") 
-        qWarning() << bytes.trimmed();
-    disconnectFromServer();
+    // we pipeline, so there is a response for every line we sent
+    while (canReadLine())
+    {
+        QByteArray const bytes = readLine();
+        if (bytes != "OK\n") 
+            qWarning() << bytes.trimmed();
+    }
 }
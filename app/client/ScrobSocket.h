@@ -52,11 +52,21 @@ private slots:
 
 private:
     void doConnect();
+    /** queues the message, dropping any it makes redundant */
+    void enqueue( const QString& data );
+    /** writes everything queued in one go, we stay connected */
+    void sendQueue();
 
     Track m_track;
     QQueue<QString> m_msgQueue;
     bool m_bInConnect;
     QString m_clientId;
+
+    /** we keep the last START so that we can send it again if the listener
+      * missed what we sent, otherwise it wouldn't know what is playing */
+    QString m_lastStart;
+    bool m_paused;
+    bool m_replayStart;
 };
 
 #endif
@@ -0,0 +1 @@
+#include "MetadataService/MetadataService.h"
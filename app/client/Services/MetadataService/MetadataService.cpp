@@ -0,0 +1,420 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QMap>
+#include <QNetworkReply>
+#include <QRegExp>
+#include <QStringList>
+
+#include <lastfm/Album.h>
+#include <lastfm/Artist.h>
+#include <lastfm/User.h>
+#include <lastfm/ws.h>
+#include <lastfm/XmlQuery.h>
+
+#include "lib/unicorn/ImageCache.h"
+
+#include "../../Application.h"
+#include "../ScrobbleService/ScrobbleService.h"
+
+#include "MetadataService.h"
+
+// responses kept, whatever their age
+#define MAX_ENTRIES 200
+
+// give the track that just started the network to itself first
+#define PREFETCH_DELAY 5000
+
+/** The track.getInfo response with its userloved set to loved */
+static QByteArray
+withUserLoved( QByteArray data, bool loved )
+{
+    return data.replace( loved ? "<userloved>0</userloved>" : "<userloved>1</userloved>",
+                         loved ? "<userloved>1</userloved>" : "<userloved>0</userloved>" );
+}
+
+MetadataReply::MetadataReply( const lastfm::Track& track, QObject* parent )
+    :QObject( parent ), m_track( track ), m_scrobbledSince( 0 )
+{
+}
+
+void
+MetadataReply::finish( const QByteArray& data, int scrobbledSince )
+{
+    m_data = data;
+    m_scrobbledSince = scrobbledSince;
+
+    // callers connect to us after get() returns, even when we already have it
+    QMetaObject::invokeMethod( this, "finished", Qt::QueuedConnection );
+    QMetaObject::invokeMethod( this, "deleteLater", Qt::QueuedConnection );
+}
+
+
+MetadataService::MetadataService()
+    :m_prefetched( 0 ), m_prefetchHits( 0 )
+{
+    m_cache.setMaxCost( MAX_ENTRIES );
+
+    m_prefetchTimer.setSingleShot( true );
+    m_prefetchTimer.setInterval( PREFETCH_DELAY );
+    connect( &m_prefetchTimer, SIGNAL(timeout()), SLOT(startPrefetch()) );
+
+    connect( &ScrobbleService::instance(), SIGNAL(scrobblesSubmitted(QList<lastfm::Track>)), SLOT(onScrobblesSubmitted(QList<lastfm::Track>)) );
+    connect( &ScrobbleService::instance(), SIGNAL(trackStarted(lastfm::Track,lastfm::Track)), SLOT(onTrackStarted(lastfm::Track)) );
+}
+
+MetadataService&
+MetadataService::instance()
+{
+    static MetadataService s;
+    return s;
+}
+
+/** Only the parts of the track the call uses are in the key, so the tracks
+  * of an album share their artist's and album's responses */
+QString //static
+MetadataService::key( Method method, const Track& track )
+{
+    QStringList key;
+    key << QString::number( method ) << User().name() << track.artist().name().toLower();
+
+    switch ( method )
+    {
+        case AlbumGetInfo:
+            key << track.album().title().toLower();
+            break;
+        case TrackGetInfo:
+        case TrackGetTags:
+            key << track.title().toLower();
+            break;
+        case TrackGetBuyLinks:
+            key << track.title().toLower() << aApp->currentSession().user().country();
+            break;
+        case ArtistGetInfo:
+        case ArtistGetTags:
+        case ArtistGetEvents:
+            break;
+    }
+
+    return key.join( QChar( 0x1F ) );
+}
+
+/** In seconds */
+int //static
+MetadataService::timeToLive( Method method )
+{
+    switch ( method )
+    {
+        // these have the user's loved state and tags, which they can change
+        case TrackGetInfo:
+        case TrackGetTags:
+            return 5 * 60;
+
+        // long enough to play an album through
+        default:
+            return 60 * 60;
+    }
+}
+
+QNetworkReply* //static
+MetadataService::call( Method method, const Track& track )
+{
+    QString const username = User().name();
+
+    switch ( method )
+    {
+        case TrackGetInfo:
+        {
+            // Track::getInfo only hands the response to a callback
+            QMap<QString, QString> map;
+            map["method"] = "track.getInfo";
+            map["artist"] = track.artist().name();
+            map["track"] = track.title();
+            if ( !username.isEmpty() )
+                map["username"] = username;
+            return lastfm::ws::get( map );
+        }
+        case AlbumGetInfo: return track.album().getInfo( username );
+        case ArtistGetInfo: return track.artist().getInfo( username );
+        case TrackGetTags: return track.getTags();
+        case ArtistGetTags: return track.artist().getTags();
+        case ArtistGetEvents: return track.artist().getEvents();
+        case TrackGetBuyLinks: return track.getBuyLinks( aApp->currentSession().user().country() );
+    }
+
+    return 0;
+}
+
+/** The cached response for the key, if it hasn't expired */
+MetadataService::Entry*
+MetadataService::entry( const QString& key )
+{
+    Entry* entry = m_cache.object( key );
+
+    if ( entry && entry->expires < QDateTime::currentDateTime() )
+    {
+        m_cache.remove( key );
+        entry = 0;
+    }
+
+    return entry;
+}
+
+MetadataReply*
+MetadataService::get( Method method, const Track& track )
+{
+    MetadataReply* reply = new MetadataReply( track, this );
+    QString const key = MetadataService::key( method, track );
+
+    // the response has the user's loved state, which they can change
+    if ( method == TrackGetInfo )
+        watchLoved( track, key );
+
+    if ( Entry* cached = entry( key ) )
+    {
+        reply->finish( cached->data, cached->scrobbledSince );
+        return reply;
+    }
+
+    bool const inFlight = m_waiting.contains( key );
+    m_waiting[key] << reply;
+
+    if ( !inFlight )
+    {
+        Fetch fetch;
+        fetch.key = key;
+        fetch.entry.method = method;
+        fetch.entry.artist = track.artist().name();
+        fetch.entry.track = track.title();
+        fetch.entry.scrobbledSince = 0;
+        fetch.loved = -1;
+
+        QNetworkReply* networkReply = call( method, track );
+        m_fetches[networkReply] = fetch;
+        connect( networkReply, SIGNAL(finished()), SLOT(onFetched()) );
+    }
+
+    return reply;
+}
+
+void
+MetadataService::onFetched()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>( sender() );
+    reply->deleteLater();
+
+    Fetch const fetch = m_fetches.take( reply );
+    QByteArray data = reply->readAll();
+
+    // the response may have been made before the love or unlove
+    if ( fetch.loved != -1 )
+        data = withUserLoved( data, fetch.loved );
+
+    // errors, including the web service's own, are asked for again next time
+    if ( reply->error() == QNetworkReply::NoError )
+    {
+        Entry* entry = new Entry( fetch.entry );
+        entry->data = data;
+        entry->expires = QDateTime::currentDateTime().addSecs( timeToLive( fetch.entry.method ) );
+        m_cache.insert( fetch.key, entry );
+    }
+
+    deliver( fetch.key, data, 0 );
+
+    // a prefetch waits for the network to be quiet
+    if ( m_fetches.isEmpty() && !m_prefetchTimer.isActive() )
+        startPrefetch();
+}
+
+void
+MetadataService::deliver( const QString& key, const QByteArray& data, int scrobbledSince )
+{
+    foreach ( const QPointer<MetadataReply>& reply, m_waiting.take( key ) )
+        if ( reply )
+            reply->finish( data, scrobbledSince );
+}
+
+/** Keeps the play counts in the responses we have honest */
+void
+MetadataService::onScrobblesSubmitted( const QList<lastfm::Track>& tracks )
+{
+    foreach ( const QString& key, m_cache.keys() )
+    {
+        Entry* entry = m_cache.object( key );
+
+        if ( entry->method != ArtistGetInfo && entry->method != TrackGetInfo )
+            continue;
+
+        foreach ( const lastfm::Track& track, tracks )
+        {
+            if ( entry->artist.compare( track.artist().name(), Qt::CaseInsensitive ) != 0 )
+                continue;
+
+            if ( entry->method == ArtistGetInfo || entry->track.compare( track.title(), Qt::CaseInsensitive ) == 0 )
+                ++entry->scrobbledSince;
+        }
+    }
+}
+
+void
+MetadataService::watchLoved( const Track& track, const QString& key )
+{
+    const QObject* proxy = track.signalProxy();
+
+    if ( m_lovedKeys.contains( proxy ) )
+        return;
+
+    m_lovedKeys[proxy] = key;
+    connect( proxy, SIGNAL(loveToggled(bool)), SLOT(onLoveToggled(bool)) );
+    connect( proxy, SIGNAL(destroyed(QObject*)), SLOT(onTrackDestroyed(QObject*)) );
+}
+
+/** Keeps the user's loved state in the track.getInfo responses we have honest,
+  * the widgets set it on their tracks from the response */
+void
+MetadataService::onLoveToggled( bool loved )
+{
+    QString const key = m_lovedKeys.value( sender() );
+
+    if ( Entry* entry = m_cache.object( key ) )
+        entry->data = withUserLoved( entry->data, loved );
+
+    for ( QHash<QNetworkReply*, Fetch>::iterator i = m_fetches.begin() ; i != m_fetches.end() ; ++i )
+        if ( i->key == key )
+            i->loved = loved;
+}
+
+void
+MetadataService::onTrackDestroyed( QObject* signalProxy )
+{
+    m_lovedKeys.remove( signalProxy );
+}
+
+static bool
+isSameTrack( const Track& a, const Track& b )
+{
+    return !a.isNull() && !b.isNull()
+            && a.artist().name().compare( b.artist().name(), Qt::CaseInsensitive ) == 0
+            && a.title().compare( b.title(), Qt::CaseInsensitive ) == 0;
+}
+
+void
+MetadataService::prefetch( const lastfm::Track& track )
+{
+    if ( track.isNull() || isSameTrack( track, ScrobbleService::instance().currentTrack() ) )
+        return;
+
+    m_prefetchTrack = track;
+    m_prefetchTimer.start();
+}
+
+void
+MetadataService::onTrackStarted( const lastfm::Track& track )
+{
+    if ( isSameTrack( track, m_prefetchedTrack ) )
+        ++m_prefetchHits;
+
+    // it's not a prefetch any more
+    if ( isSameTrack( track, m_prefetchTrack ) )
+        m_prefetchTrack = Track();
+
+    m_prefetchedTrack = Track();
+
+    emit statsChanged();
+}
+
+/** Makes the calls MetadataWidget will make, nobody is waiting for the replies
+  * so they just fill the cache */
+void
+MetadataService::startPrefetch()
+{
+    if ( m_prefetchTrack.isNull() || !m_fetches.isEmpty() )
+        return;
+
+    Track const track = m_prefetchTrack;
+    m_prefetchTrack = Track();
+    m_prefetchedTrack = track;
+    ++m_prefetched;
+
+    connect( get( TrackGetInfo, track ), SIGNAL(finished()), SLOT(onPrefetchedTrackInfo()) );
+
+    if ( !track.album().isNull() )
+        connect( get( AlbumGetInfo, track ), SIGNAL(finished()), SLOT(onPrefetchedAlbumInfo()) );
+
+    connect( get( ArtistGetInfo, track ), SIGNAL(finished()), SLOT(onPrefetchedArtistInfo()) );
+
+    get( TrackGetTags, track );
+    get( ArtistGetTags, track );
+    get( ArtistGetEvents, track );
+    get( TrackGetBuyLinks, track );
+
+    emit statsChanged();
+}
+
+void
+MetadataService::prefetchImage( const QString& url )
+{
+    if ( url.isEmpty() )
+        return;
+
+    unicorn::ImageReply* reply = unicorn::ImageCache::instance().get( QUrl( url ) );
+    connect( reply, SIGNAL(finished()), reply, SLOT(deleteLater()) );
+}
+
+void
+MetadataService::onPrefetchedTrackInfo()
+{
+    MetadataReply* reply = qobject_cast<MetadataReply*>( sender() );
+
+    XmlQuery lfm;
+
+    // MetadataWidget shows this when it doesn't know the album
+    if ( reply->track().album().isNull() && lfm.parse( reply->data() ) )
+        prefetchImage( lfm["track"]["album"]["image size=medium"].text() );
+}
+
+void
+MetadataService::onPrefetchedAlbumInfo()
+{
+    XmlQuery lfm;
+
+    if ( lfm.parse( qobject_cast<MetadataReply*>( sender() )->data() ) )
+    {
+        // the metadata panel's and the now playing bar's
+        prefetchImage( lfm["album"]["image size=large"].text() );
+        prefetchImage( lfm["album"]["image size=medium"].text() );
+    }
+}
+
+void
+MetadataService::onPrefetchedArtistInfo()
+{
+    XmlQuery lfm;
+
+    if ( lfm.parse( qobject_cast<MetadataReply*>( sender() )->data() ) )
+    {
+        prefetchImage( lfm["artist"]["image size=extralarge"].text() );
+
+        // the similar artists, with the url rewritten as MetadataWidget does
+        QRegExp re( "/serve/(\\d*)s?/" );
+
+        foreach ( const XmlQuery& artist, lfm["artist"]["similar"].children( "artist" ).mid( 0, 4 ) )
+            prefetchImage( artist["image size=medium"].text().replace( re, "/serve/\\1s/" ) );
+    }
+}
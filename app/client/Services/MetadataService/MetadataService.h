@@ -0,0 +1,170 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METADATA_SERVICE_H
+#define METADATA_SERVICE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include <lastfm/Track.h>
+
+class QNetworkReply;
+
+/** What MetadataService::get() gives you. It emits finished() once, never
+  * before get() has returned, and deletes itself after that, so just
+  * connect to it and read it in your slot. */
+class MetadataReply : public QObject
+{
+    Q_OBJECT
+public:
+    /** the track it was asked for */
+    lastfm::Track track() const { return m_track; }
+
+    /** the web service response, which may be an error response */
+    QByteArray data() const { return m_data; }
+
+    /** How many of the user's scrobbles of this artist, or of this track
+      * for track.getInfo, were submitted after the response was fetched.
+      * Add it to the play counts in the response. */
+    int scrobbledSince() const { return m_scrobbledSince; }
+
+signals:
+    void finished();
+
+private:
+    friend class MetadataService;
+
+    MetadataReply( const lastfm::Track& track, QObject* parent );
+    void finish( const QByteArray& data, int scrobbledSince );
+
+private:
+    lastfm::Track m_track;
+    QByteArray m_data;
+    int m_scrobbledSince;
+};
+
+
+/** The web service calls about a track that the metadata panels make.
+  *
+  * Responses are kept for a while, keyed by the method, artist, album, track
+  * and user, so playing through an album asks about its artist once. Any
+  * number of gets that are the same as one in flight wait on that one call.
+  * Failed calls aren't kept. When a track that was asked about is loved or
+  * unloved, its track.getInfo response is patched to match.
+  *
+  * It can also fetch everything about the track the player says is next,
+  * and that track's images, while nothing else is being fetched, so the
+  * panel has it all when the track starts.
+  */
+class MetadataService : public QObject
+{
+    Q_OBJECT
+public:
+    enum Method
+    {
+        TrackGetInfo,
+        AlbumGetInfo,
+        ArtistGetInfo,
+        TrackGetTags,
+        ArtistGetTags,
+        ArtistGetEvents,
+        TrackGetBuyLinks
+    };
+
+    static MetadataService& instance();
+
+    /** For the current user. For TrackGetBuyLinks that means their country. */
+    MetadataReply* get( Method method, const lastfm::Track& track );
+
+    /** how many tracks were prefetched, and how many of those then played */
+    int prefetched() const { return m_prefetched; }
+    int prefetchHits() const { return m_prefetchHits; }
+
+public slots:
+    /** Replaces any prefetch that hasn't started yet */
+    void prefetch( const lastfm::Track& track );
+
+signals:
+    void statsChanged();
+
+private slots:
+    void onFetched();
+    void onScrobblesSubmitted( const QList<lastfm::Track>& tracks );
+    void onTrackStarted( const lastfm::Track& track );
+    void onLoveToggled( bool loved );
+    void onTrackDestroyed( QObject* signalProxy );
+
+    void startPrefetch();
+    void onPrefetchedTrackInfo();
+    void onPrefetchedAlbumInfo();
+    void onPrefetchedArtistInfo();
+
+private:
+    MetadataService();
+
+    struct Entry
+    {
+        Method method;
+        QString artist;
+        QString track;
+        QByteArray data;
+        QDateTime expires;
+        int scrobbledSince;
+    };
+
+    static QString key( Method method, const lastfm::Track& track );
+    static int timeToLive( Method method );
+    static QNetworkReply* call( Method method, const lastfm::Track& track );
+
+    Entry* entry( const QString& key );
+    void deliver( const QString& key, const QByteArray& data, int scrobbledSince );
+    void watchLoved( const lastfm::Track& track, const QString& key );
+    void prefetchImage( const QString& url );
+
+private:
+    QCache<QString, Entry> m_cache;
+
+    struct Fetch
+    {
+        QString key;
+        Entry entry;
+        int loved; // -1 unless the track was loved or unloved in flight
+    };
+
+    QHash<QNetworkReply*, Fetch> m_fetches;
+    QHash<QString, QList<QPointer<MetadataReply> > > m_waiting;
+
+    // the track.getInfo key of each track we watch for love and unlove
+    QHash<const QObject*, QString> m_lovedKeys;
+
+    QTimer m_prefetchTimer;
+    lastfm::Track m_prefetchTrack; // waiting for its turn
+    lastfm::Track m_prefetchedTrack; // the last one we fetched
+    int m_prefetched;
+    int m_prefetchHits;
+};
+
+#endif // METADATA_SERVICE_H
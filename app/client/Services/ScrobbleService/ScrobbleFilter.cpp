@@ -0,0 +1,129 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ScrobbleFilter.h"
+
+#include <QDir>
+#include <lastfm/Track.h>
+
+#include "lib/unicorn/UnicornSettings.h"
+
+
+ScrobbleFilter::ScrobbleFilter()
+    : m_nodes( 1 )
+    , m_scrobblingOn( true )
+    , m_podcasts( true )
+    , m_scrobblePoint( 50 )
+    , m_enforceScrobbleTimeMax( true )
+{
+}
+
+
+ScrobbleFilter::ScrobbleFilter( const unicorn::UserSettings& settings )
+    : m_nodes( 1 )
+    , m_scrobblingOn( settings.scrobblingOn() )
+    , m_podcasts( settings.podcasts() )
+    , m_scrobblePoint( settings.scrobblePoint() )
+    , m_enforceScrobbleTimeMax( settings.enforceScrobbleTimeMax() )
+{
+    foreach ( const QString& dir, settings.exclusionDirs() )
+        if ( !dir.isEmpty() )
+            addExclusion( dir );
+}
+
+
+void
+ScrobbleFilter::addExclusion( QString dir )
+{
+    dir = QDir::cleanPath( QDir( dir ).absolutePath() );
+#ifdef Q_OS_WIN
+    dir = dir.toLower();
+#endif
+
+    // "/music/" and "/music" are the same dir, we check for the '/' ourselves
+    if ( dir.endsWith( '/' ) )
+        dir.chop( 1 );
+
+    int node = 0;
+    for ( int i = 0 ; i < dir.length() ; ++i )
+    {
+        ushort const c = dir[i].unicode();
+        int next = m_nodes[node].children.value( c, -1 );
+
+        if ( next == -1 )
+        {
+            next = m_nodes.size();
+            m_nodes[node].children.insert( c, next );
+            m_nodes.append( Node() );
+        }
+
+        node = next;
+    }
+
+    m_nodes[node].terminal = true;
+}
+
+
+bool
+ScrobbleFilter::isDirExcluded( const lastfm::Track& track ) const
+{
+    return isDirExcluded( track.url().toLocalFile() );
+}
+
+
+bool
+ScrobbleFilter::isDirExcluded( const QString& path ) const
+{
+    // a root that is an exclusion itself means "/" was excluded
+    if ( path.isEmpty() || ( m_nodes.count() == 1 && !m_nodes[0].terminal ) )
+        return false;
+
+    int node = 0;
+    for ( int i = 0 ; i <= path.length() ; ++i )
+    {
+        // a match only counts at the end of a path component
+        // so that excluding /music/foo doesn't exclude /music/foobar
+        if ( m_nodes[node].terminal && ( i == path.length() || path[i] == '/' ) )
+            return true;
+
+        if ( i == path.length() )
+            break;
+
+#ifdef Q_OS_WIN
+        ushort const c = path[i].toLower().unicode();
+#else
+        ushort const c = path[i].unicode();
+#endif
+        node = m_nodes[node].children.value( c, -1 );
+
+        if ( node == -1 )
+            break;
+    }
+
+    return false;
+}
+
+
+bool
+ScrobbleFilter::accepts( const lastfm::Track& track ) const
+{
+    return !track.artist().isNull()
+            && ( m_podcasts || !track.isPodcast() )
+            && !track.isVideo()
+            && !isDirExcluded( track );
+}
@@ -0,0 +1,71 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SCROBBLE_FILTER_H
+#define SCROBBLE_FILTER_H
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+namespace lastfm { class Track; }
+namespace unicorn { class UserSettings; }
+
+/** A snapshot of the scrobble settings of a user, compiled so that deciding
+  * if a track should be scrobbled doesn't need QSettings at all.
+  *
+  * The exclusion dirs are kept in a prefix trie, so checking a path is
+  * O(path length) whatever the number of excluded dirs. It's a value type
+  * and only reads after construction, so it can be copied to other threads. */
+class ScrobbleFilter
+{
+public:
+    /** scrobbles everything, excludes nothing */
+    ScrobbleFilter();
+    explicit ScrobbleFilter( const unicorn::UserSettings& );
+
+    bool scrobblingOn() const { return m_scrobblingOn; }
+    bool podcasts() const { return m_podcasts; }
+    double scrobblePoint() const { return m_scrobblePoint; }
+    bool enforceScrobbleTimeMax() const { return m_enforceScrobbleTimeMax; }
+
+    /** the checks we apply to all tracks, from players and devices */
+    bool accepts( const lastfm::Track& ) const;
+
+    bool isDirExcluded( const lastfm::Track& ) const;
+    bool isDirExcluded( const QString& path ) const;
+
+private:
+    void addExclusion( QString dir );
+
+    struct Node
+    {
+        Node() : terminal( false ) {}
+        QHash<ushort, int> children; // index into m_nodes
+        bool terminal; // an excluded dir ends here
+    };
+
+    QVector<Node> m_nodes; // m_nodes[0] is the root
+
+    bool m_scrobblingOn;
+    bool m_podcasts;
+    double m_scrobblePoint;
+    bool m_enforceScrobbleTimeMax;
+};
+
+#endif // SCROBBLE_FILTER_H
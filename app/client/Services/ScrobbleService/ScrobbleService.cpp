@@ -79,6 +79,7 @@ ScrobbleService::ScrobbleService()
     }
 
     connect( aApp, SIGNAL(sessionChanged(unicorn::Session)), SLOT(onSessionChanged(unicorn::Session)) );
+    m_filter = ScrobbleFilter( unicorn::UserSettings() );
     resetScrobbler();
 }
 
@@ -93,50 +94,15 @@ ScrobbleService::instance()
 bool
 ScrobbleService::isDirExcluded( const lastfm::Track& track )
 {
-    QString pathToTest = track.url().toLocalFile();
-
-#ifdef Q_OS_WIN
-    pathToTest = pathToTest.toLower();
-#endif
-
-    if ( pathToTest.isEmpty() )
-        return false;
-
-    unicorn::UserSettings us;
-    QStringList exculsionDirs = us.value( "ExclusionDirs" ).toStringList();
-
-    foreach ( QString bannedPath, exculsionDirs )
-    {
-        bannedPath = QDir( bannedPath ).absolutePath();
-#ifdef Q_OS_WIN
-        bannedPath = bannedPath.toLower();
-#endif
-
-        qDebug() << pathToTest << bannedPath;
-
-        // Try and match start of given path with banned dir
-        if ( pathToTest.startsWith( bannedPath ) )
-        {
-            // Found, this path is from a banned dir
-            return true;
-        }
-    }
-
-    // The path wasn't found in exclusions list
-    return false;
+    return instance().filter().isDirExcluded( track );
 }
 
 bool
 ScrobbleService::scrobblableTrack( const lastfm::Track& track ) const
 {
-    unicorn::UserSettings userSettings;
-
-    return userSettings.scrobblingOn()
+    return m_filter.scrobblingOn()
             && ( track.extra( "playerId" ) != "spt" && track.extra( "playerId" ) != "mpris2" )
-            && !track.artist().isNull()
-            && ( userSettings.podcasts() || !track.isPodcast() )
-            && !track.isVideo()
-            && !isDirExcluded( track );
+            && m_filter.accepts( track );
 }
 
 bool
@@ -148,10 +114,12 @@ ScrobbleService::scrobblingOn() const
 void
 ScrobbleService::scrobbleSettingsChanged()
 {
+    m_filter = ScrobbleFilter( unicorn::UserSettings() );
+
     if ( m_watch )
     {
-        ScrobblePoint timeout( ( m_currentTrack.duration() * unicorn::UserSettings().scrobblePoint() ) / 100.0 );
-        timeout.setEnforceScrobbleTimeMax( unicorn::UserSettings().enforceScrobbleTimeMax() );
+        ScrobblePoint timeout( ( m_currentTrack.duration() * m_filter.scrobblePoint() ) / 100.0 );
+        timeout.setEnforceScrobbleTimeMax( m_filter.enforceScrobbleTimeMax() );
         m_watch->setScrobblePoint( timeout );
     }
 
@@ -178,6 +146,8 @@ ScrobbleService::submitCache()
 void 
 ScrobbleService::onSessionChanged( const unicorn::Session& )
 {
+    // a different user has different settings
+    m_filter = ScrobbleFilter( unicorn::UserSettings() );
     resetScrobbler();
 }
 
@@ -234,6 +204,7 @@ ScrobbleService::setConnection(PlayerConnection*c)
     connect(c, SIGNAL(paused()), this, SLOT(onPaused()), Qt::QueuedConnection);
     connect(c, SIGNAL(resumed()), this, SLOT(onResumed()), Qt::QueuedConnection);
     connect(c, SIGNAL(stopped()), this, SLOT(onStopped()), Qt::QueuedConnection);
+    connect(c, SIGNAL(nextTrackChanged(lastfm::Track)), this, SIGNAL(nextTrackChanged(lastfm::Track)), Qt::QueuedConnection);
     connect(c, SIGNAL(bootstrapReady(QString)), SIGNAL( bootstrapReady(QString)));
 
     m_connection = c;
@@ -259,7 +230,7 @@ ScrobbleService::onTrackStarted( const lastfm::Track& t, const lastfm::Track& ot
 
     Track oldtrack = ot.isNull() ? m_currentTrack : ot;
 
-    if ( unicorn::UserSettings().scrobblePoint() == 100.0 && !oldtrack.isNull() )
+    if ( m_filter.scrobblePoint() == 100.0 && !oldtrack.isNull() )
     {
         // was the last track at 100%? Should we scrobble it?
 
@@ -289,15 +260,14 @@ ScrobbleService::onTrackStarted( const lastfm::Track& t, const lastfm::Track& ot
     m_state = Playing;
     m_currentTrack = t;
 
-    ScrobblePoint timeout( ( m_currentTrack.duration() * unicorn::UserSettings().scrobblePoint() ) / 100.0 );
-    timeout.setEnforceScrobbleTimeMax( unicorn::UserSettings().enforceScrobbleTimeMax() );
+    ScrobblePoint timeout( ( m_currentTrack.duration() * m_filter.scrobblePoint() ) / 100.0 );
+    timeout.setEnforceScrobbleTimeMax( m_filter.enforceScrobbleTimeMax() );
     delete m_watch;
     m_watch = new StopWatch(m_currentTrack.duration(), timeout);
     m_watch->start();
 
     connect( m_watch, SIGNAL(scrobble()), SLOT(onScrobble()));
     connect( m_watch, SIGNAL(paused(bool)), SIGNAL(paused(bool)));
-    connect( m_watch, SIGNAL(frameChanged( int )), SIGNAL(frameChanged( int )));
     connect( m_watch, SIGNAL(timeout()), SIGNAL(timeout()));
 
     qDebug() << "********** AS = " << m_as;
@@ -24,6 +24,7 @@
 #include <QPointer>
 
 #include "lib/listener/State.h"
+#include "ScrobbleFilter.h"
 
 #include <lastfm/Audioscrobbler.h>
 #include <lastfm/Track.h>
@@ -44,6 +45,9 @@ public:
     bool scrobblableTrack( const lastfm::Track& track ) const;
     static bool isDirExcluded( const lastfm::Track& track );
 
+    /** the current user's scrobble settings, updated by scrobbleSettingsChanged() */
+    const ScrobbleFilter& filter() const { return m_filter; }
+
     Track currentTrack() const { return m_currentTrack; }
     QPointer<DeviceScrobbler> deviceScrobbler() { return m_deviceScrobbler; }
     QPointer<PlayerConnection> currentConnection() { return m_connection; }
@@ -61,6 +65,8 @@ public slots:
 
 signals:
     void trackStarted( const lastfm::Track& newTrack, const lastfm::Track& oldTrack );
+    /** the player's guess at what it will play next, null if it has none */
+    void nextTrackChanged( const lastfm::Track& nextTrack );
     void resumed();
     void paused();
     void stopped();
@@ -72,7 +78,6 @@ signals:
     void bootstrapReady( const QString& playerId );
 
     void paused( bool );
-    void frameChanged( int );
     void timeout();
 
 public slots:
@@ -101,6 +106,7 @@ protected:
     QPointer <DeviceScrobbler> m_deviceScrobbler;
     Track m_currentTrack;
     QString m_currentUsername;
+    ScrobbleFilter m_filter;
 };
 
 
@@ -18,20 +18,25 @@
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "StopWatch.h"
-#include <QTimeLine>
+#include <QTimer>
 
 
 StopWatch::StopWatch( uint duration, ScrobblePoint timeout )
-    : m_duration( duration ), m_point( timeout ), m_scrobbled(false)
+    : m_banked( 0 )
+    , m_started( false )
+    , m_running( false )
+    , m_finished( false )
+    , m_duration( duration )
+    , m_point( timeout )
+    , m_scrobbled( false )
 {    
-    m_timeline = new QTimeLine( duration * 1000, this );
-    m_timeline->setFrameRange( 0, duration * 2 );
-    m_timeline->setEasingCurve( QEasingCurve::Linear );
-    m_timeline->setUpdateInterval( 50 );
-    m_timeline->setCurrentTime( 0 );
-
-    connect( m_timeline, SIGNAL(finished()), SIGNAL(timeout()) );
-    connect( m_timeline, SIGNAL(frameChanged(int)), SLOT(onFrameChanged(int)));
+    m_scrobbleTimer = new QTimer( this );
+    m_scrobbleTimer->setSingleShot( true );
+    connect( m_scrobbleTimer, SIGNAL(timeout()), SLOT(onScrobbleTimeout()) );
+
+    m_endTimer = new QTimer( this );
+    m_endTimer->setSingleShot( true );
+    connect( m_endTimer, SIGNAL(timeout()), SLOT(onEndTimeout()) );
 }
 
 ScrobblePoint
@@ -44,6 +49,7 @@ void
 StopWatch::setScrobblePoint( const ScrobblePoint& timeout_in_seconds )
 {
     m_point = timeout_in_seconds;
+    arm();
 }
 
 uint
@@ -59,34 +65,86 @@ StopWatch::scrobbled() const
 }
 
 void
-StopWatch::onFrameChanged( int /*frame*/ )
+StopWatch::arm()
+{
+    m_scrobbleTimer->stop();
+    m_endTimer->stop();
+
+    if ( !m_running )
+        return;
+
+    qint64 const now = elapsed();
+
+    if ( !m_scrobbled )
+        m_scrobbleTimer->start( qMax<qint64>( 0, qint64( m_point ) * 1000 - now ) );
+
+    m_endTimer->start( qMax<qint64>( 0, qint64( m_duration ) * 1000 - now ) );
+}
+
+void
+StopWatch::onScrobbleTimeout()
 {
-    emit frameChanged( m_timeline->currentTime() );
+    if ( m_scrobbled )
+        return;
 
-    if ( !m_scrobbled && elapsed() >= (m_point * 1000) )
+    if ( elapsed() >= (m_point * 1000) )
     {
         emit scrobble();
         m_scrobbled = true;
     }
+    else
+        // timers aren't exact, go round again for the last few ms
+        arm();
+}
+
+void
+StopWatch::onEndTimeout()
+{
+    if ( elapsed() < m_duration * 1000 )
+    {
+        arm();
+        return;
+    }
+
+    // we might have got here before the scrobble timer
+    onScrobbleTimeout();
+
+    m_banked = qint64( m_duration ) * 1000;
+    m_running = false;
+    m_finished = true;
+    arm();
+
+    emit timeout();
 }
 
 bool
 StopWatch::paused()
 {
-    return (m_timeline->state() == QTimeLine::Paused);
+    return m_started && !m_running && !m_finished;
 }
 
 void
 StopWatch::start()
 {
-    m_timeline->start();
+    m_started = true;
+    m_running = true;
+    m_finished = false;
+    m_banked = 0;
+    m_clock.start();
+    arm();
     emit paused( false );
 }
 
 void
 StopWatch::pause()
 {
-    m_timeline->setPaused( true );
+    if ( m_running )
+    {
+        m_banked += m_clock.elapsed();
+        m_running = false;
+        arm();
+    }
+
     emit paused( true );
 }
 
@@ -94,13 +152,18 @@ void
 StopWatch::resume()
 {
     // Only resume if we are already running
-    if ( m_timeline->state() == QTimeLine::Paused )
-        m_timeline->resume();
+    if ( paused() )
+    {
+        m_running = true;
+        m_clock.start();
+        arm();
+    }
     emit paused( false );
 }
 
 uint
 StopWatch::elapsed() const
 {
-    return m_timeline->currentTime();
+    qint64 const ms = m_banked + ( m_running ? m_clock.elapsed() : 0 );
+    return qMin<qint64>( ms, qint64( m_duration ) * 1000 );
 }
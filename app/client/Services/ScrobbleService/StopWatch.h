@@ -21,14 +21,18 @@
 #define STOP_WATCH_H
 
 #include <lastfm/ScrobblePoint.h>
-#include <QDateTime>
+#include <QElapsedTimer>
 #include <QObject>
 
 namespace audioscrobbler { class Application; }
 
 /** Emits timeout() after seconds specified to start. 
   * Continues to measure time after that point until object death.
-  */
+  *
+  * Time is measured with a monotonic clock, the only timers are a single
+  * shot for the scrobble point and one for the end of the track, so we don't
+  * wake up while a track plays. If you show progress, poll elapsed() while
+  * your widget is visible. */
 class StopWatch : public QObject
 {
     Q_OBJECT
@@ -59,18 +63,26 @@ public:
     
 signals:
     void paused( bool );
-    void frameChanged( int millisecs );
     void scrobble();
     void timeout();
 
 private slots:
-    void onFrameChanged( int frame );
+    void onScrobbleTimeout();
+    void onEndTimeout();
 
 private:
     bool scrobbled() const;
+    /** starts the timers for whatever is still to come */
+    void arm();
 
 private: 
-    class QTimeLine* m_timeline;
+    class QTimer* m_scrobbleTimer;
+    class QTimer* m_endTimer;
+    QElapsedTimer m_clock; // since we last started or resumed
+    qint64 m_banked; // ms we ran for before that
+    bool m_started;
+    bool m_running;
+    bool m_finished;
     uint m_duration;
     ScrobblePoint m_point;
     bool m_scrobbled;
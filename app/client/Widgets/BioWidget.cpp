@@ -21,7 +21,6 @@
 #include <QEventLoop>
 #include <QApplication>
 #include <QToolTip>
-#include <QTimer>
 #include <QDebug>
 
 #include "lib/unicorn/widgets/BannerWidget.h"
@@ -35,7 +34,8 @@
 
 BioWidget::BioWidget( QWidget* p ) 
     :QTextBrowser( p ),
-      m_currentHoverWidget(0)
+      m_currentHoverWidget(0),
+      m_heightPending( false )
 {
     setVerticalScrollBarPolicy( Qt::ScrollBarAlwaysOff );
     connect(document()->documentLayout(), SIGNAL( documentSizeChanged(QSizeF)), SLOT( onBioChanged(QSizeF)));
@@ -84,11 +84,19 @@ BioWidget::onHighlighted( const QString& url )
 void
 BioWidget::onImageLoaded()
 {
-    insertWidget( ui.onTour );
+    // the image widget is drawn in place, so the document only needs
+    // building and laying out again when the bio itself is different
+    if ( m_documentBioText.isNull() || m_documentBioText != m_bioText )
+    {
+        if ( !m_documentBioText.isNull() )
+            clear();
+
+        insertWidget( ui.onTour );
+        append( m_bioText );
 
-    append( m_bioText );
+        m_documentBioText = m_bioText;
+    }
 
-    updateGeometry();
     emit finished();
 }
 
@@ -191,16 +199,12 @@ BioWidget::sendMouseEvent( QMouseEvent* event )
 }
 
 void
-BioWidget::showEvent( QShowEvent* /*event*/ )
+BioWidget::showEvent( QShowEvent* event )
 {
-    // HACK: onBioChanged reports the wrong size for the document
-    // and id we polish it a bit later it gets set correctly.
-    // Polish very soon after being shown so that it gets
-    // the right height quickly if you're looking at it.
-    // Do another polish a bit later as for the case when you
-    // switch to that tab as the first one won't work.
-    QTimer::singleShot( 1, this, SLOT(polish()));
-    QTimer::singleShot( 200, this, SLOT(polish()));
+    QTextBrowser::showEvent( event );
+
+    // we don't follow the document's size while we're hidden
+    onBioChanged( document()->size() );
 }
 
 void 
@@ -211,27 +215,32 @@ BioWidget::onAnchorClicked( const QUrl& link )
 }
 
 
-void
-BioWidget::onDocumentLayoutChanged()
-{
-    setFixedHeight( document()->size().height() );
-}
-
 void 
 BioWidget::onBioChanged( const QSizeF& /*size*/ )
 {
-    updateGeometry();
-
-    onDocumentLayoutChanged();
+    // the document changes size a lot while it's built and laid out, and
+    // again whenever our width changes, only fit it once that settles
+    if ( !m_heightPending )
+    {
+        m_heightPending = true;
+        QMetaObject::invokeMethod( this, "updateHeight", Qt::QueuedConnection );
+    }
 }
 
 void
-BioWidget::polish()
+BioWidget::updateHeight()
 {
-    if ( isVisible() )
-        style()->polish( this );
-    else
-        QTimer::singleShot( 20, this, SLOT(polish()));
+    m_heightPending = false;
+
+    // showEvent calls us again, at the width we're shown at
+    if ( !isVisible() )
+        return;
+
+    int const height = document()->size().height();
+
+    // this relayouts the whole metadata panel, so only when it's needed
+    if ( height != minimumHeight() || height != maximumHeight() )
+        setFixedHeight( height );
 }
 
 void
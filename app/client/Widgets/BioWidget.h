@@ -56,8 +56,7 @@ protected slots:
 
     void onImageLoaded();
 
-    void onDocumentLayoutChanged();
-    void polish();
+    void updateHeight();
 
 protected:
     void insertWidget( QWidget* w );
@@ -66,7 +65,7 @@ protected:
     void mousePressEvent( QMouseEvent* event );
     void mouseReleaseEvent( QMouseEvent* event );
     void mouseMoveEvent( QMouseEvent* event );
-    void showEvent(QShowEvent *);
+    void showEvent( QShowEvent* event );
 
     bool sendMouseEvent( QMouseEvent* event );
 
@@ -75,6 +74,8 @@ protected:
     QWidget* m_currentHoverWidget;
 
     QString m_bioText;
+    QString m_documentBioText; // the bio the document has in it
+    bool m_heightPending;
 
     QTextImageFormat m_widgetImageFormat;
 
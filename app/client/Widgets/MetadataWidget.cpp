@@ -25,6 +25,7 @@
 #include "../Application.h"
 #include "../Services/ScrobbleService.h"
 #include "../Services/AnalyticsService.h"
+#include "../Services/MetadataService.h"
 #include "ScrobbleControls.h"
 #include "BioWidget.h"
 #include "TagWidget.h"
@@ -129,24 +130,22 @@ MetadataWidget::fetchTrackInfo( bool force )
 
         m_numCalls = m_track.album().isNull() ? 6: 7;
 
-        QString username = User().name();
+        // the service answers the calls about this artist and album that an
+        // earlier track already made without asking the web service again
+        MetadataService& metadata = MetadataService::instance();
 
-        qWarning() << username;
-
-        // fetch Track info
-        m_track.getInfo( this, "onTrackGotInfo", username );
+        connect( metadata.get( MetadataService::TrackGetInfo, m_track ), SIGNAL(finished()), SLOT(onTrackGotInfo()));
 
         if( !m_track.album().isNull() )
-            connect( m_track.album().getInfo( username ), SIGNAL(finished()), SLOT(onAlbumGotInfo()));
+            connect( metadata.get( MetadataService::AlbumGetInfo, m_track ), SIGNAL(finished()), SLOT(onAlbumGotInfo()));
 
-        connect( m_track.artist().getInfo( username ), SIGNAL(finished()), SLOT(onArtistGotInfo()));
+        connect( metadata.get( MetadataService::ArtistGetInfo, m_track ), SIGNAL(finished()), SLOT(onArtistGotInfo()));
 
-        connect( m_track.getTags(), SIGNAL(finished()), SLOT(onTrackGotYourTags()));
-        connect( m_track.artist().getTags(), SIGNAL(finished()), SLOT(onArtistGotYourTags()));
-        connect( m_track.artist().getEvents(), SIGNAL(finished()), SLOT(onArtistGotEvents()));
+        connect( metadata.get( MetadataService::TrackGetTags, m_track ), SIGNAL(finished()), SLOT(onTrackGotYourTags()));
+        connect( metadata.get( MetadataService::ArtistGetTags, m_track ), SIGNAL(finished()), SLOT(onArtistGotYourTags()));
+        connect( metadata.get( MetadataService::ArtistGetEvents, m_track ), SIGNAL(finished()), SLOT(onArtistGotEvents()));
 
-        QString country = aApp->currentSession().user().country();
-        connect( m_track.getBuyLinks( country ), SIGNAL(finished()), SLOT(onTrackGotBuyLinks()) );
+        connect( metadata.get( MetadataService::TrackGetBuyLinks, m_track ), SIGNAL(finished()), SLOT(onTrackGotBuyLinks()) );
     }
 }
 
@@ -205,15 +204,16 @@ MetadataWidget::setTrackDetails( const Track& track )
 void
 MetadataWidget::onArtistGotInfo()
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    MetadataReply* reply = qobject_cast<MetadataReply*>(sender());
 
     XmlQuery lfm;
 
-    if ( lfm.parse( reply ) )
+    if ( lfm.parse( reply->data() ) )
     {
-        m_globalArtistScrobbles = lfm["artist"]["stats"]["playcount"].text().toInt();
+        // the response may be from before some of the user's scrobbles
+        m_globalArtistScrobbles = lfm["artist"]["stats"]["playcount"].text().toInt() + reply->scrobbledSince();
         m_artistListeners = lfm["artist"]["stats"]["listeners"].text().toInt();
-        m_userArtistScrobbles = lfm["artist"]["stats"]["userplaycount"].text().toInt();
+        m_userArtistScrobbles = lfm["artist"]["stats"]["userplaycount"].text().toInt() + reply->scrobbledSince();
 
         ui->artistPlays->setText( tr( "%L1" ).arg( m_globalArtistScrobbles ) );
         ui->artistUserPlays->setText( tr( "%L1" ).arg( m_userArtistScrobbles ) );
@@ -321,11 +321,11 @@ MetadataWidget::onArtistGotInfo()
 void
 MetadataWidget::onArtistGotYourTags()
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    MetadataReply* reply = qobject_cast<MetadataReply*>(sender());
 
     XmlQuery lfm;
 
-    if ( lfm.parse( reply ) )
+    if ( lfm.parse( reply->data() ) )
     {
         QList<XmlQuery> tags = lfm["tags"].children("tag").mid(0, 5);
 
@@ -358,10 +358,10 @@ MetadataWidget::onArtistGotYourTags()
 void
 MetadataWidget::onArtistGotEvents()
 {
-   QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+   MetadataReply* reply = qobject_cast<MetadataReply*>(sender());
 
    XmlQuery lfm;
-   if ( lfm.parse( reply ) )
+   if ( lfm.parse( reply->data() ) )
    {
 
        if (lfm["events"].children("event").count() > 0)
@@ -384,7 +384,7 @@ MetadataWidget::onAlbumGotInfo()
 {
     XmlQuery lfm;
 
-    if ( lfm.parse( qobject_cast<QNetworkReply*>(sender()) ) )
+    if ( lfm.parse( qobject_cast<MetadataReply*>(sender())->data() ) )
     {
 //        int scrobbles = lfm["album"]["playcount"].text().toInt();
 //        int listeners = lfm["album"]["listeners"].text().toInt();
@@ -406,7 +406,7 @@ MetadataWidget::onTrackGotBuyLinks()
 {
     XmlQuery lfm;
 
-    if ( lfm.parse( qobject_cast<QNetworkReply*>(sender()) ) )
+    if ( lfm.parse( qobject_cast<MetadataReply*>(sender())->data() ) )
     {
         bool thingsToBuy = false;
 
@@ -473,16 +473,19 @@ MetadataWidget::onBuyActionTriggered( QAction* buyAction )
 }
 
 void
-MetadataWidget::onTrackGotInfo( const QByteArray& data )
+MetadataWidget::onTrackGotInfo()
 {
+    MetadataReply* reply = qobject_cast<MetadataReply*>(sender());
+
     XmlQuery lfm;
 
-    if ( lfm.parse( data ) )
+    if ( lfm.parse( reply->data() ) )
     {
-        m_globalTrackScrobbles = lfm["track"]["playcount"].text().toInt();
+        // the response may be from before some of the user's scrobbles
+        m_globalTrackScrobbles = lfm["track"]["playcount"].text().toInt() + reply->scrobbledSince();
         //int listeners = lfm["track"]["listeners"].text().toInt();
         if ( lfm["track"]["userplaycount"].text().length() > 0 )
-            m_userTrackScrobbles = lfm["track"]["userplaycount"].text().toInt();
+            m_userTrackScrobbles = lfm["track"]["userplaycount"].text().toInt() + reply->scrobbledSince();
 
         // Update the context now that we have the user track listens
         ui->context->setText( contextString( m_track ) );
@@ -490,7 +493,11 @@ MetadataWidget::onTrackGotInfo( const QByteArray& data )
         ui->albumImage->setHref( lfm["track"]["url"].text());
 
         if ( lfm["track"]["userloved"].text().length() > 0 )
+        {
+            // Track::getInfo used to do this for us
+            MutableTrack( m_track ).setLoved( lfm["track"]["userloved"].text() == "1" );
             ui->scrobbleControls->setLoveChecked( lfm["track"]["userloved"].text() == "1" );
+        }
 
         // get the popular tags
         QList<XmlQuery> tags = lfm["track"]["toptags"].children("tag").mid( 0, 5 );
@@ -533,7 +540,7 @@ MetadataWidget::onTrackGotYourTags()
 {
     XmlQuery lfm;
 
-    if ( lfm.parse( qobject_cast<QNetworkReply*>(sender()) ) )
+    if ( lfm.parse( qobject_cast<MetadataReply*>(sender())->data() ) )
     {
         QList<XmlQuery> tags = lfm["tags"].children("tag").mid(0, 5);
 
@@ -56,7 +56,7 @@ public:
     static QString getContextString( const Track& track );
 
 private slots:
-    void onTrackGotInfo(const QByteArray& data);
+    void onTrackGotInfo();
     void onAlbumGotInfo();
     void onArtistGotInfo();
     void onArtistGotEvents();
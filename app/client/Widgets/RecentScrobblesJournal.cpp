@@ -0,0 +1,276 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDomDocument>
+#include <QFile>
+#include <QMap>
+#include <QTimer>
+
+#include "RecentScrobblesJournal.h"
+
+#define kJournalMagic 0x4c46524a // LFRJ
+#define kJournalVersion 1
+#define kStreamVersion QDataStream::Qt_4_6
+
+// how many records beyond the number of tracks before we compact
+#define kCompactionSlack 256
+
+namespace
+{
+    QByteArray
+    toXml( const lastfm::Track& track )
+    {
+        // Tracks are stored the way they serialise themselves, just without
+        // the indentation
+        QDomDocument xml;
+        xml.appendChild( track.toDomElement( xml ) );
+        return xml.toByteArray( -1 );
+    }
+
+    void
+    writeHeader( QDataStream& stream )
+    {
+        stream << quint32( kJournalMagic ) << quint32( kJournalVersion );
+    }
+}
+
+RecentScrobblesJournal::RecentScrobblesJournal( QObject* parent )
+    :QObject( parent ), m_records( 0 ), m_tracks( 0 )
+{
+    m_flushTimer = new QTimer( this );
+    m_flushTimer->setSingleShot( true );
+    m_flushTimer->setInterval( 500 );
+    connect( m_flushTimer, SIGNAL(timeout()), SLOT(flush()) );
+}
+
+RecentScrobblesJournal::~RecentScrobblesJournal()
+{
+    // our owner may be half destroyed so don't ask it to compact
+    blockSignals( true );
+    flush();
+}
+
+QList<lastfm::Track>
+RecentScrobblesJournal::open( const QString& path )
+{
+    flush();
+
+    m_path = path;
+    m_pending.clear();
+    m_records = 0;
+
+    QMap<uint, lastfm::Track> tracks;
+
+    QFile file( m_path );
+
+    if ( file.open( QIODevice::ReadOnly ) )
+    {
+        QDataStream stream( &file );
+        stream.setVersion( kStreamVersion );
+
+        quint32 magic, version;
+        stream >> magic >> version;
+
+        if ( stream.status() != QDataStream::Ok || magic != kJournalMagic || version != kJournalVersion )
+        {
+            qWarning() << "Discarding unreadable recent scrobbles journal" << m_path;
+            file.close();
+            QFile::remove( m_path );
+        }
+        else
+        {
+            qint64 goodPos = file.pos();
+
+            while ( !stream.atEnd() )
+            {
+                quint8 type;
+                quint32 timestamp;
+                stream >> type >> timestamp;
+
+                if ( type == AddRecord )
+                {
+                    QByteArray xml;
+                    stream >> xml;
+
+                    QDomDocument doc;
+
+                    if ( stream.status() == QDataStream::Ok && doc.setContent( xml ) )
+                        tracks.insert( timestamp, lastfm::Track( doc.documentElement() ) );
+                }
+                else if ( type == RemoveRecord )
+                    tracks.remove( timestamp );
+                else if ( type == UpdateRecord )
+                {
+                    qint8 loved;
+                    qint16 status;
+                    qint32 error;
+                    QString errorText;
+                    stream >> loved >> status >> error >> errorText;
+
+                    if ( stream.status() == QDataStream::Ok && tracks.contains( timestamp ) )
+                    {
+                        lastfm::MutableTrack track( tracks[timestamp] );
+                        if ( loved != -1 ) track.setLoved( loved );
+                        track.setScrobbleStatus( static_cast<lastfm::Track::ScrobbleStatus>( status ) );
+                        track.setScrobbleError( static_cast<lastfm::Track::ScrobbleError>( error ) );
+                        track.setScrobbleErrorText( errorText );
+                    }
+                }
+                else
+                    stream.setStatus( QDataStream::ReadCorruptData );
+
+                if ( stream.status() != QDataStream::Ok )
+                {
+                    // Probably a record cut short by a crash. Drop it so that
+                    // new records don't get appended after the garbage
+                    qWarning() << "Truncating recent scrobbles journal" << m_path << "at" << goodPos;
+                    file.close();
+                    QFile::resize( m_path, goodPos );
+                    break;
+                }
+
+                goodPos = file.pos();
+                ++m_records;
+            }
+        }
+    }
+
+    m_tracks = tracks.count();
+
+    QList<lastfm::Track> newestFirst;
+
+    QMapIterator<uint, lastfm::Track> i( tracks );
+    i.toBack();
+
+    while ( i.hasPrevious() )
+        newestFirst << i.previous().value();
+
+    return newestFirst;
+}
+
+void
+RecentScrobblesJournal::compact( const QList<lastfm::Track>& tracks )
+{
+    if ( m_path.isEmpty() )
+        return;
+
+    m_flushTimer->stop();
+    m_pending.clear();
+
+    if ( tracks.isEmpty() )
+    {
+        QFile::remove( m_path );
+        m_records = m_tracks = 0;
+        return;
+    }
+
+    QString tempPath = m_path + ".tmp";
+    QFile file( tempPath );
+
+    if ( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        QDataStream stream( &file );
+        stream.setVersion( kStreamVersion );
+        writeHeader( stream );
+
+        foreach ( const lastfm::Track& track, tracks )
+            stream << quint8( AddRecord ) << quint32( track.timestamp().toTime_t() ) << toXml( track );
+
+        file.close();
+
+        QFile::remove( m_path );
+        QFile::rename( tempPath, m_path );
+
+        m_records = m_tracks = tracks.count();
+    }
+}
+
+void
+RecentScrobblesJournal::add( const lastfm::Track& track )
+{
+    ++m_tracks;
+    append( AddRecord, track );
+}
+
+void
+RecentScrobblesJournal::remove( const lastfm::Track& track )
+{
+    --m_tracks;
+    append( RemoveRecord, track );
+}
+
+void
+RecentScrobblesJournal::update( const lastfm::Track& track )
+{
+    append( UpdateRecord, track );
+}
+
+void
+RecentScrobblesJournal::append( RecordType type, const lastfm::Track& track )
+{
+    if ( m_path.isEmpty() )
+        return;
+
+    QDataStream stream( &m_pending, QIODevice::WriteOnly | QIODevice::Append );
+    stream.setVersion( kStreamVersion );
+
+    stream << quint8( type ) << quint32( track.timestamp().toTime_t() );
+
+    if ( type == AddRecord )
+        stream << toXml( track );
+    else if ( type == UpdateRecord )
+        stream << qint8( track.loveStatus() == lastfm::Track::UnknownLoveStatus ? -1 : track.isLoved() )
+               << qint16( track.scrobbleStatus() )
+               << qint32( track.scrobbleError() )
+               << track.scrobbleErrorText();
+
+    ++m_records;
+
+    if ( !m_flushTimer->isActive() )
+        m_flushTimer->start();
+}
+
+void
+RecentScrobblesJournal::flush()
+{
+    m_flushTimer->stop();
+
+    if ( m_pending.isEmpty() || m_path.isEmpty() )
+        return;
+
+    QFile file( m_path );
+
+    if ( file.open( QIODevice::WriteOnly | QIODevice::Append ) )
+    {
+        if ( file.size() == 0 )
+        {
+            QDataStream stream( &file );
+            stream.setVersion( kStreamVersion );
+            writeHeader( stream );
+        }
+
+        file.write( m_pending );
+        m_pending.clear();
+    }
+
+    if ( m_records > m_tracks + kCompactionSlack )
+        emit compactionNeeded();
+}
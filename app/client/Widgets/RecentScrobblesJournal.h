@@ -0,0 +1,81 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECENT_SCROBBLES_JOURNAL_H
+#define RECENT_SCROBBLES_JOURNAL_H
+
+#include <QByteArray>
+#include <QObject>
+
+#include <lastfm/Track.h>
+
+/** Saves the recent scrobbles as an append-only journal of records keyed by
+  * timestamp: a track was added, removed, or its loved/scrobble state
+  * changed. Records are buffered and appended together, so saving costs the
+  * size of the change rather than the size of the list.
+  *
+  * Once the file holds many more records than there are tracks, it emits
+  * compactionNeeded() and the owner rewrites it with compact().
+  */
+class RecentScrobblesJournal : public QObject
+{
+    Q_OBJECT
+public:
+    RecentScrobblesJournal( QObject* parent = 0 );
+    ~RecentScrobblesJournal();
+
+    /** Flushes the current journal then replays the one at path.
+      * Returns the tracks, newest first. */
+    QList<lastfm::Track> open( const QString& path );
+
+    /** Rewrites the journal as one add record per track */
+    void compact( const QList<lastfm::Track>& tracks );
+
+public slots:
+    void add( const lastfm::Track& track );
+    void remove( const lastfm::Track& track );
+    void update( const lastfm::Track& track );
+
+    /** Appends the buffered records to the file */
+    void flush();
+
+signals:
+    void compactionNeeded();
+
+private:
+    enum RecordType
+    {
+        AddRecord = 1,
+        RemoveRecord,
+        UpdateRecord
+    };
+
+    void append( RecordType type, const lastfm::Track& track );
+
+private:
+    QString m_path;
+    QByteArray m_pending;
+
+    class QTimer* m_flushTimer;
+
+    int m_records; // in the file and pending
+    int m_tracks;  // that the records add up to
+};
+
+#endif // RECENT_SCROBBLES_JOURNAL_H
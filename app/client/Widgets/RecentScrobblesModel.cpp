@@ -0,0 +1,616 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtAlgorithms>
+
+#include <lib/unicorn/TrackImageFetcher.h>
+
+#include "RecentScrobblesModel.h"
+
+// album art is fetched as they're added for this many of the newest
+// scrobbles, and this many images are kept
+#define kImageLimit 100
+
+RecentScrobblesModel::Item::Item( const lastfm::Track& track )
+    :track( track )
+{
+}
+
+RecentScrobblesModel::RecentScrobblesModel( QObject* parent )
+    :QAbstractListModel( parent ), m_nowPlayingVisible( false )
+{
+    m_images.setMaxCost( kImageLimit );
+}
+
+int
+RecentScrobblesModel::rowCount( const QModelIndex& parent ) const
+{
+    if ( parent.isValid() )
+        return 0;
+
+    return ( m_nowPlayingVisible ? 1 : 0 ) + m_items.count() - m_hiddenPositions.count();
+}
+
+QVariant
+RecentScrobblesModel::data( const QModelIndex& index, int role ) const
+{
+    const Item* item = this->item( index );
+
+    if ( !item )
+        return QVariant();
+
+    switch ( role )
+    {
+        case Qt::DisplayRole:
+            return item->track.title();
+
+        case Qt::DecorationRole:
+        {
+            QPixmap* image = m_images.object( item->track.timestamp().toTime_t() );
+            return image ? *image : QPixmap();
+        }
+
+        case ArtistRole:
+            return item->track.artist().name();
+
+        case TimestampRole:
+            return item->track.timestamp();
+
+        case NowPlayingRole:
+            return item == &m_nowPlaying;
+
+        case LovedRole:
+            return item->track.isLoved();
+
+        case ScrobbleStatusRole:
+            return static_cast<int>( item->track.scrobbleStatus() );
+
+        case ScrobbleErrorRole:
+            return item->track.scrobbleErrorText();
+    }
+
+    return QVariant();
+}
+
+lastfm::Track
+RecentScrobblesModel::track( const QModelIndex& index ) const
+{
+    const Item* item = this->item( index );
+    return item ? item->track : lastfm::Track();
+}
+
+bool
+RecentScrobblesModel::isNowPlaying( const QModelIndex& index ) const
+{
+    return item( index ) == &m_nowPlaying;
+}
+
+void
+RecentScrobblesModel::fetchImage( const QModelIndex& index )
+{
+    if ( const Item* item = this->item( index ) )
+        fetchImage( item->track );
+}
+
+QList<lastfm::Track>
+RecentScrobblesModel::addTracks( const QList<lastfm::Track>& tracks )
+{
+    // Filling an empty list is done as one reset rather than a row insert per track
+    bool reset = m_items.isEmpty() && tracks.count() > 1;
+
+    if ( reset )
+        beginResetModel();
+
+    QList<lastfm::Track> addedTracks = insertTracks( tracks, !reset );
+
+    if ( reset )
+        endResetModel();
+
+    foreach ( const lastfm::Track& track, addedTracks )
+        emit trackAdded( track );
+
+    return addedTracks;
+}
+
+void
+RecentScrobblesModel::setTracks( const QList<lastfm::Track>& tracks )
+{
+    beginResetModel();
+
+    foreach ( const Item& item, m_items )
+    {
+        unwatch( item.track );
+        forgetImage( item.track );
+    }
+
+    m_items.clear();
+    m_timestamps.clear();
+
+    insertTracks( tracks, false );
+    updateHiddenPositions();
+
+    endResetModel();
+}
+
+QList<lastfm::Track>
+RecentScrobblesModel::insertTracks( const QList<lastfm::Track>& tracks, bool notify )
+{
+    QList<lastfm::Track> addedTracks;
+
+    foreach ( const lastfm::Track& track, tracks )
+    {
+        if ( track.scrobbleError() == lastfm::Track::Invalid )
+            continue; // the track was filtered client side for being invalid
+
+        uint timestamp = track.timestamp().toTime_t();
+        int pos = lowerBound( timestamp );
+
+        if ( pos < m_timestamps.count() && m_timestamps[pos] == timestamp )
+        {
+            // we're getting an update from a track fetched from user.getRecentTracks
+            lastfm::MutableTrack mt( m_items[pos].track );
+            mt.setScrobbleStatus( lastfm::Track::Submitted ); // it's definitely been scrobbled
+            mt.setLoved( track.isLoved() ); // make sure the love state is consistent with Last.fm
+
+            QModelIndex index = indexForPosition( pos );
+
+            if ( notify && index.isValid() )
+                emit dataChanged( index, index );
+        }
+        else
+        {
+            insert( pos, track, notify );
+            addedTracks << track;
+        }
+    }
+
+    return addedTracks;
+}
+
+void
+RecentScrobblesModel::removeTrack( const lastfm::Track& track )
+{
+    int pos = find( track.timestamp().toTime_t() );
+
+    if ( pos != -1 )
+    {
+        lastfm::Track removed = m_items.at( pos ).track;
+        remove( pos );
+        emit trackRemoved( removed );
+    }
+}
+
+void
+RecentScrobblesModel::clear()
+{
+    beginResetModel();
+
+    foreach ( const Item& item, m_items )
+    {
+        unwatch( item.track );
+        forgetImage( item.track );
+    }
+
+    m_items.clear();
+    m_timestamps.clear();
+    m_hiddenPositions.clear();
+
+    endResetModel();
+}
+
+void
+RecentScrobblesModel::limit( int limit )
+{
+    if ( m_items.count() <= limit )
+        return;
+
+    // the rows of the oldest scrobbles are always the last rows
+    int first = visibleRowsBefore( limit );
+    int last = rowCount() - 1;
+
+    if ( first <= last )
+        beginRemoveRows( QModelIndex(), first, last );
+
+    QList<lastfm::Track> removed;
+
+    while ( m_items.count() > limit )
+    {
+        removed << m_items.last().track;
+        unwatch( m_items.last().track );
+        forgetImage( m_items.last().track );
+        m_items.removeLast();
+        m_timestamps.remove( m_timestamps.count() - 1 );
+    }
+
+    updateHiddenPositions();
+
+    if ( first <= last )
+        endRemoveRows();
+
+    foreach ( const lastfm::Track& track, removed )
+        emit trackRemoved( track );
+}
+
+QList<lastfm::Track>
+RecentScrobblesModel::tracks() const
+{
+    QList<lastfm::Track> tracks;
+
+    foreach ( const Item& item, m_items )
+        tracks << item.track;
+
+    return tracks;
+}
+
+void
+RecentScrobblesModel::setNowPlaying( const lastfm::Track& track )
+{
+    if ( !m_proxies.contains( m_nowPlaying.track.signalProxy() ) )
+        disconnect( m_nowPlaying.track.signalProxy(), 0, this, 0 );
+
+    m_nowPlaying = Item( track );
+    fetchImage( track );
+
+    connect( m_nowPlaying.track.signalProxy(), SIGNAL(loveToggled(bool)), SLOT(onTrackChanged()), Qt::UniqueConnection );
+    connect( m_nowPlaying.track.signalProxy(), SIGNAL(corrected(QString)), SLOT(onTrackCorrected()), Qt::UniqueConnection );
+
+    if ( m_nowPlayingVisible )
+        emit dataChanged( index( 0 ), index( 0 ) );
+}
+
+void
+RecentScrobblesModel::showNowPlaying( const QList<uint>& hiddenTimestamps )
+{
+    if ( !m_nowPlayingVisible )
+    {
+        beginInsertRows( QModelIndex(), 0, 0 );
+        m_nowPlayingVisible = true;
+        endInsertRows();
+    }
+
+    setHiddenTimestamps( hiddenTimestamps );
+}
+
+void
+RecentScrobblesModel::hideNowPlaying()
+{
+    setHiddenTimestamps( QList<uint>() );
+
+    if ( m_nowPlayingVisible )
+    {
+        beginRemoveRows( QModelIndex(), 0, 0 );
+        m_nowPlayingVisible = false;
+        endRemoveRows();
+    }
+}
+
+void
+RecentScrobblesModel::onTrackChanged()
+{
+    const QObject* proxy = sender();
+
+    if ( m_nowPlayingVisible && proxy == m_nowPlaying.track.signalProxy() )
+        emit dataChanged( index( 0 ), index( 0 ) );
+
+    QHash<const QObject*, uint>::const_iterator it = m_proxies.constFind( proxy );
+
+    if ( it != m_proxies.constEnd() )
+    {
+        int pos = find( it.value() );
+
+        if ( pos != -1 )
+        {
+            QModelIndex index = indexForPosition( pos );
+
+            if ( index.isValid() )
+                emit dataChanged( index, index );
+
+            emit trackChanged( m_items.at( pos ).track );
+        }
+    }
+}
+
+void
+RecentScrobblesModel::onTrackCorrected()
+{
+    // corrections are only for display so there's nothing worth saving
+    const QObject* proxy = sender();
+
+    if ( m_nowPlayingVisible && proxy == m_nowPlaying.track.signalProxy() )
+        emit dataChanged( index( 0 ), index( 0 ) );
+
+    QHash<const QObject*, uint>::const_iterator it = m_proxies.constFind( proxy );
+
+    if ( it != m_proxies.constEnd() )
+    {
+        QModelIndex index = indexForPosition( find( it.value() ) );
+
+        if ( index.isValid() )
+            emit dataChanged( index, index );
+    }
+}
+
+void
+RecentScrobblesModel::onImageFetched( const QPixmap& image )
+{
+    QObject* fetcher = sender();
+    fetcher->deleteLater();
+
+    uint timestamp = fetcher->property( "timestamp" ).toUInt();
+
+    // the scrobble was dropped while we fetched
+    if ( !m_fetchingImages.remove( timestamp ) )
+        return;
+
+    m_images.insert( timestamp, new QPixmap( image ) );
+
+    if ( m_nowPlayingVisible && m_nowPlaying.track.timestamp().toTime_t() == timestamp )
+        emit dataChanged( index( 0 ), index( 0 ) );
+
+    QModelIndex index = indexForPosition( find( timestamp ) );
+
+    if ( index.isValid() )
+        emit dataChanged( index, index );
+}
+
+void
+RecentScrobblesModel::onImageFailed()
+{
+    QObject* fetcher = sender();
+    fetcher->deleteLater();
+
+    uint timestamp = fetcher->property( "timestamp" ).toUInt();
+
+    // remembered even if the scrobble was dropped, it may well come back
+    m_fetchingImages.remove( timestamp );
+    m_failedImages << timestamp;
+}
+
+int
+RecentScrobblesModel::lowerBound( uint timestamp ) const
+{
+    // newest first, so this is the first position that isn't newer
+    return qLowerBound( m_timestamps.constBegin(), m_timestamps.constEnd(), timestamp, qGreater<uint>() ) - m_timestamps.constBegin();
+}
+
+int
+RecentScrobblesModel::find( uint timestamp ) const
+{
+    int pos = lowerBound( timestamp );
+    return pos < m_timestamps.count() && m_timestamps[pos] == timestamp ? pos : -1;
+}
+
+int
+RecentScrobblesModel::position( int row ) const
+{
+    int pos = row - ( m_nowPlayingVisible ? 1 : 0 );
+
+    if ( pos < 0 )
+        return -1; // the now playing row
+
+    // m_hiddenPositions is sorted so step over each one at or before us
+    foreach ( int hidden, m_hiddenPositions )
+        if ( hidden <= pos )
+            ++pos;
+
+    return pos;
+}
+
+int
+RecentScrobblesModel::visibleRowsBefore( int pos ) const
+{
+    int row = pos + ( m_nowPlayingVisible ? 1 : 0 );
+
+    foreach ( int hidden, m_hiddenPositions )
+        if ( hidden < pos )
+            --row;
+
+    return row;
+}
+
+bool
+RecentScrobblesModel::isHidden( int pos ) const
+{
+    return m_hiddenPositions.contains( pos );
+}
+
+const RecentScrobblesModel::Item*
+RecentScrobblesModel::item( const QModelIndex& index ) const
+{
+    if ( !index.isValid() || index.row() >= rowCount() )
+        return 0;
+
+    int pos = position( index.row() );
+
+    return pos == -1 ? &m_nowPlaying : &m_items.at( pos );
+}
+
+QModelIndex
+RecentScrobblesModel::indexForPosition( int pos ) const
+{
+    if ( pos < 0 || pos >= m_items.count() || isHidden( pos ) )
+        return QModelIndex();
+
+    return index( visibleRowsBefore( pos ) );
+}
+
+void
+RecentScrobblesModel::insert( int pos, const lastfm::Track& track, bool notify )
+{
+    uint timestamp = track.timestamp().toTime_t();
+    notify = notify && !m_hiddenTimestamps.contains( timestamp );
+
+    if ( notify )
+    {
+        int row = visibleRowsBefore( pos );
+        beginInsertRows( QModelIndex(), row, row );
+    }
+
+    m_items.insert( pos, Item( track ) );
+    m_timestamps.insert( pos, timestamp );
+    watch( track );
+
+    if ( pos < kImageLimit )
+        fetchImage( track );
+
+    updateHiddenPositions();
+
+    if ( notify )
+        endInsertRows();
+}
+
+void
+RecentScrobblesModel::remove( int pos )
+{
+    bool notify = !isHidden( pos );
+
+    if ( notify )
+    {
+        int row = visibleRowsBefore( pos );
+        beginRemoveRows( QModelIndex(), row, row );
+    }
+
+    unwatch( m_items.at( pos ).track );
+    forgetImage( m_items.at( pos ).track );
+    m_items.removeAt( pos );
+    m_timestamps.remove( pos );
+
+    updateHiddenPositions();
+
+    if ( notify )
+        endRemoveRows();
+}
+
+void
+RecentScrobblesModel::watch( const lastfm::Track& track )
+{
+    m_proxies.insert( track.signalProxy(), track.timestamp().toTime_t() );
+
+    connect( track.signalProxy(), SIGNAL(loveToggled(bool)), SLOT(onTrackChanged()), Qt::UniqueConnection );
+    connect( track.signalProxy(), SIGNAL(scrobbleStatusChanged(short)), SLOT(onTrackChanged()), Qt::UniqueConnection );
+    connect( track.signalProxy(), SIGNAL(corrected(QString)), SLOT(onTrackCorrected()), Qt::UniqueConnection );
+}
+
+void
+RecentScrobblesModel::unwatch( const lastfm::Track& track )
+{
+    const QObject* proxy = track.signalProxy();
+
+    m_proxies.remove( proxy );
+
+    // the now playing track can share its signals with its own scrobble
+    if ( proxy != m_nowPlaying.track.signalProxy() )
+        disconnect( proxy, 0, this, 0 );
+}
+
+void
+RecentScrobblesModel::updateHiddenPositions()
+{
+    m_hiddenPositions.clear();
+
+    foreach ( uint timestamp, m_hiddenTimestamps )
+    {
+        int pos = find( timestamp );
+
+        if ( pos != -1 )
+            m_hiddenPositions << pos;
+    }
+
+    qSort( m_hiddenPositions );
+}
+
+void
+RecentScrobblesModel::setHiddenTimestamps( const QList<uint>& timestamps )
+{
+    // give back the rows of scrobbles that are no longer hidden
+    foreach ( uint timestamp, m_hiddenTimestamps )
+    {
+        if ( timestamps.contains( timestamp ) )
+            continue;
+
+        int pos = find( timestamp );
+
+        if ( pos == -1 )
+            m_hiddenTimestamps.removeAll( timestamp );
+        else
+        {
+            int row = visibleRowsBefore( pos );
+            beginInsertRows( QModelIndex(), row, row );
+            m_hiddenTimestamps.removeAll( timestamp );
+            updateHiddenPositions();
+            endInsertRows();
+        }
+    }
+
+    // Timestamps that aren't in the list yet are remembered so that the
+    // scrobble is hidden when it arrives
+    foreach ( uint timestamp, timestamps )
+    {
+        if ( m_hiddenTimestamps.contains( timestamp ) )
+            continue;
+
+        int pos = find( timestamp );
+
+        if ( pos == -1 )
+            m_hiddenTimestamps << timestamp;
+        else
+        {
+            int row = visibleRowsBefore( pos );
+            beginRemoveRows( QModelIndex(), row, row );
+            m_hiddenTimestamps << timestamp;
+            updateHiddenPositions();
+            endRemoveRows();
+        }
+    }
+}
+
+void
+RecentScrobblesModel::fetchImage( const lastfm::Track& track )
+{
+    uint timestamp = track.timestamp().toTime_t();
+
+    if ( track.isNull()
+         || m_images.contains( timestamp )
+         || m_fetchingImages.contains( timestamp )
+         || m_failedImages.contains( timestamp ) )
+        return;
+
+    m_fetchingImages << timestamp;
+
+    TrackImageFetcher* fetcher = new TrackImageFetcher( track, lastfm::Track::MediumImage );
+    fetcher->setParent( this );
+    fetcher->setProperty( "timestamp", timestamp );
+    connect( fetcher, SIGNAL(finished(QPixmap)), SLOT(onImageFetched(QPixmap)) );
+    connect( fetcher, SIGNAL(failed()), SLOT(onImageFailed()) );
+    fetcher->startAlbum();
+}
+
+void
+RecentScrobblesModel::forgetImage( const lastfm::Track& track )
+{
+    uint timestamp = track.timestamp().toTime_t();
+
+    // the now playing row may still want it
+    if ( timestamp == m_nowPlaying.track.timestamp().toTime_t() )
+        return;
+
+    // m_failedImages is kept, there'll be no art next time either
+    m_images.remove( timestamp );
+    m_fetchingImages.remove( timestamp );
+}
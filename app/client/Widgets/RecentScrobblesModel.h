@@ -0,0 +1,158 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECENT_SCROBBLES_MODEL_H
+#define RECENT_SCROBBLES_MODEL_H
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
+#include <QVector>
+
+#include <lastfm/Track.h>
+
+/** The recent scrobbles list: an optional now playing row followed by the
+  * scrobbles, newest first.
+  *
+  * Scrobbles are keyed by their timestamp. m_timestamps is kept sorted in
+  * step with m_items so finding or inserting a scrobble is a binary search.
+  *
+  * While the now playing row is shown, scrobbles of that same play can be
+  * hidden so the track doesn't appear twice. They stay in the model, they
+  * just don't get a row.
+  *
+  * Album art is fetched for the newest scrobbles as they are added, and for
+  * older ones when the view asks with fetchImage(). Only the most recently
+  * used images are kept.
+  */
+class RecentScrobblesModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum DataRole
+    {
+        ArtistRole = Qt::UserRole,
+        TimestampRole,
+        NowPlayingRole,
+        LovedRole,
+        ScrobbleStatusRole,
+        ScrobbleErrorRole
+    };
+
+    RecentScrobblesModel( QObject* parent = 0 );
+
+    int rowCount( const QModelIndex& parent = QModelIndex() ) const;
+    QVariant data( const QModelIndex& index, int role = Qt::DisplayRole ) const;
+
+    lastfm::Track track( const QModelIndex& index ) const;
+    bool isNowPlaying( const QModelIndex& index ) const;
+
+    /** Fetches the row's album art if we don't have it, for rows that are
+      * about to be shown */
+    void fetchImage( const QModelIndex& index );
+
+    /** Adds the tracks that aren't in the list yet and updates the ones
+      * that are. Returns the tracks that were added. */
+    QList<lastfm::Track> addTracks( const QList<lastfm::Track>& tracks );
+    void removeTrack( const lastfm::Track& track );
+    void clear();
+
+    /** Replaces the scrobbles with ones that were loaded, so nothing is
+      * reported through trackAdded */
+    void setTracks( const QList<lastfm::Track>& tracks );
+
+    /** Drops the oldest scrobbles so at most limit remain */
+    void limit( int limit );
+
+    /** All the scrobbles, newest first, hidden ones included */
+    QList<lastfm::Track> tracks() const;
+    int count() const { return m_items.count(); }
+
+    lastfm::Track nowPlaying() const { return m_nowPlaying.track; }
+    void setNowPlaying( const lastfm::Track& track );
+
+    /** Shows the now playing row and hides the scrobbles with these timestamps */
+    void showNowPlaying( const QList<uint>& hiddenTimestamps );
+    void hideNowPlaying();
+    bool isNowPlayingVisible() const { return m_nowPlayingVisible; }
+
+signals:
+    /** The changes to the scrobbles that are worth saving */
+    void trackAdded( const lastfm::Track& track );
+    void trackRemoved( const lastfm::Track& track );
+    void trackChanged( const lastfm::Track& track );
+
+private slots:
+    void onTrackChanged();
+    void onTrackCorrected();
+    void onImageFetched( const QPixmap& image );
+    void onImageFailed();
+
+private:
+    struct Item
+    {
+        Item( const lastfm::Track& track = lastfm::Track() );
+
+        lastfm::Track track;
+    };
+
+    QList<lastfm::Track> insertTracks( const QList<lastfm::Track>& tracks, bool notify );
+
+    int find( uint timestamp ) const;
+    int lowerBound( uint timestamp ) const;
+
+    int position( int row ) const;
+    int visibleRowsBefore( int pos ) const;
+    bool isHidden( int pos ) const;
+
+    const Item* item( const QModelIndex& index ) const;
+    QModelIndex indexForPosition( int pos ) const;
+
+    void insert( int pos, const lastfm::Track& track, bool notify = true );
+    void remove( int pos );
+    void watch( const lastfm::Track& track );
+    void unwatch( const lastfm::Track& track );
+    void updateHiddenPositions();
+    void setHiddenTimestamps( const QList<uint>& timestamps );
+
+    void fetchImage( const lastfm::Track& track );
+    void forgetImage( const lastfm::Track& track );
+
+private:
+    QList<Item> m_items;
+    QVector<uint> m_timestamps;
+
+    Item m_nowPlaying;
+    bool m_nowPlayingVisible;
+
+    QList<uint> m_hiddenTimestamps;
+    QList<int> m_hiddenPositions;
+
+    QHash<const QObject*, uint> m_proxies;
+
+    // by timestamp, the now playing track shares its scrobble's
+    QCache<uint, QPixmap> m_images;
+    QSet<uint> m_fetchingImages;
+    // scrobbles with no art to be had, so we don't ask again
+    QSet<uint> m_failedImages;
+};
+
+#endif // RECENT_SCROBBLES_MODEL_H
@@ -18,114 +18,282 @@
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include <QApplication>
-#include <QHeaderView>
+#include <QLayout>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPushButton>
 #include <QScrollBar>
+#include <QStyleOption>
+#include <QStyledItemDelegate>
 #include <QTimer>
 
 #include <lastfm/Track.h>
 #include <lastfm/UrlBuilder.h>
 
-#include "lib/unicorn/dialogs/ShareDialog.h"
-#include "lib/unicorn/dialogs/TagDialog.h"
 #include "lib/unicorn/DesktopServices.h"
+#include "lib/unicorn/widgets/Label.h"
 
+#include "../Services/MetadataService.h"
 #include "../Services/ScrobbleService.h"
 #include "../Application.h"
 
+#include "RecentScrobblesJournal.h"
+#include "RecentScrobblesModel.h"
 #include "RefreshButton.h"
 #include "TrackWidget.h"
 #include "ScrobblesListWidget.h"
 
-#define kScrobbleLimit 30
+#define kScrobbleLimit 2000
+#define kRecentTracksLimit 30
 
-class ScrobblesListWidgetItem : public QListWidgetItem
+/** Paints a row the way a TrackWidget looks at rest. The style draws each
+  * part for the matching child of a hidden TrackWidget, so the rows follow
+  * the stylesheet the same as the hover widget does. */
+class ScrobbleDelegate : public QStyledItemDelegate
 {
 public:
-    ScrobblesListWidgetItem( QListWidget* parent );
-    bool operator<( const QListWidgetItem& that ) const;
+    ScrobbleDelegate( QWidget* list );
+    ~ScrobbleDelegate();
 
-    bool isNowPlaying() const;
-    void setNowPlaying( bool nowPlaying );
+    void paint( QPainter* p, const QStyleOptionViewItem& option, const QModelIndex& index ) const;
+    QSize sizeHint( const QStyleOptionViewItem& option, const QModelIndex& index ) const;
 
-    void setTrack( lastfm::Track& track );
+private:
+    void layoutTemplates( int width ) const;
+    static QWidget* child( const TrackWidget* trackWidget, const char* name );
+    static QRect geometry( const TrackWidget* trackWidget, const QWidget* child, const QPoint& origin );
+    void drawText( QPainter* p, const TrackWidget* trackWidget, const char* label, const char* area, const QPoint& origin, const QString& text ) const;
 
 private:
-    bool m_nowPlaying;
+    lastfm::Track m_track;
+    lastfm::Track m_nowPlayingTrack;
+    TrackWidget* m_template;
+    TrackWidget* m_nowPlayingTemplate;
+    mutable int m_width;
+
+    QPixmap m_noArt;
+    QPixmap m_equaliser;
 };
 
-ScrobblesListWidgetItem::ScrobblesListWidgetItem( QListWidget* parent )
-    :QListWidgetItem( parent ), m_nowPlaying( false )
+ScrobbleDelegate::ScrobbleDelegate( QWidget* list )
+    :QStyledItemDelegate( list ),
+      m_width( -1 ),
+      m_noArt( ":/meta_album_no_art.png" ),
+      m_equaliser( ":/icon_eq.gif" )
 {
+    m_template = new TrackWidget( m_track, list );
+    m_template->hide();
+    m_template->ensurePolished();
+
+    m_nowPlayingTemplate = new TrackWidget( m_nowPlayingTrack, list );
+    m_nowPlayingTemplate->setObjectName( "nowPlaying" );
+    m_nowPlayingTemplate->setNowPlaying( true );
+    m_nowPlayingTemplate->hide();
+    m_nowPlayingTemplate->ensurePolished();
 }
 
-bool
-ScrobblesListWidgetItem::isNowPlaying() const
+ScrobbleDelegate::~ScrobbleDelegate()
+{
+    // they have references to our tracks
+    delete m_template;
+    delete m_nowPlayingTemplate;
+}
+
+QSize
+ScrobbleDelegate::sizeHint( const QStyleOptionViewItem& option, const QModelIndex& /*index*/ ) const
 {
-    return m_nowPlaying;
+    return QSize( option.rect.width(), m_template->sizeHint().height() );
+}
+
+static void
+activateLayouts( QWidget* widget )
+{
+    // hidden widgets don't get the resize events that would lay them out
+    if ( QLayout* layout = widget->layout() )
+    {
+        layout->invalidate();
+        layout->activate();
+    }
+
+    foreach ( QObject* child, widget->children() )
+        if ( child->isWidgetType() )
+            activateLayouts( static_cast<QWidget*>( child ) );
 }
 
 void
-ScrobblesListWidgetItem::setNowPlaying( bool nowPlaying )
+ScrobbleDelegate::layoutTemplates( int width ) const
 {
-    m_nowPlaying = nowPlaying;
-    static_cast<TrackWidget*>( listWidget()->itemWidget( this ) )->setNowPlaying( true );
+    if ( width == m_width )
+        return;
+
+    m_width = width;
+    int height = m_template->sizeHint().height();
+
+    foreach ( TrackWidget* trackWidget, QList<TrackWidget*>() << m_template << m_nowPlayingTemplate )
+    {
+        trackWidget->resize( width, height );
+        activateLayouts( trackWidget );
+    }
+}
+
+//static
+QWidget*
+ScrobbleDelegate::child( const TrackWidget* trackWidget, const char* name )
+{
+    return trackWidget->findChild<QWidget*>( name );
+}
+
+//static
+QRect
+ScrobbleDelegate::geometry( const TrackWidget* trackWidget, const QWidget* child, const QPoint& origin )
+{
+    return QRect( child->mapTo( const_cast<TrackWidget*>( trackWidget ), QPoint( 0, 0 ) ) + origin, child->size() );
 }
 
 void
-ScrobblesListWidgetItem::setTrack( lastfm::Track& track )
+ScrobbleDelegate::drawText( QPainter* p, const TrackWidget* trackWidget, const char* label, const char* area, const QPoint& origin, const QString& text ) const
 {
-    static_cast<TrackWidget*>( listWidget()->itemWidget( this ) )->setTrack( track );
+    QWidget* widget = child( trackWidget, label );
+    QRect rect = geometry( trackWidget, child( trackWidget, area ), origin );
+
+    p->setFont( widget->font() );
+    p->setPen( widget->palette().color( widget->foregroundRole() ) );
+    p->drawText( rect, Qt::AlignLeft | Qt::AlignVCenter, p->fontMetrics().elidedText( text, Qt::ElideRight, rect.width() ) );
 }
 
-bool
-ScrobblesListWidgetItem::operator<( const QListWidgetItem& that ) const
+void
+ScrobbleDelegate::paint( QPainter* p, const QStyleOptionViewItem& option, const QModelIndex& index ) const
 {
-    if ( !qobject_cast<TrackWidget*>(listWidget()->itemWidget( const_cast<ScrobblesListWidgetItem*>(this) )) )
+    bool nowPlaying = index.data( RecentScrobblesModel::NowPlayingRole ).toBool();
+    const TrackWidget* trackWidget = nowPlaying ? m_nowPlayingTemplate : m_template;
+    QPoint origin = option.rect.topLeft();
+
+    layoutTemplates( option.rect.width() );
+
+    p->save();
+
+    QStyleOption background;
+    background.initFrom( trackWidget );
+    background.rect = option.rect;
+    background.state = QStyle::State_Enabled;
+    trackWidget->style()->drawPrimitive( QStyle::PE_Widget, &background, p, trackWidget );
+
+    QWidget* albumArt = child( trackWidget, "albumArt" );
+    QStyleOption art;
+    art.initFrom( albumArt );
+    art.rect = geometry( trackWidget, albumArt, origin );
+    art.state = QStyle::State_Enabled;
+    albumArt->style()->drawPrimitive( QStyle::PE_Widget, &art, p, albumArt );
+
+    QPixmap image = index.data( Qt::DecorationRole ).value<QPixmap>();
+    p->drawPixmap( albumArt->contentsRect().translated( art.rect.topLeft() ), image.isNull() ? m_noArt : image );
+
+    foreach ( QPushButton* button, trackWidget->findChildren<QPushButton*>() )
     {
-        // this isn't a track widget
+        if ( button->isHidden() )
+            continue;
 
-        if ( qobject_cast<RefreshButton*>(listWidget()->itemWidget( const_cast<ScrobblesListWidgetItem*>(this) )) )
-            return true; // this is a refresh button
-        else
-            return false; // more button goes at the bottom
+        QStyleOptionButton opt;
+        opt.initFrom( button );
+        opt.rect = geometry( trackWidget, button, origin );
+        opt.state = QStyle::State_Enabled;
+
+        if ( button->objectName() == "love" )
+            opt.state |= index.data( RecentScrobblesModel::LovedRole ).toBool() ? QStyle::State_On : QStyle::State_Off;
+
+        button->style()->drawControl( QStyle::CE_PushButton, &opt, p, button );
     }
 
-    if ( qobject_cast<RefreshButton*>(listWidget()->itemWidget( const_cast<QListWidgetItem*>(&that) )) )
-        return false; // that is a refresh button so this is not less than. refresh button goes at the top
+    // the title label is only as wide as its text, so use its frame
+    drawText( p, trackWidget, "trackTitle", "trackTitleFrame", origin, index.data().toString() );
+    drawText( p, trackWidget, "artist", "artist", origin, index.data( RecentScrobblesModel::ArtistRole ).toString() );
 
-    if ( !qobject_cast<TrackWidget*>(listWidget()->itemWidget( const_cast<QListWidgetItem*>(&that) )) )
-        return true; // that is the more push button. everything else is less than it
+    QString timestamp;
 
-    // at this point both this and that are of type TrackWidget
+    if ( nowPlaying )
+    {
+        p->drawPixmap( geometry( trackWidget, child( trackWidget, "equaliser" ), origin ).topLeft(), m_equaliser );
+        timestamp = TrackWidget::tr( "Now listening" );
+    }
+    else
+    {
+        switch ( index.data( RecentScrobblesModel::ScrobbleStatusRole ).toInt() )
+        {
+            case lastfm::Track::Cached:
+                timestamp = TrackWidget::tr( "Cached" );
+                break;
+            case lastfm::Track::Error:
+                timestamp = TrackWidget::tr( "Error: %1" ).arg( index.data( RecentScrobblesModel::ScrobbleErrorRole ).toString() );
+                break;
+            default:
+                timestamp = unicorn::Label::prettyTime( index.data( RecentScrobblesModel::TimestampRole ).toDateTime() );
+        }
+    }
 
-    // check if it's the now playing track
-    if ( m_nowPlaying )
-        return true; // now playing goes at the top of the tracks
-    else if ( static_cast<const ScrobblesListWidgetItem*>(&that)->m_nowPlaying )
-        return false;
+    drawText( p, trackWidget, "timestamp", "timestamp", origin, timestamp );
 
-    // now order by timestamp
-    return static_cast<TrackWidget*>( listWidget()->itemWidget( const_cast<ScrobblesListWidgetItem*>( this ) ) )->track().timestamp().toTime_t()
-            > static_cast<TrackWidget*>( listWidget()->itemWidget( const_cast<QListWidgetItem*>( &that ) ) )->track().timestamp().toTime_t();
+    p->restore();
 }
 
+
 ScrobblesListWidget::ScrobblesListWidget( QWidget* parent )
-    :QListWidget( parent ), m_trackItem( 0 )
+    :QListView( parent ),
+      m_model( new RecentScrobblesModel( this ) ),
+      m_journal( new RecentScrobblesJournal( this ) )
 {
     setVerticalScrollMode( QAbstractItemView::ScrollPerPixel );
 
-#ifdef Q_OS_MAC
-    connect( verticalScrollBar(), SIGNAL(valueChanged(int)), SLOT(scroll()) );
-#endif
-
     setAttribute( Qt::WA_MacNoClickThrough );
     setAttribute( Qt::WA_MacShowFocusRect, false );
 
-    setUniformItemSizes( false );
-    setSortingEnabled( false );
+    setUniformItemSizes( true );
     setSelectionMode( QAbstractItemView::NoSelection );
     setHorizontalScrollBarPolicy( Qt::ScrollBarAlwaysOff );
+    viewport()->setMouseTracking( true );
+
+    // the one TrackWidget that gets moved to whichever row is under the mouse
+    m_hoverWidget = new TrackWidget( m_track, viewport() );
+    m_hoverWidget->hide();
+    m_hoverWidget->ensurePolished();
+
+    connect( m_hoverWidget, SIGNAL(clicked(TrackWidget&)), SLOT(onItemClicked(TrackWidget&)) );
+    connect( m_hoverWidget, SIGNAL(removed()), SLOT(onTrackWidgetRemoved()));
+
+    setItemDelegate( new ScrobbleDelegate( this ) );
+    setModel( m_model );
+
+    connect( m_model, SIGNAL(trackAdded(lastfm::Track)), m_journal, SLOT(add(lastfm::Track)) );
+    connect( m_model, SIGNAL(trackRemoved(lastfm::Track)), m_journal, SLOT(remove(lastfm::Track)) );
+    connect( m_model, SIGNAL(trackChanged(lastfm::Track)), m_journal, SLOT(update(lastfm::Track)) );
+    connect( m_journal, SIGNAL(compactionNeeded()), SLOT(compact()) );
+    connect( m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), SLOT(onDataChanged(QModelIndex,QModelIndex)) );
+    connect( m_model, SIGNAL(rowsInserted(QModelIndex,int,int)), SLOT(hideHoverWidget()) );
+    connect( m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)), SLOT(hideHoverWidget()) );
+    connect( m_model, SIGNAL(modelReset()), SLOT(hideHoverWidget()) );
+
+    // the refresh and more buttons sit above and below the scrolling rows
+    m_refreshButton = new RefreshButton( this );
+    m_refreshButton->setObjectName( "refresh" );
+    connect( m_refreshButton, SIGNAL(clicked()), SLOT(refresh()) );
+
+    m_moreButton = new QPushButton( tr( "More Scrobbles at Last.fm" ), this );
+    m_moreButton->setObjectName( "more" );
+    connect( m_moreButton, SIGNAL(clicked()), SLOT(onMoreClicked()) );
+
+    // Repainting is enough to update the relative timestamps and only the
+    // rows on screen get painted
+    m_timestampTimer = new QTimer( this );
+    m_timestampTimer->setInterval( 60 * 1000 );
+    connect( m_timestampTimer, SIGNAL(timeout()), viewport(), SLOT(update()) );
+    m_timestampTimer->start();
+
+    m_trackInfoTimer = new QTimer( this );
+    m_trackInfoTimer->setSingleShot( true );
+    m_trackInfoTimer->setInterval( 200 );
+    connect( m_trackInfoTimer, SIGNAL(timeout()), SLOT(fetchVisibleTrackInfo()) );
+    connect( verticalScrollBar(), SIGNAL(valueChanged(int)), m_trackInfoTimer, SLOT(start()) );
 
     connect( qApp, SIGNAL( sessionChanged(unicorn::Session)), SLOT(onSessionChanged(unicorn::Session)));
 
@@ -140,26 +308,23 @@ ScrobblesListWidget::ScrobblesListWidget( QWidget* parent )
     onSessionChanged( aApp->currentSession() );
 }
 
-#ifdef Q_OS_MAC
 void
-ScrobblesListWidget::scroll()
+ScrobblesListWidget::showEvent(QShowEvent *)
 {
-    // KLUDGE: The friend list widgets don't move unless we do this
-    sortItems( Qt::AscendingOrder );
+    m_trackInfoTimer->start();
 }
-#endif
 
 void
-ScrobblesListWidget::showEvent(QShowEvent *)
+ScrobblesListWidget::fetchVisibleTrackInfo()
 {
     QList<lastfm::Track> tracks;
 
-    for ( int i = 0 ; i < count() ; ++i )
+    for ( QModelIndex index = indexAt( QPoint( 0, 0 ) ) ;
+          index.isValid() && visualRect( index ).top() < viewport()->height() ;
+          index = index.sibling( index.row() + 1, 0 ) )
     {
-        TrackWidget* trackWidget = qobject_cast<TrackWidget*>( itemWidget( item( i ) ) );
-
-        if ( trackWidget && !item( i )->isHidden() )
-            tracks << trackWidget->track();
+        tracks << m_model->track( index );
+        m_model->fetchImage( index );
     }
 
     fetchTrackInfo( tracks );
@@ -172,21 +337,134 @@ ScrobblesListWidget::fetchTrackInfo( const QList<lastfm::Track>& tracks )
     {
         // Make sure we fetch info for any tracks with unknown loved status
         foreach ( const lastfm::Track& track, tracks )
-            if ( track.loveStatus() == lastfm::Track::UnknownLoveStatus )
-                track.getInfo(  this, "write", User().name() );
+        {
+            if ( track.loveStatus() == lastfm::Track::UnknownLoveStatus
+                 && !m_trackInfoFetched.contains( track.timestamp().toTime_t() ) )
+            {
+                m_trackInfoFetched << track.timestamp().toTime_t();
+                connect( MetadataService::instance().get( MetadataService::TrackGetInfo, track ), SIGNAL(finished()), SLOT(onTrackGotInfo()) );
+            }
+        }
+    }
+}
+
+void
+ScrobblesListWidget::onTrackGotInfo()
+{
+    MetadataReply* reply = qobject_cast<MetadataReply*>( sender() );
+
+    XmlQuery lfm;
+
+    if ( lfm.parse( reply->data() ) && lfm["track"]["userloved"].text().length() > 0 )
+    {
+        // the model has the same track, so it and the journal see the change
+        MutableTrack( reply->track() ).setLoved( lfm["track"]["userloved"].text() == "1" );
     }
+
+    m_journal->flush();
 }
 
 void
-ScrobblesListWidget::mousePressEvent( QMouseEvent* event )
+ScrobblesListWidget::mouseMoveEvent( QMouseEvent* event )
+{
+    updateHoverWidget( event->pos() );
+    QListView::mouseMoveEvent( event );
+}
+
+bool
+ScrobblesListWidget::viewportEvent( QEvent* event )
 {
-    event->setAccepted( false );
+    if ( event->type() == QEvent::Leave )
+        hideHoverWidget();
+
+    return QListView::viewportEvent( event );
 }
 
 void
-ScrobblesListWidget::mouseReleaseEvent( QMouseEvent* event )
+ScrobblesListWidget::scrollContentsBy( int dx, int dy )
 {
-    event->setAccepted( false );
+    QListView::scrollContentsBy( dx, dy );
+
+    // a different row is under the mouse now
+    if ( m_hoverWidget->isVisible() )
+        updateHoverWidget( viewport()->mapFromGlobal( QCursor::pos() ) );
+}
+
+void
+ScrobblesListWidget::updateGeometries()
+{
+    int refreshHeight = m_refreshButton->sizeHint().height();
+    int moreHeight = m_moreButton->sizeHint().height();
+
+    setViewportMargins( 0, refreshHeight, 0, moreHeight );
+
+    QRect rect = viewport()->geometry();
+    m_refreshButton->setGeometry( rect.left(), rect.top() - refreshHeight, rect.width(), refreshHeight );
+    m_moreButton->setGeometry( rect.left(), rect.bottom() + 1, rect.width(), moreHeight );
+
+    QListView::updateGeometries();
+}
+
+void
+ScrobblesListWidget::updateHoverWidget( const QPoint& pos )
+{
+    if ( !m_hoverWidget->isEnabled() )
+        return; // it's showing the spinner for the row that was clicked
+
+    QModelIndex index = indexAt( pos );
+
+    if ( !index.isValid() )
+    {
+        hideHoverWidget();
+        return;
+    }
+
+    if ( index != m_hoverIndex || m_hoverWidget->isHidden() )
+    {
+        m_hoverIndex = index;
+
+        // hidden while it changes track so it doesn't fetch album art we already have
+        m_hoverWidget->hide();
+
+        bool nowPlaying = m_model->isNowPlaying( index );
+        QString objectName = nowPlaying ? "nowPlaying" : "";
+
+        if ( m_hoverWidget->objectName() != objectName )
+        {
+            m_hoverWidget->setObjectName( objectName );
+            m_hoverWidget->style()->unpolish( m_hoverWidget );
+            m_hoverWidget->style()->polish( m_hoverWidget );
+        }
+
+        lastfm::Track track = m_model->track( index );
+        m_hoverWidget->setNowPlaying( nowPlaying );
+        m_hoverWidget->setTrack( track );
+        m_hoverWidget->setAlbumArt( index.data( Qt::DecorationRole ).value<QPixmap>() );
+    }
+
+    m_hoverWidget->setGeometry( visualRect( index ) );
+    m_hoverWidget->show();
+}
+
+void
+ScrobblesListWidget::hideHoverWidget()
+{
+    if ( m_hoverWidget->isEnabled() )
+    {
+        m_hoverWidget->hide();
+        m_hoverIndex = QPersistentModelIndex();
+    }
+}
+
+void
+ScrobblesListWidget::onDataChanged( const QModelIndex& topLeft, const QModelIndex& bottomRight )
+{
+    // the album art might have arrived for the row under the mouse
+    if ( m_hoverWidget->isVisible()
+         && m_hoverIndex.isValid()
+         && m_hoverIndex.row() >= topLeft.row()
+         && m_hoverIndex.row() <= bottomRight.row() )
+        m_hoverWidget->setAlbumArt( m_hoverIndex.data( Qt::DecorationRole ).value<QPixmap>() );
 }
 
 void 
@@ -206,7 +484,7 @@ ScrobblesListWidget::onSessionChanged( const unicorn::Session& session )
 {
     if ( !session.user().name().isEmpty() )
     {
-        QString path = lastfm::dir::runtimeData().filePath( session.user().name() + "_recent_tracks.xml" );
+        QString path = lastfm::dir::runtimeData().filePath( session.user().name() + "_recent_tracks.journal" );
 
         if ( m_path != path )
         {
@@ -221,101 +499,43 @@ ScrobblesListWidget::onSessionChanged( const unicorn::Session& session )
 void
 ScrobblesListWidget::read()
 {
-    clear();
-
-    // always have a now playing item in the list
-    m_trackItem = new ScrobblesListWidgetItem( this );
-    TrackWidget* trackWidget = new TrackWidget( m_track, this );
-    trackWidget->setObjectName( "nowPlaying" );
-    setItemWidget( m_trackItem, trackWidget );
-    m_trackItem->setSizeHint( trackWidget->sizeHint() );
-    m_trackItem->setHidden( true );
-    m_trackItem->setNowPlaying( true );
-
-    connect( trackWidget, SIGNAL(clicked(TrackWidget&)), SLOT(onItemClicked(TrackWidget&)) );
-
-    // always have the refresh button in the list
-    m_refreshItem = new ScrobblesListWidgetItem( this );
-    RefreshButton* refreshButton = new RefreshButton( this );
-    refreshButton->setObjectName( "refresh" );
-    setItemWidget( m_refreshItem, refreshButton );
-    m_refreshItem->setSizeHint( refreshButton->sizeHint() );
-
-    connect( refreshButton, SIGNAL(clicked()), SLOT(refresh()) );
+    m_model->hideNowPlaying();
+    m_trackInfoFetched.clear();
 
     onRefreshing( false );
 
-    // always have a view more item in the list
-    m_moreItem = new ScrobblesListWidgetItem( this );
-    QPushButton* moreButton = new QPushButton( tr( "More Scrobbles at Last.fm" ), this );
-    moreButton->setObjectName( "more" );
-    setItemWidget( m_moreItem, moreButton );
-    m_moreItem->setSizeHint( moreButton->sizeHint() );
-
-    connect( moreButton, SIGNAL(clicked()), SLOT(onMoreClicked()) );
+    QList<lastfm::Track> tracks = m_journal->open( m_path );
 
-    QFile file( m_path );
-    file.open( QFile::Text | QFile::ReadOnly );
-    QTextStream stream( &file );
-    stream.setCodec( "UTF-8" );
+    QString xmlPath = m_path;
+    xmlPath.chop( QString( "journal" ).length() );
+    xmlPath.append( "xml" );
 
-    QDomDocument xml;
-    xml.setContent( stream.readAll() );
-
-    QList<Track> tracks;
-
-    for (QDomNode n = xml.documentElement().lastChild(); !n.isNull(); n = n.previousSibling())
-        tracks << Track( n.toElement() );
+    if ( tracks.isEmpty() && QFile::exists( xmlPath ) )
+    {
+        // move the scrobbles over from the old xml file
+        QFile file( xmlPath );
+        file.open( QFile::Text | QFile::ReadOnly );
+        QTextStream stream( &file );
+        stream.setCodec( "UTF-8" );
 
-    addTracks( tracks );
-    fetchTrackInfo( tracks );
+        QDomDocument xml;
+        xml.setContent( stream.readAll() );
 
-    limit( kScrobbleLimit );
-}
+        for (QDomNode n = xml.documentElement().lastChild(); !n.isNull(); n = n.previousSibling())
+            tracks << Track( n.toElement() );
 
-void
-ScrobblesListWidget::write()
-{
-    if ( !m_writeTimer )
-    {
-        m_writeTimer = new QTimer( this );
-        connect( m_writeTimer, SIGNAL(timeout()), this, SLOT(doWrite()) );
-        m_writeTimer->setSingleShot( true );
+        m_journal->compact( tracks );
+        file.remove();
     }
 
-    m_writeTimer->start( 500 );
+    m_model->setTracks( tracks );
+    m_model->limit( kScrobbleLimit );
 }
 
 void
-ScrobblesListWidget::doWrite()
+ScrobblesListWidget::compact()
 {
-    if ( count() == 0 )
-        QFile::remove( m_path );
-    else
-    {
-        QDomDocument xml;
-        QDomElement e = xml.createElement( "recent_tracks" );
-        e.setAttribute( "product", QCoreApplication::applicationName() );
-        e.setAttribute( "version", "2" );
-
-        for ( int i = 0 ; i < count() ; ++i )
-        {
-            TrackWidget* trackWidget = qobject_cast<TrackWidget*>( itemWidget( item( i ) ) );
-
-            if ( trackWidget && !static_cast<ScrobblesListWidgetItem*>( item( i ) )->isNowPlaying() )
-                e.appendChild( static_cast<TrackWidget*>( itemWidget( item( i ) ) )->track().toDomElement( xml ) );
-        }
-
-        xml.appendChild( e );
-
-        QFile file( m_path );
-        file.open( QIODevice::WriteOnly | QIODevice::Text );
-
-        QTextStream stream( &file );
-        stream.setCodec( "UTF-8" );
-        stream << "<?xml version='1.0' encoding='utf-8'?>\n";
-        stream << xml.toString( 2 );
-    }
+    m_journal->compact( m_model->tracks() );
 }
 
 void
@@ -326,10 +546,8 @@ ScrobblesListWidget::onTrackStarted( const Track& track, const Track& )
     if ( track.extra( "playerId" ) != "spt" )
     {
         m_track = track;
-        m_trackItem->setTrack( m_track );
-        m_trackItem->setHidden( false );
-
-        connect( m_track.signalProxy(), SIGNAL(loveToggled(bool)), SLOT(write()));
+        m_model->setNowPlaying( m_track );
+        m_model->showNowPlaying( nowPlayingTimestamps() );
 
         QList<lastfm::Track> tracks;
         tracks << track;
@@ -342,42 +560,36 @@ ScrobblesListWidget::onTrackStarted( const Track& track, const Track& )
 void
 ScrobblesListWidget::onResumed()
 {
-    m_trackItem->setHidden( false );
-
-    hideScrobbledNowPlaying();
+    m_model->showNowPlaying( nowPlayingTimestamps() );
 }
 
 void
 ScrobblesListWidget::onPaused()
 {
-    m_trackItem->setHidden( true );
-
-    hideScrobbledNowPlaying();
+    m_model->hideNowPlaying();
 }
 
 void
 ScrobblesListWidget::onStopped()
 {
-    m_trackItem->setHidden( true );
+    m_model->hideNowPlaying();
+}
 
-    hideScrobbledNowPlaying();
+QList<uint>
+ScrobblesListWidget::nowPlayingTimestamps() const
+{
+    // the scrobbles of the track that's playing are hidden behind the now playing row
+    return QList<uint>() << m_track.timestamp().toTime_t()
+                         << ScrobbleService::instance().currentTrack().timestamp().toTime_t();
 }
 
 void
 ScrobblesListWidget::hideScrobbledNowPlaying()
 {
-    for ( int i = 0 ; i < count() ; ++i )
-    {
-        if ( item( i ) != m_trackItem )
-        {
-            TrackWidget* trackWidget = qobject_cast<TrackWidget*>( itemWidget( item( i ) ) );
-
-            item( i )->setHidden( trackWidget
-                                    && !m_trackItem->isHidden()
-                                    && ( trackWidget->track().timestamp().toTime_t() == m_track.timestamp().toTime_t()
-                                    || trackWidget->track().timestamp().toTime_t() == ScrobbleService::instance().currentTrack().timestamp().toTime_t() ) );
-        }
-    }
+    // The model looks the scrobbles up by timestamp so this doesn't depend
+    // on how many there are
+    if ( m_model->isNowPlayingVisible() )
+        m_model->showNowPlaying( nowPlayingTimestamps() );
 }
 
 void
@@ -385,7 +597,7 @@ ScrobblesListWidget::refresh()
 {
     if ( !m_recentTrackReply )
     {
-        m_recentTrackReply = User().getRecentTracks( kScrobbleLimit, 1 );
+        m_recentTrackReply = User().getRecentTracks( kRecentTracksLimit, 1 );
         connect( m_recentTrackReply, SIGNAL(finished()), SLOT(onGotRecentTracks()) );
         onRefreshing( true );
     }
@@ -395,10 +607,8 @@ ScrobblesListWidget::refresh()
 void
 ScrobblesListWidget::onRefreshing( bool refreshing )
 {
-    RefreshButton* refreshButton = qobject_cast<RefreshButton*>( itemWidget( m_refreshItem ) );
-
-    refreshButton->setText( refreshing ? tr( "Refreshing..." ) : tr( "Refresh Scrobbles" ) );
-    refreshButton->setEnabled( !refreshing );
+    m_refreshButton->setText( refreshing ? tr( "Refreshing..." ) : tr( "Refresh Scrobbles" ) );
+    m_refreshButton->setEnabled( !refreshing );
 }
 
 void
@@ -408,7 +618,7 @@ ScrobblesListWidget::onGotRecentTracks()
 
     if ( lfm.parse( qobject_cast<QNetworkReply*>(sender()) ) )
     {
-        m_trackItem->setHidden( true );
+        bool nowPlaying( false );
 
         QList<lastfm::Track> tracks;
         lastfm::MutableTrack nowPlayingTrack;
@@ -434,19 +644,17 @@ ScrobblesListWidget::onGotRecentTracks()
                     nowPlayingTrack.setImageUrl( Track::ExtraLargeImage, trackXml["image size=extralarge"].text() );
 
                     m_track = nowPlayingTrack;
-                    m_trackItem->setTrack( m_track );
-
-                    connect( m_track.signalProxy(), SIGNAL(loveToggled(bool)), SLOT(write()));
+                    m_model->setNowPlaying( m_track );
 
                     QString loved = trackXml["loved"].text();
 
                     if ( !loved.isEmpty() )
                         nowPlayingTrack.setLoved( loved == "1" );
                     else
-                        m_track.getInfo( this, "write", User().name() );
+                        connect( MetadataService::instance().get( MetadataService::TrackGetInfo, m_track ), SIGNAL(finished()), SLOT(onTrackGotInfo()) );
                 }
 
-                m_trackItem->setHidden( false );
+                nowPlaying = true;
             }
             else
             {
@@ -477,13 +685,14 @@ ScrobblesListWidget::onGotRecentTracks()
             }
         }
 
-        QList<lastfm::Track> addedTracks = addTracks( tracks );
-
-        // get info for track if we don't know the loved state. This is so it will
-        // work before and after the loved field is added to user.getRecentTracks
-        fetchTrackInfo( addedTracks );
+        if ( nowPlaying )
+            m_model->showNowPlaying( nowPlayingTimestamps() );
+        else
+            m_model->hideNowPlaying();
 
-        write();
+        // this will get info for the tracks on screen if we don't know the loved state. This is so it
+        // will work before and after the loved field is added to user.getRecentTracks
+        addTracks( tracks );
     }
 
     onRefreshing( false );
@@ -500,102 +709,28 @@ ScrobblesListWidget::onScrobblesSubmitted( const QList<lastfm::Track>& tracks )
     // We need to find out if info has already been fetched for this track or not.
     // If the now playing view wasn't visible it won't have been.
     // Also, should also only fetch if the scrobbles list is visible too
-
-    QList<lastfm::Track> addedTracks = addTracks( tracks );
-
-    fetchTrackInfo( addedTracks );
+    addTracks( tracks );
 }
 
 void
 ScrobblesListWidget::onTrackWidgetRemoved()
 {
-    for ( int i = 0 ; i < count() ; ++i )
-    {
-        if ( itemWidget( item( i ) ) == sender() )
-        {
-            itemWidget( takeItem( i ) )->deleteLater();
-            refresh();
-            break;
-        }
-    }
+    m_model->removeTrack( m_hoverWidget->track() );
+    hideHoverWidget();
+    refresh();
 }
 
 QList<lastfm::Track>
 ScrobblesListWidget::addTracks( const QList<lastfm::Track>& tracks )
 {
-    QList<lastfm::Track> addedTracks;
-
-    for ( int i = 0 ; i < tracks.count() ; ++i )
-    {
-        if ( tracks[i].scrobbleError() != Track::Invalid  )
-        {
-            // the track was not filtered client side for being invalid
-            int pos = -1;
-
-            for ( int j = 0 ; j < count() ; ++j )
-            {
-                TrackWidget* trackWidget = qobject_cast<TrackWidget*>( itemWidget( item( j ) ) );
-
-                if ( trackWidget
-                     && !static_cast<ScrobblesListWidgetItem*>( item( j ) )->isNowPlaying()
-                     && tracks[i].timestamp().toTime_t() == trackWidget->track().timestamp().toTime_t() )
-                {
-                    pos = j;
-                    break;
-                }
-            }
-
-            if ( pos == -1 )
-            {
-                // the track was not in the list
-                ScrobblesListWidgetItem* item = new ScrobblesListWidgetItem( this );
-                Track track = tracks[i];
-                TrackWidget* trackWidget = new TrackWidget( track, this );
-                setItemWidget( item, trackWidget );
-                item->setSizeHint( trackWidget->sizeHint() );
-
-                connect( trackWidget, SIGNAL(removed()), SLOT(onTrackWidgetRemoved()));
-                connect( trackWidget, SIGNAL(clicked(TrackWidget&)), SLOT(onItemClicked(TrackWidget&)) );
-
-                connect( track.signalProxy(), SIGNAL(loveToggled(bool)), SLOT(write()));
-                connect( track.signalProxy(), SIGNAL(scrobbleStatusChanged(short)), SLOT(write()));
-            }
-            else
-            {
-                // update the track in the list with the new infos!
-                TrackWidget* trackWidget = qobject_cast<TrackWidget*>( itemWidget( item( pos ) ) );
-                trackWidget->update( tracks[i] );
-            }
-        }
-    }
+    QList<lastfm::Track> addedTracks = m_model->addTracks( tracks );
 
-    limit( kScrobbleLimit );
-
-    write();
+    m_model->limit( kScrobbleLimit );
 
     hideScrobbledNowPlaying();
 
-    return addedTracks;
-}
+    // info is only fetched for the rows that are on screen
+    m_trackInfoTimer->start();
 
-
-void
-ScrobblesListWidget::limit( int limit )
-{
-    sortItems();
-
-    // we add three to the limit here to account for the refresh button,
-    // the now playing track (usually hidden), and the more button
-    if ( count() > limit + 3 )
-    {
-        while ( count() > limit + 3 )
-        {
-            QListWidgetItem* item = takeItem( count() - 2 );
-            itemWidget( item )->deleteLater();
-            delete item;
-        }
-
-        write();
-    }
+    return addedTracks;
 }
-
@@ -21,10 +21,10 @@
 #ifndef SCROBBLES_LIST_WIDGET_H
 #define SCROBBLES_LIST_WIDGET_H
 
-#include <QListWidget>
-#include <QMouseEvent>
-#include <QPoint>
+#include <QListView>
+#include <QPersistentModelIndex>
 #include <QPointer>
+#include <QSet>
 
 #include <lastfm/Track.h>
 
@@ -35,7 +35,11 @@ namespace unicorn { class Session; }
 
 class QNetworkReply;
 
-class ScrobblesListWidget : public QListWidget
+/** The recent scrobbles list. The rows are painted by a delegate from a
+  * RecentScrobblesModel and a single TrackWidget is laid over the row under
+  * the mouse, so scrolling through thousands of scrobbles creates no widgets.
+  */
+class ScrobblesListWidget : public QListView
 {
     Q_OBJECT
 public:
@@ -65,44 +69,55 @@ private slots:
 
     void onTrackWidgetRemoved();
 
-    void write();
-    void doWrite();
+    void onDataChanged( const QModelIndex& topLeft, const QModelIndex& bottomRight );
+    void hideHoverWidget();
 
-#ifdef Q_OS_MAC
-    void scroll();
-#endif
+    void fetchVisibleTrackInfo();
+    void onTrackGotInfo();
 
-private:
-    QString price( const QString& price, const QString& currency ) const;
+    void compact();
 
+private:
     void read();
 
     QList<lastfm::Track> addTracks( const QList<lastfm::Track>& tracks );
-    void limit( int limit );
 
+    QList<uint> nowPlayingTimestamps() const;
     void hideScrobbledNowPlaying();
 
     void showEvent(QShowEvent *);
 
     void fetchTrackInfo( const QList<lastfm::Track>& tracks );
 
-    void mousePressEvent( QMouseEvent* event );
-    void mouseReleaseEvent( QMouseEvent* event );
+    void mouseMoveEvent( QMouseEvent* event );
+    bool viewportEvent( QEvent* event );
+    void scrollContentsBy( int dx, int dy );
+    void updateGeometries();
+
+    void updateHoverWidget( const QPoint& pos );
 
     void onRefreshing( bool refreshing );
 
 private:
     QString m_path;
 
-    QPointer<QTimer> m_writeTimer;
     QPointer<QNetworkReply> m_recentTrackReply;
 
     lastfm::Track m_track;
-    class ScrobblesListWidgetItem* m_refreshItem;
-    class ScrobblesListWidgetItem* m_trackItem;
-    class ScrobblesListWidgetItem* m_moreItem;
+
+    class RecentScrobblesModel* m_model;
+    class RecentScrobblesJournal* m_journal;
+
+    class TrackWidget* m_hoverWidget;
+    QPersistentModelIndex m_hoverIndex;
+
+    class RefreshButton* m_refreshButton;
+    class QPushButton* m_moreButton;
+
+    class QTimer* m_timestampTimer;
+    class QTimer* m_trackInfoTimer;
+    QSet<uint> m_trackInfoFetched;
 };
 
 
 #endif //ACTIVITY_LIST_WIDGET_H
-
@@ -237,6 +237,15 @@ TrackWidget::setTrack( lastfm::Track& track )
     fetchAlbumArt();
 }
 
+void
+TrackWidget::setAlbumArt( const QPixmap& albumArt )
+{
+    delete m_trackImageFetcher;
+    m_triedFetchAlbumArt = true;
+
+    ui->albumArt->setPixmap( albumArt.isNull() ? QPixmap( ":/meta_album_no_art.png" ) : albumArt );
+}
+
 void
 TrackWidget::setTrackDetails()
 {
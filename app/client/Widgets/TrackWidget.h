@@ -43,6 +43,9 @@ public:
     void setTrack( lastfm::Track& track );
     lastfm::Track track() const;
 
+    /** Use album art that has already been fetched instead of fetching it again */
+    void setAlbumArt( const QPixmap& albumArt );
+
     void setNowPlaying( bool nowPlaying );
 
 public slots:
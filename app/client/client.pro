@@ -51,12 +51,16 @@ SOURCES += \
     Settings/GeneralSettingsWidget.cpp \
     Services/ScrobbleService/StopWatch.cpp \
     Services/ScrobbleService/ScrobbleService.cpp \
+    Services/ScrobbleService/ScrobbleFilter.cpp \
     Dialogs/DiagnosticsDialog.cpp \
     Bootstrapper/PluginBootstrapper.cpp \
     Bootstrapper/ITunesDevice/itunesdevice.cpp \
+    Bootstrapper/ITunesDevice/ITunesTrackScanner.cpp \
     Bootstrapper/iTunesBootstrapper.cpp \
     Bootstrapper/AbstractFileBootstrapper.cpp \
     Bootstrapper/AbstractBootstrapper.cpp \
+    Bootstrapper/GzipDevice.cpp \
+    Bootstrapper/MultipartDevice.cpp \
     Widgets/TitleBar.cpp \
     Widgets/StatusBar.cpp \
     Widgets/SideBar.cpp \
@@ -95,8 +99,11 @@ SOURCES += \
     Dialogs/LicensesDialog.cpp \
     Widgets/ScrobblesWidget.cpp \
     Widgets/ScrobblesListWidget.cpp \
+    Widgets/RecentScrobblesModel.cpp \
+    Widgets/RecentScrobblesJournal.cpp \
     Services/AnalyticsService/AnalyticsService.cpp \
     Services/AnalyticsService/PersistentCookieJar.cpp \
+    Services/MetadataService/MetadataService.cpp \
     Settings/CheckFileSystemModel.cpp \
     Settings/CheckFileSystemView.cpp \
     Widgets/VolumeSlider.cpp
@@ -109,17 +116,20 @@ HEADERS += \
     Services/ScrobbleService.h \
     Services/ScrobbleService/StopWatch.h \
     Services/ScrobbleService/ScrobbleService.h \
+    Services/ScrobbleService/ScrobbleFilter.h \
     MediaDevices/MediaDevice.h \
     MediaDevices/IpodDevice.h \
     MediaDevices/DeviceScrobbler.h \
     Dialogs/DiagnosticsDialog.h \
     Bootstrapper/PluginBootstrapper.h \
     Bootstrapper/ITunesDevice/MediaDeviceInterface.h \
-    Bootstrapper/ITunesDevice/ITunesParser.h \
+    Bootstrapper/ITunesDevice/ITunesTrackScanner.h \
     Bootstrapper/ITunesDevice/itunesdevice.h \
     Bootstrapper/iTunesBootstrapper.h \
     Bootstrapper/AbstractFileBootstrapper.h \
     Bootstrapper/AbstractBootstrapper.h \
+    Bootstrapper/GzipDevice.h \
+    Bootstrapper/MultipartDevice.h \
     Settings/SettingsWidget.h \
     Settings/ScrobbleSettingsWidget.h \
     Settings/PreferencesDialog.h \
@@ -164,10 +174,14 @@ HEADERS += \
     Widgets/TrackWidget.h \
     Dialogs/LicensesDialog.h \
     Widgets/ScrobblesListWidget.h \
+    Widgets/RecentScrobblesModel.h \
+    Widgets/RecentScrobblesJournal.h \
     Widgets/ScrobblesWidget.h \
     Services/AnalyticsService.h \
     Services/AnalyticsService/AnalyticsService.h \
     Services/AnalyticsService/PersistentCookieJar.h \
+    Services/MetadataService.h \
+    Services/MetadataService/MetadataService.h \
     Settings/CheckFileSystemModel.h \
     Settings/CheckFileSystemView.h \
     Widgets/VolumeSlider.h
@@ -205,12 +219,16 @@ unix:!mac {
     CONFIG += qdbus
 
     SOURCES += MediaDevices/IpodDevice_linux.cpp \
+               MediaDevices/IpodMountWatcher_linux.cpp \
+               MediaDevices/IpodPlayCountDiff.cpp \
                Mpris2/Mpris2.cpp \
                Mpris2/DBusAbstractAdaptor.cpp \
                Mpris2/MediaPlayer2.cpp \
                Mpris2/MediaPlayer2Player.cpp
 
     HEADERS += MediaDevices/IpodDevice_linux.h \
+               MediaDevices/IpodMountWatcher_linux.h \
+               MediaDevices/IpodPlayCountDiff.h \
                Mpris2/Mpris2.h \
                Mpris2/DBusAbstractAdaptor.h \
                Mpris2/MediaPlayer2.h \
@@ -0,0 +1,131 @@
+/*
+   Copyright 2005-2009 Last.fm Ltd. 
+      - Primarily authored by Max Howell, Jono Cole, Erik Jaelevik, 
+        Christian Muehlhaeuser
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "IPod.h"
+#include "PlayCountsDatabase_p.h"
+#include "TwiddlyApplication.h"
+#include "ITunesLibrarySource.h"
+#include "common/c++/fileCreationTime.cpp"
+#include "lib/unicorn/UnicornSettings.h"
+#include <lastfm/misc.h>
+#include <iostream>
+
+
+AutomaticIPod::PlayCountsDatabase::PlayCountsDatabase() 
+#ifdef Q_OS_MAC
+              : ::PlayCountsDatabase( lastfm::dir::runtimeData().filePath( "iTunesPlays.db" ) )
+#else
+              : ::PlayCountsDatabase( lastfm::dir::runtimeData().filePath( "Client/iTunesPlays.db" ) )
+#endif
+{}
+
+
+bool
+AutomaticIPod::PlayCountsDatabase::isBootstrapNeeded() const
+{
+    QSqlQuery q( m_db );
+    q.exec( "SELECT value FROM metadata WHERE key='bootstrap_complete'" );
+    if (q.next() && q.value( 0 ).toString() == "true")
+        return false;
+        
+    return true;
+}
+
+
+static QString
+pluginPath()
+{
+  #ifdef Q_OS_MAC
+    QString path = std::getenv( "HOME" );
+    path += "/Library/iTunes/iTunes Plug-ins/AudioScrobbler.bundle/Contents/MacOS/AudioScrobbler";
+    return path;
+  #else
+    QSettings settings( "HKEY_LOCAL_MACHINE\\SOFTWARE\\Last.fm\\Client\\Plugins\\", QSettings::NativeFormat );
+    QString path = settings.value( "itw/Path" ).toString();
+    if (path.isEmpty())
+        throw "Unknown iTunes plugin path";
+    return path;
+  #endif
+}
+
+namespace
+{
+    /** prints how many tracks have been read for the wizard progress screen */
+    class ProgressSource : public TrackSource
+    {
+        TrackSource& m_source;
+        int m_count;
+
+    public:
+        ProgressSource( TrackSource& source ) : m_source( source ), m_count( 0 )
+        {}
+
+        virtual int trackCount() const { return m_source.trackCount(); }
+        virtual bool hasTracks() const { return m_source.hasTracks(); }
+
+        virtual Track nextTrack()
+        {
+            Track const t = m_source.nextTrack();
+            std::cout << ++m_count << std::endl;
+            return t;
+        }
+    };
+}
+
+
+void
+AutomaticIPod::PlayCountsDatabase::bootstrap()
+{
+    qDebug() << "Starting bootstrapping...";
+    
+    static_cast<TwiddlyApplication*>(qApp)->sendBusMessage( "container://Notification/Twiddly/Bootstrap/Started" );
+
+    ITunesLibrarySource lib;
+
+    // for wizard progress screen
+    std::cout << lib.trackCount() << std::endl;
+
+    // before the transaction so a throw doesn't leave us in bulk mode
+    QString const t = QString::number( common::fileCreationTime( pluginPath() ) );
+
+    setBulkMode( true );
+    beginTransaction();    
+    
+    QSqlQuery query( m_db );
+    // this will fail if the metadata table doesn't exist, which is fine
+    query.exec( "DELETE FROM metadata WHERE key='bootstrap_complete'" );
+    query.exec( "DELETE FROM metadata WHERE key='plugin_ctime'" );
+    query.exec( "DELETE FROM " TABLE_NAME_OLD );
+    query.exec( "DELETE FROM " TABLE_NAME );
+
+    ProgressSource progress( lib );
+    insert( progress );
+
+    // if either INSERTS fail we'll rebootstrap next time
+    query.exec( "CREATE TABLE metadata (key VARCHAR( 32 ), value VARCHAR( 32 ))" );
+    query.exec( "INSERT INTO metadata (key, value) VALUES ('bootstrap_complete', 'true')" );
+    query.exec( "INSERT INTO metadata (key, value) VALUES ('plugin_ctime', '"+t+"')" );
+
+
+    endTransaction();
+    setBulkMode( false );
+
+    static_cast<TwiddlyApplication*>(qApp)->sendBusMessage( "container://Notification/Twiddly/Bootstrap/Finished" );
+}
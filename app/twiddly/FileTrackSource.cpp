@@ -0,0 +1,195 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "FileTrackSource.h"
+#include "IPodScrobble.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+
+
+namespace
+{
+    /** Keeps the record as it was read, the metadata is only needed for the
+      * few tracks that get scrobbled */
+    struct FileTrackData : public TrackSource::TrackData
+    {
+        FileTrackData( const QStringList& r, const QVector<int>& c )
+            : TrackSource::TrackData( field( r, c, FileTrackSource::PersistentId ),
+                                      field( r, c, FileTrackSource::PlayCount ).toInt() ),
+              record( r ),
+              columns( c )
+        {}
+
+        static QString field( const QStringList& record, const QVector<int>& columns, int column )
+        {
+            return record.value( columns[column] );
+        }
+
+        QString field( int column ) const { return field( record, columns, column ); }
+
+        virtual lastfm::Track lastfmTrack() const
+        {
+            IPodScrobble t;
+            t.setSource( lastfm::Track::MediaDevice );
+            t.setArtist( field( FileTrackSource::Artist ) );
+            t.setAlbumArtist( field( FileTrackSource::AlbumArtist ) );
+            t.setTitle( field( FileTrackSource::Title ) );
+            t.setDuration( field( FileTrackSource::Duration ).toUInt() );
+            t.setAlbum( field( FileTrackSource::Album ) );
+            t.setPlayCount( playCount );
+            t.setTimeStamp( lastPlayed() );
+            t.setPodcast( field( FileTrackSource::Podcast ) == "true" );
+            t.setVideo( field( FileTrackSource::Video ) == "true" );
+
+            const QString path = field( FileTrackSource::Path );
+            if ( !path.isEmpty() )
+                t.setUrl( QUrl::fromLocalFile( QFileInfo( path ).absoluteFilePath() ) );
+
+            return t;
+        }
+
+        QDateTime lastPlayed() const
+        {
+            const QString s = field( FileTrackSource::LastPlayed );
+
+            bool ok;
+            uint unixTime = s.toUInt( &ok );
+            if ( ok )
+                return QDateTime::fromTime_t( unixTime );
+
+            return QDateTime::fromString( s, "yyyy-MM-dd hh:mm:ss" );
+        }
+
+        QStringList record;
+        QVector<int> columns;
+    };
+}
+
+
+FileTrackSource::FileTrackSource( const QString& path )
+               : m_file( path ),
+                 m_columns( ColumnCount, -1 )
+{
+    if ( !m_file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+        throw "Could not open " + path;
+
+    m_stream.setDevice( &m_file );
+    m_stream.setCodec( "UTF-8" );
+
+    const QStringList header = readRecord();
+    const QStringList names = columnNames();
+
+    for ( int i = 0; i < header.count(); ++i )
+    {
+        int const column = names.indexOf( header[i].trimmed() );
+        if ( column != -1 )
+            m_columns[column] = i;
+    }
+
+    if ( m_columns[PersistentId] == -1 || m_columns[PlayCount] == -1 )
+        throw "No persistent_id and play_count columns in " + path;
+}
+
+
+QStringList //static
+FileTrackSource::columnNames()
+{
+    return QStringList() << "persistent_id" << "play_count" << "last_played"
+                         << "artist" << "album_artist" << "title" << "album"
+                         << "duration" << "path" << "podcast" << "video";
+}
+
+
+QString //static
+FileTrackSource::escape( const QString& field )
+{
+    if ( !field.contains( ',' ) && !field.contains( '"' ) && !field.contains( '\n' ) )
+        return field;
+
+    return '"' + QString( field ).replace( '"', "\"\"" ) + '"';
+}
+
+
+bool
+FileTrackSource::hasTracks() const
+{
+    return !m_stream.atEnd();
+}
+
+
+TrackSource::Track
+FileTrackSource::nextTrack()
+{
+    QStringList const record = readRecord();
+
+    // blank lines and lines without an id are null tracks like any other
+    // that can't be read
+    return Track( new FileTrackData( record, m_columns ) );
+}
+
+
+QStringList
+FileTrackSource::readRecord()
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+
+    QString line = m_stream.readLine();
+
+    for ( int i = 0; ; ++i )
+    {
+        if ( i == line.length() )
+        {
+            // a newline inside quotes is part of the field
+            if ( !quoted || m_stream.atEnd() )
+                break;
+
+            field += '\n';
+            line = m_stream.readLine();
+            i = -1;
+            continue;
+        }
+
+        QChar const c = line[i];
+
+        if ( quoted )
+        {
+            if ( c != '"' )
+                field += c;
+            else if ( i + 1 < line.length() && line[i + 1] == '"' )
+                field += line[++i];
+            else
+                quoted = false;
+        }
+        else if ( c == '"' )
+            quoted = true;
+        else if ( c == ',' )
+        {
+            fields += field;
+            field.clear();
+        }
+        else
+            field += c;
+    }
+
+    fields += field;
+    return fields;
+}
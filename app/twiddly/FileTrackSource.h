@@ -0,0 +1,82 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef FILE_TRACK_SOURCE_H
+#define FILE_TRACK_SOURCE_H
+
+#include "TrackSource.h"
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+
+/** Reads the tracks from a CSV dump of a library, one track per line. Needs
+  * nothing but the file, so the diff can be run and profiled anywhere.
+  *
+  * The first line names the columns, in any order:
+  *
+  *     persistent_id,play_count,last_played,artist,album_artist,title,album,duration,path,podcast,video
+  *
+  * persistent_id and play_count are required. last_played is either a unix
+  * time or "yyyy-MM-dd hh:mm:ss". podcast and video are "true" or "false".
+  * Fields can be quoted with " and a "" in a quoted field is a ".
+  */
+class FileTrackSource : public TrackSource
+{
+public:
+    enum Column
+    {
+        PersistentId,
+        PlayCount,
+        LastPlayed,
+        Artist,
+        AlbumArtist,
+        Title,
+        Album,
+        Duration,
+        Path,
+        Podcast,
+        Video,
+        ColumnCount
+    };
+
+    FileTrackSource( const QString& path ); // throws
+
+    /** always -1, we only know once the whole file has been read */
+    virtual int trackCount() const { return -1; }
+    virtual bool hasTracks() const;
+    virtual Track nextTrack();
+
+    /** the columns' names in the header line */
+    static QStringList columnNames();
+
+    /** quotes the field if it needs it */
+    static QString escape( const QString& field );
+
+private:
+    QStringList readRecord();
+
+    QFile m_file;
+    QTextStream m_stream;
+
+    /** where each Column is in a record, -1 if the file doesn't have it */
+    QVector<int> m_columns;
+};
+
+#endif
@@ -21,10 +21,11 @@
 #include "lib/unicorn/mac/AppleScript.h"
 #include "IPod.h"
 #include "IPodScrobble.h"
-#include "ITunesLibrary.h"
+#include "FileTrackSource.h"
+#include "LibraryFingerprint.h"
 #include "PlayCountsDatabase.h"
+#include "PlayCountsDiff.h"
 #include "common/qt/msleep.cpp"
-#include "plugins/iTunes/ITunesExceptions.h"
 #include <lastfm/misc.h>
 #include <lastfm/Track.h>
 #include <QtCore>
@@ -78,6 +79,8 @@ IPod::fromCommandLineArguments( const QStringList& args )
     ipod->name = map["name"];
     if (ipod->name.isEmpty())
         ipod->name = ipod->serial;
+
+    ipod->libraryPath = map["library"];
     
     #undef THROW_IF_EMPTY
     
@@ -131,145 +134,73 @@ IPod::ScrobbleList::xml() const
   * comparing that with the actual state of the iTunes Library database after
   * an iPod is synced with it
   */
-void
-IPod::twiddle()
+namespace
 {
-    PlayCountsDatabase& db = *playCountsDatabase();
-    ITunesLibrary& library = *iTunesLibrary();
+    /** what twiddle() remembers about a device between runs */
+    class DiffSettings : public unicorn::AppSettings
+    {
+    public:
+        DiffSettings( const IPod* ipod )
+        {
+            beginGroup( "device/" + ipod->uid() + "/diff" );
+        }
+    };
+}
 
-    QList<ITunesLibrary::Track> tracksToUpdate;
-    QList<ITunesLibrary::Track> tracksToInsert;
-    QList<ITunesLibrary::Track> tracksToScrobble;
 
-    int nullTrackCount = 0;
+void
+IPod::twiddle()
+{
+    // taken before the library is read so that if it is written to while we
+    // read it, the next run diffs again
+    LibraryFingerprint const fingerprint( libraryPath.isEmpty() ? databasePath() : libraryPath );
 
-    // If creation of the library class failed due to a dialog showing in iTunes
-    // or COM not responding for some other reason, hasTracks will just return false
-    // and we will quit this run.
-    while ( library.hasTracks() )
+    if ( !fingerprint.isNull()
+         && fingerprint == LibraryFingerprint::fromString( DiffSettings( this ).value( "LibraryFingerprint" ).toString() ) )
     {
-        try
-        {
-            ITunesLibrary::Track track = library.nextTrack();
-
-            if ( track.isNull() )
-            {
-                // Failed to read current iTunes track. Either something went wrong,
-                // or the track was not found on the disk despite being in the iTunes library.
-
-                // Don't log every error as this could be a library full of iTunes Match tracks
-                // just count how many failed and say at the end
-
-                ++nullTrackCount;
-                continue;
-            }
-
-            QString id = track.uniqueId();
-
-            // We don't know about this track yet, this means either:-
-            //   1. The track was added to iTunes since the last sync. thus it is
-            //      impossible for it to have been played on the iPod
-            //   2. On Windows, the path of the track changed since the last sync.
-            //      Since we don't have persistent IDs on Windows we have no way of 
-            //      matching up this track up with its previous incarnation. Thus
-            //      we don't scrobble it as we have no idea if it was played or not
-            //      chances are, it wasn't
-            PlayCountsDatabase::Track dbTrack = db[id];
-
-            if ( dbTrack.isNull() )
-            {
-                tracksToInsert << track;
-                continue;
-            }
-
-            const int diff = track.playCount() - dbTrack.playCount(); // can throw
-        
-            if ( diff > 0 )
-                tracksToScrobble << track;
-
-            // a worthwhile optimisation since updatePlayCount() is really slow
-            // NOTE negative diffs *are* possible
-            if ( diff < 0 )
-                tracksToUpdate << track; // can throw
-        }
-        catch ( ITunesException& )
-        {
-            // Carry on...
-        }
+        DiffSettings( this ).setValue( "Skipped", diffsSkipped() + 1 );
+        qDebug() << "Library unchanged since the last diff, skipping it";
+        return;
     }
 
-    qDebug() << "There were " << nullTrackCount << " null tracks";
+    // diff() and commit() throw, declared before the diff which refers to them
+    QScopedPointer<PlayCountsDatabase> const db( playCountsDatabase() );
+    QScopedPointer<TrackSource> const source( libraryPath.isEmpty()
+            ? trackSource()
+            : new FileTrackSource( libraryPath ) );
+
+    PlayCountsDiff diff( *db );
+    diff.diff( *source );
 
-    if ( tracksToUpdate.count() + tracksToInsert.count() + tracksToScrobble.count() > 0 )
+    foreach ( const ::Track& t, diff.commit() )
     {
-        // We've got some updates and inserts to do so lock the database and do them
+        IPodScrobble scrobble( t );
+        scrobble.setMediaDeviceId( scrobbleId() );
+        m_scrobbles += scrobble;
+    }
 
-        db.beginTransaction();
+    DiffSettings( this ).setValue( "Run", diffsRun() + 1 );
 
-        foreach ( const ITunesLibrary::Track& track, tracksToScrobble )
-        {
-            try
-            {
-                ::Track t = track.lastfmTrack(); // can throw
-
-                // Because we take a snapshot of our playcounts db there is a possible race condition.
-                // use db.track here to fetch the latest playcount now that we've locked the database
-                const int diff = track.playCount() - db.track( track.uniqueId() ).playCount();
-
-                if ( !t.isNull() )
-                {
-                    if ( t.timestamp().secsTo( QDateTime::currentDateTime() ) > 30 )
-                    {
-                        // we only scrobble tracks with a timestamp older than 30 seconds
-                        // to give the iTunes plugin time so update the playcount db
-                        // after a track change - bit of a hack, but it stops spurious iPod scrobbles
-
-                        // update the playcount db to the current playcount for this track
-                        // this means that we won't try to scrobble the track again
-                        db.update( track );
-
-                        IPodScrobble t2( t );
-                        t2.setPlayCount( diff );
-                        t2.setMediaDeviceId( scrobbleId() );
-                        t2.setUniqueId( track.uniqueId() );
-                        m_scrobbles += t2;
-                        qDebug() << diff << "scrobbles found for" << t;
-                    }
-                    else
-                    {
-                        qDebug() << "Timestamp less than 30 seconds. Don't scrobble yet.";
-                    }
-                }
-                else
-                {
-                    qWarning() << "Couldn't get Track for" << track.uniqueId();
-
-                    // We get here if COM fails to populate the Track for whatever reason.
-                    // Therefore we continue and don't let the local db update. That way we
-                    // maintain the diff and we should be picking up on it next time twiddly
-                    // runs.
-                    continue;
-                }
-            }
-            catch ( ITunesException& )
-            {
-                // Carry on...
-            }
-        }
+    // only now that the diff is committed, and only if nothing was left for
+    // the next run, or it would be skipped while the library is unchanged
+    if ( diff.deferredTrackCount() == 0 )
+        DiffSettings( this ).setValue( "LibraryFingerprint", fingerprint.toString() );
+    else
+        qDebug() << diff.deferredTrackCount() << "tracks left for the next run";
+}
 
-        // this should just be tracks with negative playcount diffs
-        foreach ( const ITunesLibrary::Track& track, tracksToUpdate )
-            db.update( track );
 
-        // insert all the new tracks we've found
-        foreach ( const ITunesLibrary::Track& track, tracksToInsert )
-            db.insert( track );
+int
+IPod::diffsRun() const
+{
+    return DiffSettings( this ).value( "Run" ).toInt();
+}
 
-        db.endTransaction();
-    }
 
-    delete &db;
-    delete &library;
+int
+IPod::diffsSkipped() const
+{
+    return DiffSettings( this ).value( "Skipped" ).toInt();
 }
 
 
@@ -18,7 +18,7 @@
    You should have received a copy of the GNU General Public License
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
-#include "ITunesLibrary.h"
+#include "ITunesLibrarySource.h"
 #include "IPodScrobble.h"
 #include "IPodSettings.h"
 #include "PlayCountsDatabase.h"
@@ -38,9 +38,15 @@ public:
     /** you own the memory */
     static IPod* fromCommandLineArguments( const QStringList& );
     
-    /** figures out the iPod scrobbles */
+    /** figures out the iPod scrobbles, unless the library database hasn't
+      * changed since the last time it did */
     void twiddle();
 
+    /** how many times twiddle() diffed the library for this device, and how
+      * many times it found it unchanged and didn't */
+    int diffsRun() const;
+    int diffsSkipped() const;
+
     /** allows us to encapsulate the real scrobble count() */
     class ScrobbleList : private QList<Track>
     {
@@ -94,13 +100,20 @@ public:
     QString serial;
     QString name;
 
+    /** a dump of the library to diff instead of asking iTunes, see
+      * FileTrackSource */
+    QString libraryPath;
+
 protected:    
     ScrobbleList m_scrobbles;
 
     /** heap allocate and return those relevent to your iPod type */
     virtual class PlayCountsDatabase* playCountsDatabase() = 0;
-    virtual class ITunesLibrary* iTunesLibrary() = 0;
+    virtual class TrackSource* trackSource() = 0;
 
+    /** the file trackSource() reads, so we can tell if it changed without
+      * reading it. Empty if we can't tell, then we always diff. */
+    virtual QString databasePath() const { return QString(); }
 };
 
 
@@ -120,7 +133,8 @@ public:
 
 private:
     virtual PlayCountsDatabase* playCountsDatabase() { return new PlayCountsDatabase; }
-    virtual ITunesLibrary* iTunesLibrary() { return new ITunesLibrary; }
+    virtual TrackSource* trackSource() { return new ITunesLibrarySource; }
+    virtual QString databasePath() const { return ITunesLibrarySource::databasePath(); }
 };
 
 
@@ -138,16 +152,12 @@ public:
         {}
     };
 
-    class Library : public ITunesLibrary
-    {
-    public:
-        Library( const QString& pid ) : ITunesLibrary( pid, true )
-        {}
-    };
-
 private:
     virtual PlayCountsDatabase* playCountsDatabase() { return new PlayCountsDatabase( this ); }
-    virtual ITunesLibrary* iTunesLibrary() { return new Library( m_pid ); }
+    virtual TrackSource* trackSource() { return new ITunesLibrarySource( m_pid, true ); }
+
+    // no databasePath(), iTunes reads the play counts off the iPod without
+    // necessarily writing the library, so we can't tell if they changed
 
     /** persistent ID of the iPod source, mac only */
     QString const m_pid;
@@ -0,0 +1,110 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ITunesLibrarySource.h"
+#include "plugins/iTunes/ITunesExceptions.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+
+
+namespace
+{
+    struct ITunesTrackData : public TrackSource::TrackData
+    {
+        ITunesTrackData( const ITunesLibrary::Track& t ) // can throw
+            : TrackSource::TrackData( t.uniqueId(), t.playCount() ), track( t )
+        {}
+
+        virtual lastfm::Track lastfmTrack() const
+        {
+            try
+            {
+                return track.lastfmTrack();
+            }
+            catch ( ITunesException& )
+            {
+                return lastfm::Track();
+            }
+        }
+
+        ITunesLibrary::Track track;
+    };
+}
+
+
+ITunesLibrarySource::ITunesLibrarySource( const QString& source, bool isIPod )
+                    : m_library( source, isIPod )
+{}
+
+
+int
+ITunesLibrarySource::trackCount() const
+{
+    return m_library.trackCount();
+}
+
+
+bool
+ITunesLibrarySource::hasTracks() const
+{
+    // If creation of the library failed due to a dialog showing in iTunes
+    // or COM not responding for some other reason, this will just be false
+    return m_library.hasTracks();
+}
+
+
+TrackSource::Track
+ITunesLibrarySource::nextTrack()
+{
+    try
+    {
+        ITunesLibrary::Track track = m_library.nextTrack();
+
+        // Either something went wrong, or the track was not found on the disk
+        // despite being in the iTunes library
+        if ( track.isNull() )
+            return Track();
+
+        return Track( new ITunesTrackData( track ) );
+    }
+    catch ( ITunesException& )
+    {
+        return Track();
+    }
+}
+
+
+QString //static
+ITunesLibrarySource::databasePath()
+{
+#ifdef WIN32
+    QSettings const folders( "HKEY_CURRENT_USER\\Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\Shell Folders", QSettings::NativeFormat );
+    QDir const dir( folders.value( "My Music" ).toString() + "/iTunes" );
+#else
+    QDir const dir( QDir::homePath() + "/Music/iTunes" );
+#endif
+
+    // iTunes 9 and later, then the versions before
+    foreach ( const QString& name, QStringList() << "iTunes Library.itl" << "iTunes Library" )
+        if ( QFile::exists( dir.filePath( name ) ) )
+            return dir.filePath( name );
+
+    return QString();
+}
@@ -0,0 +1,47 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ITUNES_LIBRARY_SOURCE_H
+#define ITUNES_LIBRARY_SOURCE_H
+
+#include "ITunesLibrary.h"
+#include "TrackSource.h"
+
+
+/** Reads the tracks from iTunes with AppleScript or COM. Failures to talk to
+  * iTunes are turned into null tracks so the diff can carry on.
+  */
+class ITunesLibrarySource : public TrackSource
+{
+public:
+    /** the arguments are passed on to ITunesLibrary */
+    ITunesLibrarySource( const QString& source = "", bool isIPod = false ); // throws
+
+    virtual int trackCount() const;
+    virtual bool hasTracks() const;
+    virtual Track nextTrack();
+
+    /** The iTunes Library file in its default location, or an empty string
+      * if it isn't there. Doesn't ask iTunes, so it is quick. */
+    static QString databasePath();
+
+private:
+    ITunesLibrary m_library;
+};
+
+#endif
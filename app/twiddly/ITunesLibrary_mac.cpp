@@ -26,6 +26,13 @@
 #include <QStringList>
 #include <QDebug>
 
+static bool
+uniqueIdLessThan( const ITunesLibrary::Track& a, const ITunesLibrary::Track& b )
+{
+    return a.uniqueId() < b.uniqueId();
+}
+
+
 ITunesLibrary::ITunesLibrary( const QString& pid, bool )
         : m_currentIndex( 0 )
 {
@@ -59,6 +66,9 @@ ITunesLibrary::ITunesLibrary( const QString& pid, bool )
         m_tracks += t;
     }
     
+    // in persistent id order they merge straight into the play counts snapshot
+    qSort( m_tracks.begin(), m_tracks.end(), uniqueIdLessThan );
+
     qDebug() << "Found" << m_tracks.count() << "tracks";
 }
 
@@ -0,0 +1,99 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "LibraryFingerprint.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+// the blocks we hash, the first and last block are always among them
+#define SAMPLE_COUNT 16
+#define SAMPLE_SIZE 4096
+
+
+LibraryFingerprint::LibraryFingerprint( const QString& path )
+                  : m_size( -1 ), m_modified( 0 )
+{
+    if ( path.isEmpty() )
+        return;
+
+    QFile file( path );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return;
+
+    QFileInfo const info( file );
+    m_size = info.size();
+    m_modified = info.lastModified().toTime_t();
+
+    QCryptographicHash hash( QCryptographicHash::Md5 );
+
+    if ( m_size <= SAMPLE_COUNT * SAMPLE_SIZE )
+        hash.addData( file.readAll() );
+    else
+    {
+        qint64 const step = ( m_size - SAMPLE_SIZE ) / ( SAMPLE_COUNT - 1 );
+
+        for ( int i = 0; i < SAMPLE_COUNT; ++i )
+        {
+            file.seek( i * step );
+            hash.addData( file.read( SAMPLE_SIZE ) );
+        }
+    }
+
+    if ( file.error() == QFile::NoError )
+        m_hash = hash.result();
+}
+
+
+bool
+LibraryFingerprint::operator==( const LibraryFingerprint& that ) const
+{
+    return !isNull()
+            && m_size == that.m_size
+            && m_modified == that.m_modified
+            && m_hash == that.m_hash;
+}
+
+
+QString
+LibraryFingerprint::toString() const
+{
+    if ( isNull() )
+        return QString();
+
+    return QString::number( m_size ) + ':' + QString::number( m_modified ) + ':' + m_hash.toHex();
+}
+
+
+LibraryFingerprint //static
+LibraryFingerprint::fromString( const QString& s )
+{
+    LibraryFingerprint f;
+    QStringList const parts = s.split( ':' );
+
+    if ( parts.count() == 3 )
+    {
+        f.m_size = parts[0].toLongLong();
+        f.m_modified = parts[1].toUInt();
+        f.m_hash = QByteArray::fromHex( parts[2].toAscii() );
+    }
+
+    return f;
+}
@@ -0,0 +1,58 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LIBRARY_FINGERPRINT_H
+#define LIBRARY_FINGERPRINT_H
+
+#include <QByteArray>
+#include <QString>
+
+
+/** Identifies a version of a library database file, eg. iTunes Library.itl,
+  * cheaply enough to check before every diff. If the fingerprint hasn't
+  * changed since the last successful diff, neither have the play counts.
+  *
+  * It is the size, the modification time and an MD5 of a few blocks spread
+  * through the file, so it costs the same to take however big the library is.
+  */
+class LibraryFingerprint
+{
+public:
+    /** null, never equal to anything */
+    LibraryFingerprint() : m_size( -1 ), m_modified( 0 )
+    {}
+
+    /** null if path is empty or can't be read */
+    explicit LibraryFingerprint( const QString& path );
+
+    bool isNull() const { return m_hash.isEmpty(); }
+
+    bool operator==( const LibraryFingerprint& that ) const;
+    bool operator!=( const LibraryFingerprint& that ) const { return !operator==( that ); }
+
+    /** for keeping in QSettings */
+    QString toString() const;
+    static LibraryFingerprint fromString( const QString& );
+
+private:
+    qint64 m_size;
+    uint m_modified;
+    QByteArray m_hash;
+};
+
+#endif
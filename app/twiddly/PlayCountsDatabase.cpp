@@ -19,63 +19,39 @@
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "PlayCountsDatabase.h"
-#include "TwiddlyApplication.h"
-#include "IPod.h"
-#include "ITunesLibrary.h"
+#include "PlayCountsDatabase_p.h"
+#include "TrackSource.h"
 #include "common/qt/msleep.cpp"
-#include "common/c++/fileCreationTime.cpp"
-#include "lib/unicorn/UnicornSettings.h"
-#include "lib/unicorn/mac/AppleScript.h"
-#include <lastfm/misc.h>
+#include "common/c++/Logger.h"
+#include <QDateTime>
 #include <QSqlDatabase>
-#include <QSqlError>
-#include <QSqlQuery>
-#include <QTemporaryFile>
-#include <iostream>
-#include <QDebug>
-
-#define TABLE_NAME_OLD "itunes_db"
-#define TABLE_NAME "playcounts"
-#define SCHEMA "persistent_id   VARCHAR( 32 ) PRIMARY KEY," \
-               "play_count      INTEGER"
-#define INDEX "persistent_id"
-
-
-/** @author Max Howell <max@last.fm>
-  * @brief automatically log sql errors */
-namespace QtOverrides
+#include <QStringList>
+
+
+// rows bound per execBatch()
+#define BATCH_SIZE 1000
+
+
+static QString
+sql( PlayCountsDatabase::BulkWriter::Mode mode )
 {
-    class SqlQuery : public ::QSqlQuery
+    switch (mode)
     {
-        // this is called arse because both check and verify wouldn't compile!
-        bool arse( bool success )
-        {
-            if (!success)
-                qWarning() << lastError().text() << "in query:\n" << lastQuery();
-            return success;
-        }
-        
-    public:
-        SqlQuery( QSqlDatabase db ) : QSqlQuery( db )
-        {}
-                
-        bool exec()
-        {
-            return arse( QSqlQuery::exec() );
-        }
-        
-        bool exec( const QString& sql )
-        {
-            return arse( QSqlQuery::exec( sql ) );
-        }
-    };
+        case PlayCountsDatabase::BulkWriter::Insert:
+            return "INSERT OR ROLLBACK INTO " TABLE_NAME " ( persistent_id, play_count ) VALUES ( ?, ? )";
+        case PlayCountsDatabase::BulkWriter::InsertOrIgnore:
+            return "INSERT OR IGNORE INTO " TABLE_NAME " ( persistent_id, play_count ) VALUES ( ?, ? )";
+        case PlayCountsDatabase::BulkWriter::Update:
+        default:
+            return "UPDATE OR ROLLBACK " TABLE_NAME " SET play_count = ? WHERE persistent_id = ?";
+    }
 }
 
-#define QSqlQuery QtOverrides::SqlQuery
-
 
 PlayCountsDatabase::PlayCountsDatabase( const QString& path )
-                   : m_path( path )
+                   : m_insertQuery( 0 ),
+                     m_updateQuery( 0 ),
+                     m_path( path )
 {
     qDebug() << path;
 
@@ -115,10 +91,20 @@ PlayCountsDatabase::PlayCountsDatabase( const QString& path )
             int count = snapshotQuery.value( 1 ).toInt( &ok );
 
             if ( ok )
-                m_snapshot[snapshotQuery.value(0).toString()] = count;
+            {
+                QString const uid = snapshotQuery.value( 0 ).toString();
+                quint64 key;
+
+                if ( unicorn::PlayCountsMerge::decodePersistentId( uid, &key ) )
+                    m_merge.addPrevious( key, count );
+                else
+                    m_snapshot[uid] = count;
+            }
 
         } while ( snapshotQuery.next() );
     }
+
+    qDebug() << "Snapshot has" << m_merge.count() << "persistent ids and" << m_snapshot.count() << "others";
 }
 
 
@@ -129,15 +115,28 @@ PlayCountsDatabase::~PlayCountsDatabase()
     //m_db.close();
 
     delete m_query;
-
+    delete m_insertQuery;
+    delete m_updateQuery;
 }
 
 
 PlayCountsDatabase::Track
 PlayCountsDatabase::operator[]( const QString& uid )
 {
-    if ( m_snapshot.contains( uid ) )
-        return Track( uid, m_snapshot[uid] );
+    quint64 key;
+
+    if ( unicorn::PlayCountsMerge::decodePersistentId( uid, &key ) )
+    {
+        if ( const unicorn::PlayCountsMerge::PlayCount* previous = m_merge.find( key ) )
+            return Track( uid, previous->playCount );
+    }
+    else
+    {
+        QHash<QString, int>::const_iterator i = m_snapshot.constFind( uid );
+
+        if ( i != m_snapshot.constEnd() )
+            return Track( uid, i.value() );
+    }
 
     return Track();
 }
@@ -165,6 +164,45 @@ PlayCountsDatabase::track( const QString& uid )
 }
 
 
+QHash<QString, int>
+PlayCountsDatabase::playCounts( const QStringList& uids )
+{
+    // SQLite allows 999 bound parameters per statement
+    const int kChunk = 500;
+
+    QHash<QString, int> counts;
+
+    for ( int i = 0; i < uids.count(); i += kChunk )
+    {
+        QStringList const chunk = uids.mid( i, kChunk );
+
+        QStringList placeholders;
+        for ( int j = 0; j < chunk.count(); ++j )
+            placeholders << "?";
+
+        QSqlQuery query( m_db );
+        query.prepare( "SELECT persistent_id, play_count FROM " TABLE_NAME " "
+                       "WHERE persistent_id IN ( " + placeholders.join( "," ) + " )" );
+
+        foreach ( const QString& uid, chunk )
+            query.addBindValue( uid );
+
+        query.exec();
+
+        while ( query.next() )
+        {
+            bool ok;
+            int count = query.value( 1 ).toInt( &ok );
+
+            if ( ok )
+                counts[query.value( 0 ).toString()] = count;
+        }
+    }
+
+    return counts;
+}
+
+
 void
 PlayCountsDatabase::beginTransaction()
 {
@@ -198,112 +236,146 @@ PlayCountsDatabase::endTransaction()
 }
 
 bool
-PlayCountsDatabase::insert( const ITunesLibrary::Track& track )
+PlayCountsDatabase::insert( const Track& track )
 {
-    QString playCount = QString::number( track.playCount() );  
-    QString sql = "INSERT OR ROLLBACK INTO " TABLE_NAME " ( persistent_id, play_count ) "
-                  "VALUES ( '" + track.persistentId() + "', '" + playCount + "' )";
-    return QSqlQuery( m_db ).exec( sql );
+    if ( !m_insertQuery )
+    {
+        m_insertQuery = new QSqlQuery( m_db );
+        m_insertQuery->prepare( sql( BulkWriter::Insert ) );
+    }
+
+    m_insertQuery->bindValue( 0, track.uniqueId() );
+    m_insertQuery->bindValue( 1, track.playCount() );
+
+    bool const success = m_insertQuery->exec();
+
+    if ( !success )
+        qWarning() << m_insertQuery->lastError().text() << "in query:\n" << m_insertQuery->lastQuery();
+
+    return success;
 }
 
 bool
-PlayCountsDatabase::update( const ITunesLibrary::Track& track )
+PlayCountsDatabase::update( const Track& track )
 {
-    QString playCount = QString::number( track.playCount() );  
-    QString sql = "UPDATE OR ROLLBACK " TABLE_NAME " "
-                  "SET play_count='" + playCount + "' "
-                  "WHERE persistent_id='" + track.persistentId() + "'";
-    return QSqlQuery( m_db ).exec( sql );
-}
+    if ( !m_updateQuery )
+    {
+        m_updateQuery = new QSqlQuery( m_db );
+        m_updateQuery->prepare( sql( BulkWriter::Update ) );
+    }
 
-AutomaticIPod::PlayCountsDatabase::PlayCountsDatabase() 
-#ifdef Q_OS_MAC
-              : ::PlayCountsDatabase( lastfm::dir::runtimeData().filePath( "iTunesPlays.db" ) )
-#else
-              : ::PlayCountsDatabase( lastfm::dir::runtimeData().filePath( "Client/iTunesPlays.db" ) )
-#endif
-{}
+    m_updateQuery->bindValue( 0, track.playCount() );
+    m_updateQuery->bindValue( 1, track.uniqueId() );
 
+    bool const success = m_updateQuery->exec();
 
-bool
-AutomaticIPod::PlayCountsDatabase::isBootstrapNeeded() const
-{
-    QSqlQuery q( m_db );
-    q.exec( "SELECT value FROM metadata WHERE key='bootstrap_complete'" );
-    if (q.next() && q.value( 0 ).toString() == "true")
-        return false;
-        
-    return true;
+    if ( !success )
+        qWarning() << m_updateQuery->lastError().text() << "in query:\n" << m_updateQuery->lastQuery();
+
+    return success;
 }
 
 
-static QString
-pluginPath()
+int
+PlayCountsDatabase::insert( TrackSource& source )
 {
-  #ifdef Q_OS_MAC
-    QString path = std::getenv( "HOME" );
-    path += "/Library/iTunes/iTunes Plug-ins/AudioScrobbler.bundle/Contents/MacOS/AudioScrobbler";
-    return path;
-  #else
-    QSettings settings( "HKEY_LOCAL_MACHINE\\SOFTWARE\\Last.fm\\Client\\Plugins\\", QSettings::NativeFormat );
-    QString path = settings.value( "itw/Path" ).toString();
-    if (path.isEmpty())
-        throw "Unknown iTunes plugin path";
-    return path;
-  #endif
+    BulkWriter writer( *this, BulkWriter::InsertOrIgnore );
+    int count = 0;
+
+    while ( source.hasTracks() )
+    {
+        ++count;
+
+        TrackSource::Track const track = source.nextTrack();
+
+        if ( !track.isNull() )
+            writer.add( Track( track.uniqueId(), track.playCount() ) );
+    }
+
+    writer.flush();
+
+    return count;
 }
 
+
 void
-AutomaticIPod::PlayCountsDatabase::bootstrap()
+PlayCountsDatabase::setBulkMode( bool bulk )
 {
-    qDebug() << "Starting bootstrapping...";
-    
-    static_cast<TwiddlyApplication*>(qApp)->sendBusMessage( "container://Notification/Twiddly/Bootstrap/Started" );
+    // a pending read would stop the journal mode changing
+    m_query->finish();
 
-    beginTransaction();    
-    
     QSqlQuery query( m_db );
-    // this will fail if the metadata table doesn't exist, which is fine
-    query.exec( "DELETE FROM metadata WHERE key='bootstrap_complete'" );
-    query.exec( "DELETE FROM metadata WHERE key='plugin_ctime'" );
-    query.exec( "DELETE FROM " TABLE_NAME_OLD );
-    query.exec( "DELETE FROM " TABLE_NAME );
 
-    ITunesLibrary lib;
-    
-    // for wizard progress screen
-    std::cout << lib.trackCount() << std::endl;
-    
-    int i = 0;
-
-    while (lib.hasTracks())
+    if ( bulk )
     {
-        try
-        {
-            ITunesLibrary::Track const t = lib.nextTrack();
-            QString const plays = QString::number( t.playCount() );
+        // not fsyncing every commit is safe with WAL, a crash loses the
+        // bootstrap but not the database, and we'd rebootstrap anyway
+        query.exec( "PRAGMA journal_mode=WAL" );
+        query.exec( "PRAGMA synchronous=NORMAL" );
+    }
+    else
+    {
+        // the iTunes plugin's SQLite may be too old to read a WAL database
+        query.exec( "PRAGMA synchronous=FULL" );
+        query.exec( "PRAGMA journal_mode=DELETE" );
+    }
+}
 
-            query.exec( "INSERT OR IGNORE INTO " TABLE_NAME " ( persistent_id, play_count ) "
-                        "VALUES ( '" + t.uniqueId() + "', '" + plays + "' )" );
 
-        }
-        catch ( ... )
-        {
-            // Move on...
-        }
+PlayCountsDatabase::BulkWriter::BulkWriter( PlayCountsDatabase& db, Mode mode )
+                              : m_mode( mode ),
+                                m_count( 0 )
+{
+    m_query = new QSqlQuery( db.m_db );
+    m_query->prepare( sql( mode ) );
+}
+
 
-        std::cout << ++i << std::endl;
+PlayCountsDatabase::BulkWriter::~BulkWriter()
+{
+    delete m_query;
+}
+
+
+bool
+PlayCountsDatabase::BulkWriter::add( const Track& track )
+{
+    m_ids << track.uniqueId();
+    m_playCounts << track.playCount();
+
+    if ( m_ids.count() < BATCH_SIZE )
+        return true;
+
+    return flush();
+}
+
+
+bool
+PlayCountsDatabase::BulkWriter::flush()
+{
+    if ( m_ids.isEmpty() )
+        return true;
+
+    if ( m_mode == Update )
+    {
+        m_query->addBindValue( m_playCounts );
+        m_query->addBindValue( m_ids );
+    }
+    else
+    {
+        m_query->addBindValue( m_ids );
+        m_query->addBindValue( m_playCounts );
     }
 
-    // if either INSERTS fail we'll rebootstrap next time
-    query.exec( "CREATE TABLE metadata (key VARCHAR( 32 ), value VARCHAR( 32 ))" );
-    query.exec( "INSERT INTO metadata (key, value) VALUES ('bootstrap_complete', 'true')" );
-    
-    QString const t = QString::number( common::fileCreationTime( pluginPath() ) );
-    query.exec( "INSERT INTO metadata (key, value) VALUES ('plugin_ctime', '"+t+"')" );
+    bool const success = m_query->execBatch();
 
+    if ( success )
+        m_count += m_ids.count();
+    else
+        qWarning() << m_query->lastError().text() << "in query:\n" << m_query->lastQuery();
 
-    endTransaction();
+    m_ids.clear();
+    m_playCounts.clear();
 
-    static_cast<TwiddlyApplication*>(qApp)->sendBusMessage( "container://Notification/Twiddly/Bootstrap/Finished" );
+    return success;
 }
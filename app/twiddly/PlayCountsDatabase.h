@@ -21,13 +21,17 @@
 #ifndef PLAY_COUNT_DATABASE_H
 #define PLAY_COUNT_DATABASE_H
 
+#include "lib/unicorn/PlayCountsMerge.h"
 #include <QString>
 #include <QSqlDatabase>
 #include <QHash>
+#include <QStringList>
+#include <QVariantList>
 
 class QSqlQuery;
 
 class ITunesLibraryTrack;
+class TrackSource;
 
 
 /** @author Jono Cole <jono@last.fm>
@@ -66,10 +70,16 @@ public:
         int m_playCount;
     };
 
-    /** the uid is path on Windows, persistentId on mac */
+    /** the uid is path on Windows, persistentId on mac
+      * looking tracks up in persistent id order is a merge rather than a
+      * search, see unicorn::PlayCountsMerge */
     Track operator[]( const QString& uid ); // gets the snapshot value
     Track track( const QString& uid ); // this actually fetchs the current value
 
+    /** the current values for many tracks in a few queries, uids that aren't
+      * in the database are left out */
+    QHash<QString, int> playCounts( const QStringList& uids );
+
     // NOTE never put these in the ctor/dtor, as if exception is thrown we 
     // mustn't commit the transaction!
     void beginTransaction();
@@ -78,9 +88,54 @@ public:
     /** the justification for INSERT is manual ipod scrobbling, since we have
       * no bootstrap step, which is unavoidable, the first diff effectively
       * bootstraps the device */
-    bool insert( const ITunesLibraryTrack& track );
-    bool remove( const ITunesLibraryTrack& track );
-    bool update( const ITunesLibraryTrack& track );
+    bool insert( const Track& track );
+    bool remove( const Track& track );
+    bool update( const Track& track );
+
+    /** Writes many tracks with one prepared statement.
+      *
+      * Rows are bound and executed a batch at a time with execBatch(), so
+      * the SQL is parsed once rather than once per track. Use it inside a
+      * transaction and flush() before ending it.
+      */
+    class BulkWriter
+    {
+    public:
+        enum Mode
+        {
+            Insert,         // rolls back the transaction if the track is there
+            InsertOrIgnore, // leaves the existing row alone
+            Update          // does nothing for a track that isn't there
+        };
+
+        BulkWriter( PlayCountsDatabase& db, Mode mode );
+        ~BulkWriter();
+
+        /** @returns false if a batch failed to execute */
+        bool add( const Track& track );
+        bool flush();
+
+        int count() const { return m_count; }
+
+    private:
+        Q_DISABLE_COPY( BulkWriter )
+
+        Mode const m_mode;
+        QSqlQuery* m_query;
+
+        QVariantList m_ids;
+        QVariantList m_playCounts;
+        int m_count;
+    };
+
+    /** INSERT OR IGNOREs every track from the source, null ones are skipped.
+      * @returns the number of tracks read */
+    int insert( TrackSource& source );
+
+    /** Sets journal_mode=WAL and synchronous=NORMAL for writing a whole
+      * library, or puts back the defaults that the iTunes plugin expects.
+      * Can't be called inside a transaction. */
+    void setBulkMode( bool bulk );
 
     QString path() const { return m_path; }
 
@@ -92,6 +147,12 @@ protected:
 protected:
     QSqlDatabase m_db;
     QSqlQuery* m_query;
+    QSqlQuery* m_insertQuery;
+    QSqlQuery* m_updateQuery;
+
+    /** the snapshot, persistent ids are kept as 64 bit keys in m_merge,
+      * anything else, eg. manual iPod uids, in m_snapshot */
+    unicorn::PlayCountsMerge m_merge;
     QHash<QString,int> m_snapshot;
 
 private:
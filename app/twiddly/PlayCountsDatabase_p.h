@@ -0,0 +1,70 @@
+/*
+   Copyright 2005-2009 Last.fm Ltd. 
+      - Primarily authored by Max Howell, Jono Cole, Erik Jaelevik, 
+        Christian Muehlhaeuser
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PLAY_COUNTS_DATABASE_P_H
+#define PLAY_COUNTS_DATABASE_P_H
+
+/** shared by the PlayCountsDatabase implementations, not to be included
+  * anywhere else */
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+
+#define TABLE_NAME_OLD "itunes_db"
+#define TABLE_NAME "playcounts"
+#define SCHEMA "persistent_id   VARCHAR( 32 ) PRIMARY KEY," \
+               "play_count      INTEGER"
+#define INDEX "persistent_id"
+
+
+/** @author Max Howell <max@last.fm>
+  * @brief automatically log sql errors */
+namespace QtOverrides
+{
+    class SqlQuery : public ::QSqlQuery
+    {
+        // this is called arse because both check and verify wouldn't compile!
+        bool arse( bool success )
+        {
+            if (!success)
+                qWarning() << lastError().text() << "in query:\n" << lastQuery();
+            return success;
+        }
+        
+    public:
+        SqlQuery( QSqlDatabase db ) : QSqlQuery( db )
+        {}
+                
+        bool exec()
+        {
+            return arse( QSqlQuery::exec() );
+        }
+        
+        bool exec( const QString& sql )
+        {
+            return arse( QSqlQuery::exec( sql ) );
+        }
+    };
+}
+
+#define QSqlQuery QtOverrides::SqlQuery
+
+#endif
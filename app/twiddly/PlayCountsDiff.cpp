@@ -0,0 +1,159 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PlayCountsDiff.h"
+#include "IPodScrobble.h"
+#include <QDebug>
+
+
+static inline PlayCountsDatabase::Track
+dbTrack( const TrackSource::Track& track )
+{
+    return PlayCountsDatabase::Track( track.uniqueId(), track.playCount() );
+}
+
+
+PlayCountsDiff::PlayCountsDiff( PlayCountsDatabase& db )
+              : m_db( db ),
+                m_nullTrackCount( 0 ),
+                m_deferredTrackCount( 0 )
+{}
+
+
+void
+PlayCountsDiff::diff( TrackSource& source )
+{
+    while ( source.hasTracks() )
+    {
+        TrackSource::Track track = source.nextTrack();
+
+        if ( track.isNull() )
+        {
+            // Don't log every one as this could be a library full of iTunes
+            // Match tracks, just count how many failed and say at the end
+            ++m_nullTrackCount;
+            continue;
+        }
+
+        // We don't know about this track yet, this means either:-
+        //   1. The track was added to iTunes since the last sync. thus it is
+        //      impossible for it to have been played on the iPod
+        //   2. On Windows, the path of the track changed since the last sync.
+        //      Since we don't have persistent IDs on Windows we have no way of
+        //      matching up this track up with its previous incarnation. Thus
+        //      we don't scrobble it as we have no idea if it was played or not
+        //      chances are, it wasn't
+        PlayCountsDatabase::Track const known = m_db[track.uniqueId()];
+
+        if ( known.isNull() )
+        {
+            m_tracksToInsert << dbTrack( track );
+            continue;
+        }
+
+        const int diff = track.playCount() - known.playCount();
+
+        if ( diff > 0 )
+            m_tracksToScrobble << track;
+
+        // a worthwhile optimisation since update() is really slow
+        // NOTE negative diffs *are* possible
+        if ( diff < 0 )
+            m_tracksToUpdate << dbTrack( track );
+    }
+
+    qDebug() << "There were " << m_nullTrackCount << " null tracks";
+}
+
+
+QList<lastfm::Track>
+PlayCountsDiff::commit( const QDateTime& now )
+{
+    QList<lastfm::Track> scrobbles;
+    m_deferredTrackCount = 0;
+
+    if ( m_tracksToUpdate.count() + m_tracksToInsert.count() + m_tracksToScrobble.count() == 0 )
+        return scrobbles;
+
+    // We've got some updates and inserts to do so lock the database and do them
+    m_db.beginTransaction();
+
+    // Because we take a snapshot of our playcounts db there is a possible race condition.
+    // fetch the latest playcounts now that we've locked the database
+    QStringList uids;
+    foreach ( const TrackSource::Track& track, m_tracksToScrobble )
+        uids << track.uniqueId();
+
+    QHash<QString, int> const playCounts = m_db.playCounts( uids );
+
+    PlayCountsDatabase::BulkWriter updater( m_db, PlayCountsDatabase::BulkWriter::Update );
+    PlayCountsDatabase::BulkWriter inserter( m_db, PlayCountsDatabase::BulkWriter::Insert );
+
+    foreach ( const TrackSource::Track& track, m_tracksToScrobble )
+    {
+        lastfm::Track const t = track.lastfmTrack();
+
+        if ( t.isNull() )
+        {
+            // We get here if the source fails to populate the Track for
+            // whatever reason. Therefore we don't let the local db update.
+            // That way we maintain the diff and we should be picking up on
+            // it next time twiddly runs.
+            qWarning() << "Couldn't get Track for" << track.uniqueId();
+            ++m_deferredTrackCount;
+            continue;
+        }
+
+        if ( t.timestamp().secsTo( now ) <= 30 )
+        {
+            // we only scrobble tracks with a timestamp older than 30 seconds
+            // to give the iTunes plugin time so update the playcount db
+            // after a track change - bit of a hack, but it stops spurious iPod scrobbles
+            qDebug() << "Timestamp less than 30 seconds. Don't scrobble yet.";
+            ++m_deferredTrackCount;
+            continue;
+        }
+
+        const int diff = track.playCount() - playCounts.value( track.uniqueId() );
+
+        // update the playcount db to the current playcount for this track
+        // this means that we won't try to scrobble the track again
+        updater.add( dbTrack( track ) );
+
+        IPodScrobble scrobble( t );
+        scrobble.setPlayCount( diff );
+        scrobble.setUniqueId( track.uniqueId() );
+        scrobbles << scrobble;
+        qDebug() << diff << "scrobbles found for" << t;
+    }
+
+    // this should just be tracks with negative playcount diffs
+    foreach ( const PlayCountsDatabase::Track& track, m_tracksToUpdate )
+        updater.add( track );
+
+    // insert all the new tracks we've found
+    foreach ( const PlayCountsDatabase::Track& track, m_tracksToInsert )
+        inserter.add( track );
+
+    updater.flush();
+    inserter.flush();
+
+    m_db.endTransaction();
+
+    return scrobbles;
+}
@@ -0,0 +1,75 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PLAY_COUNTS_DIFF_H
+#define PLAY_COUNTS_DIFF_H
+
+#include "PlayCountsDatabase.h"
+#include "TrackSource.h"
+#include <QDateTime>
+#include <QList>
+
+
+/** iPod plays are determined by comparing the play counts in a TrackSource
+  * with the ones in our PlayCountsDatabase after the iPod was synced with it.
+  *
+  * diff() reads the source and sorts its tracks into ones to scrobble, ones
+  * we don't know yet and ones whose count went down. commit() then writes
+  * the changes in one transaction and returns the scrobbles.
+  *
+  * Only the changed tracks are kept, and only the ones to scrobble keep
+  * their source's data. A source that gives its tracks in persistent id
+  * order, like the Mac iTunes library, is merge-joined against the
+  * snapshot. Any other source, like the Linux itdb list or the Windows
+  * iTunes library, costs a search of O(log n) per track.
+  */
+class PlayCountsDiff
+{
+public:
+    PlayCountsDiff( PlayCountsDatabase& db );
+
+    void diff( TrackSource& source );
+
+    /** Tracks last played less than 30 seconds before now, and ones the
+      * source couldn't make a Track for, are left for the next run. See
+      * deferredTrackCount().
+      *
+      * @returns IPodScrobbles with their play count and unique id set */
+    QList<lastfm::Track> commit( const QDateTime& now = QDateTime::currentDateTime() );
+
+    QList<TrackSource::Track> tracksToScrobble() const { return m_tracksToScrobble; }
+    QList<PlayCountsDatabase::Track> tracksToInsert() const { return m_tracksToInsert; }
+    QList<PlayCountsDatabase::Track> tracksToUpdate() const { return m_tracksToUpdate; }
+
+    int nullTrackCount() const { return m_nullTrackCount; }
+
+    /** how many tracks the last commit() left for the next run */
+    int deferredTrackCount() const { return m_deferredTrackCount; }
+
+private:
+    PlayCountsDatabase& m_db;
+
+    QList<TrackSource::Track> m_tracksToScrobble;
+    QList<PlayCountsDatabase::Track> m_tracksToInsert;
+    QList<PlayCountsDatabase::Track> m_tracksToUpdate;
+
+    int m_nullTrackCount;
+    int m_deferredTrackCount;
+};
+
+#endif
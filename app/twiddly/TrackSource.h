@@ -0,0 +1,86 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRACK_SOURCE_H
+#define TRACK_SOURCE_H
+
+#include <lastfm/Track.h>
+#include <QExplicitlySharedDataPointer>
+#include <QSharedData>
+#include <QString>
+
+
+/** A library of tracks and their play counts that twiddly diffs against its
+  * PlayCountsDatabase, eg. the iTunes Library or a dump of one.
+  *
+  * Tracks are read one at a time. Reading the rest of a track's metadata can
+  * be expensive, so it is only done for tracks that are going to be
+  * scrobbled, see Track::lastfmTrack().
+  */
+class TrackSource
+{
+public:
+    /** Implemented by each source to keep whatever it needs to fetch the
+      * track's metadata later */
+    struct TrackData : public QSharedData
+    {
+        TrackData( const QString& uid, int c ) : uniqueId( uid ), playCount( c )
+        {}
+
+        virtual ~TrackData()
+        {}
+
+        /** @returns a null track if the metadata can't be read */
+        virtual lastfm::Track lastfmTrack() const = 0;
+
+        QString uniqueId;
+        int playCount;
+    };
+
+    class Track
+    {
+    public:
+        Track()
+        {}
+
+        Track( TrackData* data ) : d( data )
+        {}
+
+        bool isNull() const { return !d || d->uniqueId.isEmpty(); }
+        QString uniqueId() const { Q_ASSERT( d ); return d->uniqueId; }
+        int playCount() const { Q_ASSERT( d ); return d->playCount; }
+
+        lastfm::Track lastfmTrack() const { Q_ASSERT( d ); return d->lastfmTrack(); }
+
+    private:
+        QExplicitlySharedDataPointer<TrackData> d;
+    };
+
+    virtual ~TrackSource()
+    {}
+
+    /** @returns -1 if the source doesn't know until it has been read */
+    virtual int trackCount() const = 0;
+    virtual bool hasTracks() const = 0;
+
+    /** @returns a null track if this one couldn't be read, carry on with the
+      * next one */
+    virtual Track nextTrack() = 0;
+};
+
+#endif
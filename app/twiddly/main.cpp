@@ -134,6 +134,7 @@ main( int argc, char** argv )
 
             qDebug() << "Twiddling device: " << ipod->serial;
             ipod->twiddle();
+            qDebug() << "Library diffs run:" << ipod->diffsRun() << "skipped:" << ipod->diffsSkipped();
 
             //------------------------------------------------------------------
             IPodType previousType = ipod->settings().type();
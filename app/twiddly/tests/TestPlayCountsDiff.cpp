@@ -0,0 +1,599 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryFile>
+#include "lib/unicorn/PlayCountsMerge.h"
+#include "FileTrackSource.h"
+#include "IPodScrobble.h"
+#include "LibraryFingerprint.h"
+#include "PlayCountsDatabase.h"
+#include "PlayCountsDiff.h"
+
+
+class TestDatabase : public PlayCountsDatabase
+{
+public:
+    TestDatabase( const QString& path ) : PlayCountsDatabase( path )
+    {}
+
+    QSqlDatabase db() const { return m_db; }
+};
+
+
+struct LibraryTrack
+{
+    QString id;
+    int playCount;
+    uint lastPlayed;
+    QString artist;
+    QString title;
+};
+
+
+/** what a library looks like after being dumped to CSV */
+static QList<LibraryTrack>
+syntheticLibrary( int count )
+{
+    QList<LibraryTrack> tracks;
+
+    for (int i = 0; i < count; ++i)
+    {
+        LibraryTrack t;
+        t.id = QString( "%1" ).arg( 0x3a5c00000000000LL + i * 17, 16, 16, QChar( '0' ) ).toUpper();
+        t.playCount = i % 23;
+        t.lastPlayed = 1300000000 + i * 60;
+        t.artist = QString( "Artist %1" ).arg( i / 100 );
+        t.title = QString( "Title %1, part %2" ).arg( i ).arg( i % 3 );
+        tracks << t;
+    }
+
+    return tracks;
+}
+
+
+class TestPlayCountsDiff : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryFile* m_dbFile;
+    QTemporaryFile* m_libraryFile;
+    TestDatabase* m_db;
+
+    void writeLibrary( const QList<LibraryTrack>& tracks );
+    void reopenDatabase();
+    QList<Track> twiddle( const QDateTime& now = QDateTime::currentDateTime() );
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testDecodePersistentId();
+    void testMergeFindsInAnyOrder();
+    void testMergeShuffledFindsAreLogarithmic();
+    void testFingerprint();
+
+    void testReadsQuotedFields();
+    void testColumnsInAnyOrder();
+    void testRequiresIdAndPlayCount();
+
+    void testFirstRunInserts();
+    void testScrobblesPlays();
+    void testRecentPlayWaits();
+    void testLowerPlayCountUpdates();
+    void testCountsNullTracks();
+    void testBulkWriter();
+    void testBulkInsertFromSource();
+
+    void benchmarkDiff_data();
+    void benchmarkDiff();
+
+    void benchmarkBootstrap();
+};
+
+
+void
+TestPlayCountsDiff::init()
+{
+    m_dbFile = new QTemporaryFile;
+    m_dbFile->open();
+
+    m_libraryFile = new QTemporaryFile;
+    m_libraryFile->open();
+
+    m_db = new TestDatabase( m_dbFile->fileName() );
+}
+
+
+void
+TestPlayCountsDiff::cleanup()
+{
+    delete m_db;
+    QSqlDatabase::removeDatabase( m_dbFile->fileName() );
+
+    delete m_libraryFile;
+    delete m_dbFile;
+}
+
+
+void
+TestPlayCountsDiff::writeLibrary( const QList<LibraryTrack>& tracks )
+{
+    QFile file( m_libraryFile->fileName() );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) );
+
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    stream << "persistent_id,play_count,last_played,artist,title\n";
+
+    foreach (const LibraryTrack& t, tracks)
+        stream << t.id << ','
+               << t.playCount << ','
+               << t.lastPlayed << ','
+               << FileTrackSource::escape( t.artist ) << ','
+               << FileTrackSource::escape( t.title ) << '\n';
+}
+
+
+/** the snapshot is taken when the database is opened, like each run of
+  * twiddly does */
+void
+TestPlayCountsDiff::reopenDatabase()
+{
+    delete m_db;
+    QSqlDatabase::removeDatabase( m_dbFile->fileName() );
+    m_db = new TestDatabase( m_dbFile->fileName() );
+}
+
+
+QList<Track>
+TestPlayCountsDiff::twiddle( const QDateTime& now )
+{
+    reopenDatabase();
+
+    FileTrackSource source( m_libraryFile->fileName() );
+    PlayCountsDiff diff( *m_db );
+    diff.diff( source );
+    return diff.commit( now );
+}
+
+
+void
+TestPlayCountsDiff::testDecodePersistentId()
+{
+    quint64 key;
+
+    QVERIFY( unicorn::PlayCountsMerge::decodePersistentId( "3A5C00000000F00D", &key ) );
+    QCOMPARE( key, Q_UINT64_C( 0x3A5C00000000F00D ) );
+
+    QVERIFY( unicorn::PlayCountsMerge::decodePersistentId( "ffffffffffffffff", &key ) );
+    QCOMPARE( key, Q_UINT64_C( 0xFFFFFFFFFFFFFFFF ) );
+
+    // manual iPod uids and anything else that isn't exactly 16 hex digits
+    QVERIFY( !unicorn::PlayCountsMerge::decodePersistentId( "F00D", &key ) );
+    QVERIFY( !unicorn::PlayCountsMerge::decodePersistentId( "0x5C00000000F00D", &key ) );
+    QVERIFY( !unicorn::PlayCountsMerge::decodePersistentId( "Artist\tTitle\tAl", &key ) );
+}
+
+
+void
+TestPlayCountsDiff::testMergeFindsInAnyOrder()
+{
+    unicorn::PlayCountsMerge merge;
+    merge.addPrevious( 30, 3 );
+    merge.addPrevious( 10, 1 );
+    merge.addPrevious( 20, 2 );
+
+    QCOMPARE( merge.find( 5 ), (const unicorn::PlayCountsMerge::PlayCount*)0 );
+    QCOMPARE( merge.find( 10 )->playCount, 1 );
+    QCOMPARE( merge.find( 15 ), (const unicorn::PlayCountsMerge::PlayCount*)0 );
+    QCOMPARE( merge.find( 20 )->playCount, 2 );
+    QCOMPARE( merge.find( 30 )->playCount, 3 );
+    QCOMPARE( merge.find( 40 ), (const unicorn::PlayCountsMerge::PlayCount*)0 );
+    QCOMPARE( merge.seeks(), 0 );
+
+    QCOMPARE( merge.find( 20 )->playCount, 2 );
+    QCOMPARE( merge.find( 10 )->playCount, 1 );
+    QCOMPARE( merge.seeks(), 2 );
+}
+
+
+void
+TestPlayCountsDiff::testMergeShuffledFindsAreLogarithmic()
+{
+    const int n = 100000;
+    const int log2n = 17;
+
+    unicorn::PlayCountsMerge merge;
+    QList<quint64> ids;
+
+    for (int i = 0; i < n; ++i)
+    {
+        merge.addPrevious( 10 * i, i );
+        ids << 10 * i;
+    }
+
+    // in order, that's the merge, a step or so each and no seeks
+    foreach (quint64 id, ids)
+        QVERIFY( merge.find( id ) );
+
+    QVERIFY( merge.probes() <= 3 * n );
+    QCOMPARE( merge.seeks(), 0 );
+
+    qsrand( 1 );
+    for (int i = ids.count() - 1; i > 0; --i)
+        ids.swap( i, qrand() % ( i + 1 ) );
+
+    // a walk from the last id would be around n / 3 probes a find
+    qint64 const before = merge.probes();
+
+    foreach (quint64 id, ids)
+    {
+        QVERIFY( merge.find( id ) );
+        QVERIFY( !merge.find( id + 1 ) );
+    }
+
+    QVERIFY( merge.probes() - before <= qint64( 2 * n ) * 3 * log2n );
+    QVERIFY( merge.seeks() > n * 9 / 10 );
+}
+
+
+void
+TestPlayCountsDiff::testFingerprint()
+{
+    QCOMPARE( LibraryFingerprint( "" ).isNull(), true );
+    QVERIFY( LibraryFingerprint() != LibraryFingerprint() );
+
+    // big enough that only some of it is sampled
+    QByteArray bytes( 1024 * 1024, 'x' );
+
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    file.write( bytes );
+    file.flush();
+
+    LibraryFingerprint const before( file.fileName() );
+    QVERIFY( !before.isNull() );
+    QVERIFY( before == LibraryFingerprint( file.fileName() ) );
+    QVERIFY( before == LibraryFingerprint::fromString( before.toString() ) );
+
+    // a change in the last block, which is always sampled, keeping the size
+    file.seek( bytes.size() - 1 );
+    file.write( "y" );
+    file.flush();
+    QVERIFY( before != LibraryFingerprint( file.fileName() ) );
+
+    file.write( "z" );
+    file.flush();
+    QVERIFY( before != LibraryFingerprint( file.fileName() ) );
+}
+
+
+void
+TestPlayCountsDiff::testReadsQuotedFields()
+{
+    QFile file( m_libraryFile->fileName() );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Text ) );
+    file.write( "persistent_id,play_count,artist,title\n"
+                "A1,3,\"Crosby, Stills & Nash\",\"Say \"\"Hi\"\"\"\n"
+                "A2,1,Low,\"two\nlines\"\n" );
+    file.close();
+
+    FileTrackSource source( file.fileName() );
+
+    TrackSource::Track t = source.nextTrack();
+    QCOMPARE( t.uniqueId(), QString( "A1" ) );
+    QCOMPARE( t.playCount(), 3 );
+    QCOMPARE( t.lastfmTrack().artist().name(), QString( "Crosby, Stills & Nash" ) );
+    QCOMPARE( t.lastfmTrack().title(), QString( "Say \"Hi\"" ) );
+
+    t = source.nextTrack();
+    QCOMPARE( t.uniqueId(), QString( "A2" ) );
+    QCOMPARE( t.lastfmTrack().title(), QString( "two\nlines" ) );
+
+    QVERIFY( !source.hasTracks() );
+}
+
+
+void
+TestPlayCountsDiff::testColumnsInAnyOrder()
+{
+    QFile file( m_libraryFile->fileName() );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Text ) );
+    file.write( "title,last_played,unknown,play_count,persistent_id\n"
+                "Song,2011-03-04 05:06:07,x,5,B7\n" );
+    file.close();
+
+    FileTrackSource source( file.fileName() );
+    TrackSource::Track t = source.nextTrack();
+
+    QCOMPARE( t.uniqueId(), QString( "B7" ) );
+    QCOMPARE( t.playCount(), 5 );
+    QCOMPARE( t.lastfmTrack().title(), QString( "Song" ) );
+    QCOMPARE( t.lastfmTrack().timestamp(), QDateTime( QDate( 2011, 3, 4 ), QTime( 5, 6, 7 ) ) );
+}
+
+
+void
+TestPlayCountsDiff::testRequiresIdAndPlayCount()
+{
+    QFile file( m_libraryFile->fileName() );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Text ) );
+    file.write( "persistent_id,title\nA1,Song\n" );
+    file.close();
+
+    bool threw = false;
+
+    try
+    {
+        FileTrackSource source( file.fileName() );
+    }
+    catch ( QString& )
+    {
+        threw = true;
+    }
+
+    QVERIFY( threw );
+}
+
+
+void
+TestPlayCountsDiff::testFirstRunInserts()
+{
+    QList<LibraryTrack> library = syntheticLibrary( 50 );
+    writeLibrary( library );
+
+    QVERIFY( twiddle().isEmpty() );
+
+    reopenDatabase();
+
+    foreach (const LibraryTrack& t, library)
+        QCOMPARE( (*m_db)[t.id].playCount(), t.playCount );
+}
+
+
+void
+TestPlayCountsDiff::testScrobblesPlays()
+{
+    QList<LibraryTrack> library = syntheticLibrary( 50 );
+    writeLibrary( library );
+    twiddle();
+
+    library[7].playCount += 2;
+    library[9].playCount += 1;
+    writeLibrary( library );
+
+    QList<Track> scrobbles = twiddle();
+    QCOMPARE( scrobbles.count(), 2 );
+
+    QCOMPARE( IPodScrobble( scrobbles[0] ).uniqueId(), library[7].id );
+    QCOMPARE( IPodScrobble( scrobbles[0] ).playCount(), 2 );
+    QCOMPARE( scrobbles[0].title(), library[7].title );
+    QCOMPARE( scrobbles[0].timestamp().toTime_t(), library[7].lastPlayed );
+    QCOMPARE( scrobbles[0].source(), Track::MediaDevice );
+
+    QCOMPARE( IPodScrobble( scrobbles[1] ).uniqueId(), library[9].id );
+    QCOMPARE( IPodScrobble( scrobbles[1] ).playCount(), 1 );
+
+    // and they are only scrobbled once
+    QVERIFY( twiddle().isEmpty() );
+}
+
+
+void
+TestPlayCountsDiff::testRecentPlayWaits()
+{
+    QList<LibraryTrack> library = syntheticLibrary( 1 );
+    writeLibrary( library );
+    twiddle();
+
+    QDateTime const now = QDateTime::fromTime_t( library[0].lastPlayed + 3600 );
+
+    library[0].playCount += 1;
+    library[0].lastPlayed = now.toTime_t() - 10;
+    writeLibrary( library );
+
+    reopenDatabase();
+
+    // left for the next run, which mustn't skip the unchanged library
+    FileTrackSource source( m_libraryFile->fileName() );
+    PlayCountsDiff diff( *m_db );
+    diff.diff( source );
+    QVERIFY( diff.commit( now ).isEmpty() );
+    QCOMPARE( diff.deferredTrackCount(), 1 );
+
+    QCOMPARE( twiddle( now.addSecs( 60 ) ).count(), 1 );
+}
+
+
+void
+TestPlayCountsDiff::testLowerPlayCountUpdates()
+{
+    QList<LibraryTrack> library = syntheticLibrary( 1 );
+    library[0].playCount = 10;
+    writeLibrary( library );
+    twiddle();
+
+    // eg. the library was restored from a backup
+    library[0].playCount = 4;
+    writeLibrary( library );
+    QVERIFY( twiddle().isEmpty() );
+
+    library[0].playCount = 5;
+    writeLibrary( library );
+    QCOMPARE( twiddle().count(), 1 );
+}
+
+
+void
+TestPlayCountsDiff::testCountsNullTracks()
+{
+    QFile file( m_libraryFile->fileName() );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Text ) );
+    file.write( "persistent_id,play_count\nA1,3\n\n,4\nA2,1\n" );
+    file.close();
+
+    FileTrackSource source( file.fileName() );
+    PlayCountsDiff diff( *m_db );
+    diff.diff( source );
+
+    QCOMPARE( diff.nullTrackCount(), 2 );
+    QCOMPARE( diff.tracksToInsert().count(), 2 );
+}
+
+
+void
+TestPlayCountsDiff::testBulkWriter()
+{
+    m_db->beginTransaction();
+
+    PlayCountsDatabase::BulkWriter inserter( *m_db, PlayCountsDatabase::BulkWriter::Insert );
+    for (int i = 0; i < 2500; ++i)
+        QVERIFY( inserter.add( PlayCountsDatabase::Track( QString::number( i ), i ) ) );
+    QVERIFY( inserter.flush() );
+    QCOMPARE( inserter.count(), 2500 );
+
+    PlayCountsDatabase::BulkWriter ignorer( *m_db, PlayCountsDatabase::BulkWriter::InsertOrIgnore );
+    ignorer.add( PlayCountsDatabase::Track( "7", 700 ) );
+    ignorer.add( PlayCountsDatabase::Track( "it's new", 1 ) );
+    QVERIFY( ignorer.flush() );
+
+    PlayCountsDatabase::BulkWriter updater( *m_db, PlayCountsDatabase::BulkWriter::Update );
+    updater.add( PlayCountsDatabase::Track( "8", 800 ) );
+    QVERIFY( updater.flush() );
+
+    m_db->endTransaction();
+
+    QCOMPARE( m_db->track( "0" ).playCount(), 0 );
+    QCOMPARE( m_db->track( "2499" ).playCount(), 2499 );
+    QCOMPARE( m_db->track( "7" ).playCount(), 7 );
+    QCOMPARE( m_db->track( "it's new" ).playCount(), 1 );
+    QCOMPARE( m_db->track( "8" ).playCount(), 800 );
+}
+
+
+void
+TestPlayCountsDiff::testBulkInsertFromSource()
+{
+    QList<LibraryTrack> library = syntheticLibrary( 100 );
+    writeLibrary( library );
+
+    m_db->setBulkMode( true );
+    m_db->beginTransaction();
+
+    FileTrackSource source( m_libraryFile->fileName() );
+    QCOMPARE( m_db->insert( source ), 100 );
+
+    m_db->endTransaction();
+    m_db->setBulkMode( false );
+
+    {
+        QSqlQuery query( m_db->db() );
+        query.exec( "PRAGMA journal_mode" );
+        QVERIFY( query.next() );
+        QCOMPARE( query.value( 0 ).toString().toLower(), QString( "delete" ) );
+    }
+
+    reopenDatabase();
+
+    foreach (const LibraryTrack& t, library)
+        QCOMPARE( (*m_db)[t.id].playCount(), t.playCount );
+}
+
+
+void
+TestPlayCountsDiff::benchmarkDiff_data()
+{
+    QTest::addColumn<int>( "count" );
+    QTest::addColumn<bool>( "sorted" );
+
+    QTest::newRow( "10000 tracks" ) << 10000 << true;
+    QTest::newRow( "100000 tracks" ) << 100000 << true;
+    QTest::newRow( "100000 tracks, not in id order" ) << 100000 << false;
+}
+
+
+/** A sync where one track in a hundred was played on the iPod. Only the diff
+  * is measured, it doesn't touch the database. A library in persistent id
+  * order is merged against the snapshot, one in any other order is searched. */
+void
+TestPlayCountsDiff::benchmarkDiff()
+{
+    QFETCH( int, count );
+    QFETCH( bool, sorted );
+
+    QList<LibraryTrack> library = syntheticLibrary( count );
+    writeLibrary( library );
+    twiddle();
+
+    for (int i = 0; i < library.count(); i += 100)
+        library[i].playCount += 1;
+
+    if (!sorted)
+    {
+        qsrand( 1 );
+        for (int i = library.count() - 1; i > 0; --i)
+            library.swap( i, qrand() % ( i + 1 ) );
+    }
+
+    writeLibrary( library );
+
+    reopenDatabase();
+
+    int scrobbles = 0;
+
+    QBENCHMARK
+    {
+        FileTrackSource source( m_libraryFile->fileName() );
+        PlayCountsDiff diff( *m_db );
+        diff.diff( source );
+        scrobbles = diff.tracksToScrobble().count();
+    }
+
+    QCOMPARE( scrobbles, ( count + 99 ) / 100 );
+}
+
+
+/** Writing a 100000 track library into an empty database, the way bootstrap()
+  * does, including the commit */
+void
+TestPlayCountsDiff::benchmarkBootstrap()
+{
+    writeLibrary( syntheticLibrary( 100000 ) );
+
+    int count = 0;
+
+    QBENCHMARK_ONCE
+    {
+        FileTrackSource source( m_libraryFile->fileName() );
+
+        m_db->setBulkMode( true );
+        m_db->beginTransaction();
+        count = m_db->insert( source );
+        m_db->endTransaction();
+        m_db->setBulkMode( false );
+    }
+
+    QCOMPARE( count, 100000 );
+}
+
+
+QTEST_MAIN(TestPlayCountsDiff)
+#include "TestPlayCountsDiff.moc"
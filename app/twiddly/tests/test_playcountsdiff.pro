@@ -0,0 +1,20 @@
+TEMPLATE = app
+TARGET = test_playcountsdiff
+QT = core sql testlib
+CONFIG += lastfm logger
+CONFIG -= app_bundle
+INCLUDEPATH += ..
+include( ../../../admin/include.qmake )
+
+DEFINES += LASTFM_COLLAPSE_NAMESPACE _UNICORN_DLLEXPORT
+SOURCES = TestPlayCountsDiff.cpp \
+          ../PlayCountsDatabase.cpp \
+          ../PlayCountsDiff.cpp \
+          ../FileTrackSource.cpp \
+          ../LibraryFingerprint.cpp \
+          $$ROOT_DIR/lib/unicorn/PlayCountsMerge.cpp
+HEADERS = ../PlayCountsDatabase.h \
+          ../PlayCountsDiff.h \
+          ../TrackSource.h \
+          ../FileTrackSource.h \
+          ../LibraryFingerprint.h
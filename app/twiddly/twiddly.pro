@@ -17,11 +17,22 @@ DEFINES += LASTFM_COLLAPSE_NAMESPACE
 SOURCES = main.cpp \
           TwiddlyApplication.cpp \
           PlayCountsDatabase.cpp \
+          AutomaticIPodDatabase.cpp \
+          PlayCountsDiff.cpp \
+          FileTrackSource.cpp \
+          LibraryFingerprint.cpp \
+          ITunesLibrarySource.cpp \
           IPod.cpp \
           Utils.cpp
 
 HEADERS = TwiddlyApplication.h \
           PlayCountsDatabase.h \
+          PlayCountsDatabase_p.h \
+          PlayCountsDiff.h \
+          TrackSource.h \
+          FileTrackSource.h \
+          LibraryFingerprint.h \
+          ITunesLibrarySource.h \
           IPod.h \
           Utils.h
 
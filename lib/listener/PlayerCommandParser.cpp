@@ -19,7 +19,6 @@
 */
 
 #include <QDebug>
-#include <QStringList>
 #include <QUrl>
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -29,172 +28,243 @@
 
 #include "PlayerCommandParser.h"
 
-using std::invalid_argument;
 
-PlayerCommandParser::PlayerCommandParser( QString line ) throw( std::invalid_argument )
+static inline bool isSpace( char c )
 {
-    line = line.trimmed();
-    if (line.isEmpty()) throw invalid_argument( "Command string seems to be empty" );
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
 
-    qDebug() << line;
+static inline uint bit( char key )
+{
+    return 1u << (key - 'a');
+}
 
-    m_command = extractCommand( line ); //removes the command string from line
 
-    line = line.trimmed();
+PlayerCommandParser::PlayerCommandParser()
+    : m_present( 0 )
+    , m_error( EmptyLine )
+    , m_command( CommandInit )
+{
+}
 
-    QMap<QChar, QString> const args = extractArgs( line );
-    QString const required = requiredArgs( m_command );
 
-    for (int i = 0; i < required.length(); ++i)
-    {
-        QChar const c = required[i];
-        if (!args.contains( c ))
-            throw invalid_argument( "Mandatory argument unspecified: " + c.toAscii() );
-    }
+PlayerCommandParser::PlayerCommandParser( const QByteArray& line )
+    : m_present( 0 )
+    , m_error( EmptyLine )
+    , m_command( CommandInit )
+{
+    parse( line );
+}
 
-    m_playerId = args['c'];
-    
-    if (m_playerId.isEmpty())
-        throw invalid_argument( "Player ID cannot be zero length" );
 
-    switch (m_command)
+PlayerCommandParser::Error
+PlayerCommandParser::parse( const QByteArray& bytes )
+{
+    m_line = bytes;
+    m_present = 0;
+    m_playerId.clear();
+    m_track.clear();
+    m_username.clear();
+    m_applicationPath.clear();
+
+    const char* const line = m_line.constData();
+    int i = 0;
+    int end = m_line.size();
+    while (i < end && isSpace( line[i] )) ++i;
+    while (end > i && isSpace( line[end - 1] )) --end;
+    if (i == end) return fail( EmptyLine );
+
+    // the command
+    int const commandBegin = i;
+    while (i < end && line[i] != ' ') ++i;
+    if (i == end) return fail( UnableToParse );
+
+    const char* const command = line + commandBegin;
+    switch (i - commandBegin)
     {
-        case CommandStart:
-            m_track = extractTrack( args );
-            break;
-        case CommandBootstrap:
-            m_username = args['u'];
-            break;
-        case CommandInit:
-            m_applicationPath = args['f'];
+        #define MATCH( s, c ) if (qstrnicmp( command, s, sizeof( s ) - 1 ) == 0) { m_command = c; break; }
+        case 4:
+            MATCH( "STOP", CommandStop )
+            MATCH( "INIT", CommandInit )
+            MATCH( "TERM", CommandTerm )
+            return fail( InvalidCommand );
+        case 5:
+            MATCH( "START", CommandStart )
+            MATCH( "PAUSE", CommandPause )
+            return fail( InvalidCommand );
+        case 6:
+            MATCH( "RESUME", CommandResume )
+            return fail( InvalidCommand );
+        case 9:
+            MATCH( "BOOTSTRAP", CommandBootstrap )
+            return fail( InvalidCommand );
         default:
-            break;
+            return fail( InvalidCommand );
+        #undef MATCH
     }
-}
 
+    while (i < end && isSpace( line[i] )) ++i;
 
-PlayerCommand
-PlayerCommandParser::extractCommand( QString& line )
-{
-    int const n = line.indexOf( ' ' );
-    if (n == -1) throw invalid_argument( "Unable to parse" );
+    // the arguments, k=value pairs separated by single '&', '&&' is a literal '&'
+    while (i < end)
+    {
+        if (end - i < 2 || line[i + 1] != '=')
+            return fail( InvalidPair );
 
-    QString const command = line.left( n ).toUpper();
+        char const key = line[i];
+        i += 2;
 
-    // Trim off command from passed in string
-    line = line.mid( n + 1 );
+        Field f = { i, i, false };
+        while (i < end)
+        {
+            if (line[i] == '&')
+            {
+                if (i + 1 < end && line[i + 1] == '&')
+                {
+                    f.escaped = true;
+                    i += 2;
+                    continue;
+                }
+                break;
+            }
+            ++i;
+        }
+        f.end = i;
+        ++i; // skip the separator
 
-    if (command == "START") return CommandStart;
-    if (command == "STOP") return CommandStop;
-    if (command == "PAUSE") return CommandPause;
-    if (command == "RESUME") return CommandResume;
-    if (command == "BOOTSTRAP") return CommandBootstrap;
-    if (command == "INIT") return CommandInit;
-    if (command == "TERM") return CommandTerm;
+        // unknown keys are tolerated, just as they always were
+        if (key < 'a' || key > 'z')
+            continue;
 
-    throw invalid_argument( "Invalid command" );
-}
+        if (m_present & bit( key ))
+            return fail( DuplicatedField );
 
+        while (f.begin < f.end && isSpace( line[f.begin] )) ++f.begin;
+        while (f.end > f.begin && isSpace( line[f.end - 1] )) --f.end;
 
-namespace mxcl
-{
-    /** replaces '&&' and splits on remaining single '&' */
-    QStringList static inline split( QString line )
-    {
-        QStringList parts;
-        int start = 0, i = 0;
-        int end = 0;
-        while ((end = line.indexOf( '&', i )) != -1)
-        {
-            i = end + 1;
-            if (line[i] == '&') {
-                line.remove( end, 1 ); //convert && to &
-                continue;
-            }
-            parts += line.mid( start, end - start );
-            start = i;
-        }
-        return parts << line.mid( start );
+        m_fields[key - 'a'] = f;
+        m_present |= bit( key );
     }
-}
 
+    uint const required = requiredArgs( m_command );
+    if ((m_present & required) != required)
+        return fail( MissingArgument );
 
-struct Pair
-{
-    Pair( const QString& s )
+    m_playerId = field( 'c' );
+    if (m_playerId.isEmpty())
+        return fail( EmptyPlayerId );
+
+    switch (m_command)
     {
-        if (s[1] == '=')
-        {
-            key = s[0];
-            value = s.mid( 2 );
-        }
+        case CommandBootstrap:
+            m_username = field( 'u' );
+            break;
+        case CommandInit:
+            m_applicationPath = field( 'f' );
+        default:
+            break;
     }
-    
-    QChar key;
-    QString value;
-};
 
+    return m_error = NoError;
+}
 
-QMap<QChar, QString>
-PlayerCommandParser::extractArgs( const QString& line )
-{
-    QMap<QChar, QString> map;
 
-    // split by single & only, doubles are in fact &
-    foreach (Pair pair, mxcl::split( line ))
+const char*
+PlayerCommandParser::errorString( Error e )
+{
+    switch (e)
     {
-        if (pair.key == QChar()) 
-            throw invalid_argument( "Invalid pair: " + pair.key.toAscii() + '=' + std::string(pair.value.toUtf8().data()) );
-
-        if (map.contains( pair.key ))
-            throw invalid_argument( "Field identifier occurred twice in request: " + pair.key.toAscii() );
-
-        map[pair.key] = pair.value.trimmed();
+        case NoError: return "No error";
+        case EmptyLine: return "Command string seems to be empty";
+        case UnableToParse: return "Unable to parse";
+        case InvalidCommand: return "Invalid command";
+        case InvalidPair: return "Invalid pair";
+        case DuplicatedField: return "Field identifier occurred twice in request";
+        case MissingArgument: return "Mandatory argument unspecified";
+        case EmptyPlayerId: return "Player ID cannot be zero length";
     }
-
-    return map;
+    return "Unknown error";
 }
 
 
-QString
+uint
 PlayerCommandParser::requiredArgs( PlayerCommand c )
 {
     switch (c)
     {   
         case CommandStart: 
-            return "catblp";
+            return bit( 'c' ) | bit( 'a' ) | bit( 't' ) | bit( 'b' ) | bit( 'l' ) | bit( 'p' );
         case CommandBootstrap:
-            return "cu";
+            return bit( 'c' ) | bit( 'u' );
         case CommandInit:
-            return "cf";
+            return bit( 'c' ) | bit( 'f' );
         case CommandStop:
         case CommandPause:
         case CommandResume:
         case CommandTerm:
         default: // gcc 4.2 is stupid
-            return "c";
+            return bit( 'c' );
+    }
+}
+
+
+QByteArray
+PlayerCommandParser::rawField( char key ) const
+{
+    if (!(m_present & bit( key )))
+        return QByteArray();
+
+    Field const& f = m_fields[key - 'a'];
+    if (!f.escaped)
+        return QByteArray::fromRawData( m_line.constData() + f.begin, f.end - f.begin );
+
+    QByteArray value;
+    value.reserve( f.end - f.begin );
+    for (int i = f.begin; i < f.end; ++i)
+    {
+        value += m_line[i];
+        if (m_line[i] == '&') ++i; // collapse '&&' to '&'
     }
+    return value;
+}
+
+
+QString
+PlayerCommandParser::field( char key ) const
+{
+    QByteArray const value = rawField( key );
+    return QString::fromUtf8( value.constData(), value.size() );
+}
+
+
+Track
+PlayerCommandParser::track() const
+{
+    if (!m_track && m_error == NoError && m_command == CommandStart)
+        m_track = QSharedPointer<Track>( new Track( extractTrack() ) );
+
+    return m_track ? *m_track : Track();
 }
 
 
 Track
-PlayerCommandParser::extractTrack( const QMap<QChar, QString>& args )
+PlayerCommandParser::extractTrack() const
 {
     lastfm::MutableTrack track;
-    track.setArtist( args['a'] );
-    track.setAlbumArtist( args['d'] );
-    track.setTitle( args['t'] );
-    track.setAlbum( args['b'] );
-    track.setMbid( Mbid( args['m'] ) );
-    track.setDuration( args['l'].toInt() );
-    track.setUrl( QUrl::fromLocalFile( QUrl::fromPercentEncoding( args['p'].toUtf8() ) ) );
+    track.setArtist( field( 'a' ) );
+    track.setAlbumArtist( field( 'd' ) );
+    track.setTitle( field( 't' ) );
+    track.setAlbum( field( 'b' ) );
+    track.setMbid( Mbid( field( 'm' ) ) );
+    track.setDuration( rawField( 'l' ).toInt() );
+    track.setUrl( QUrl::fromLocalFile( QUrl::fromPercentEncoding( rawField( 'p' ) ) ) );
     track.setSource( Track::Player );
-    track.setExtra( "playerId", args['c'] );
+    track.setExtra( "playerId", m_playerId );
     track.setExtra( "playerName", playerName() );
 
 #ifdef Q_OS_WIN
 
-    if ( args['c'] == "itw" )
+    if ( m_playerId == "itw" )
     {
         ITunesComWrapper* com = new ITunesComWrapper;
         ITunesTrack comTrack = com->currentTrack();
@@ -23,30 +23,59 @@
 #include "common/HideStupidWarnings.h"
 #include "PlayerCommand.h"
 #include <lastfm/Track.h>
-#include <stdexcept>
-
-// ignore the warning about the exception specification
-#ifdef Q_OS_WIN
-#pragma warning( disable : 4290 )
-#endif
+#include <QByteArray>
+#include <QSharedPointer>
 
+/** Parses a single line of the scrobsub protocol, eg.
+  *
+  *     START c=foo&a=Artist&t=Title&b=Album&l=180&p=/path/to/file.mp3
+  *
+  * The line is scanned once, straight from the UTF-8 bytes we read off the
+  * socket. Field values are recorded as offsets into that buffer and only
+  * the ones the command actually needs are decoded. Errors are reported via
+  * parse()'s return value, nothing is thrown.
+  *
+  * The Track for a START is only built when you ask for it with track(), do
+  * that on the thread the track will be used on, lastfm::Track has a QObject
+  * inside it. */
 class PlayerCommandParser
 {
 public:
-    PlayerCommandParser( QString line ) throw( std::invalid_argument );
+    enum Error
+    {
+        NoError,
+        EmptyLine,
+        UnableToParse,
+        InvalidCommand,
+        InvalidPair,
+        DuplicatedField,
+        MissingArgument,
+        EmptyPlayerId
+    };
+
+    PlayerCommandParser();
+    /** convenience, calls parse() for you, check error() afterwards */
+    explicit PlayerCommandParser( const QByteArray& line );
+
+    /** the parser can be reused for as many lines as you like */
+    Error parse( const QByteArray& line );
+
+    Error error() const { return m_error; }
+    bool isValid() const { return m_error == NoError; }
+    static const char* errorString( Error );
 
     PlayerCommand command() const { return m_command; }
     QString playerId() const { return m_playerId; }
-    Track track() const { return m_track; }
+    Track track() const;
     QString username() const { return m_username; }
 	/** we use this to get a pretty name for the player, and its icon 
 	  * Use the full path for the .exe file on Windows and Linux, and the bundle
 	  * directory on Mac OS X */
     QString applicationPath() const { return m_applicationPath; }
 
-    QString playerName()
+    QString playerName() const
     {
-        QString& id = m_playerId;
+        const QString& id = m_playerId;
         
         if (id == "osx") return "iTunes";
         if (id == "itw") return "iTunes";
@@ -59,14 +88,31 @@ public:
     }    
     
 private:
-    PlayerCommand extractCommand( QString& line );
-    QMap<QChar, QString> extractArgs( const QString& line );
-    QString requiredArgs( PlayerCommand );
-    Track extractTrack( const QMap<QChar, QString>& args );
+    /** a value in the line we are parsing, [begin, end) are byte offsets */
+    struct Field
+    {
+        int begin;
+        int end;
+        bool escaped; // contains '&&' which means a literal '&'
+    };
+
+    enum { FieldCount = 26 }; // one slot per key, 'a' to 'z'
+
+    static uint requiredArgs( PlayerCommand );
+
+    Error fail( Error e ) { m_error = e; return e; }
+    QByteArray rawField( char key ) const;
+    QString field( char key ) const;
+    Track extractTrack() const;
+
+    QByteArray m_line; // a shallow copy of what we parsed
+    Field m_fields[FieldCount];
+    uint m_present; // bit n set means we have field 'a' + n
 
+    Error m_error;
     PlayerCommand m_command;
     QString m_playerId;
-    Track m_track;
+    mutable QSharedPointer<Track> m_track; // null until track() builds it
     QString m_username;
     QString m_applicationPath;
 };
@@ -0,0 +1,191 @@
+/*
+   Copyright 2005-2009 Last.fm Ltd. 
+      - Primarily authored by Max Howell, Jono Cole and Doug Mansell
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PlayerCommandProcessor.h"
+#include "PlayerConnection.h"
+#include <QIODevice>
+#include <QHash>
+
+
+PlayerCommandProcessor::PlayerCommandProcessor( QObject* parent )
+    : QObject( parent )
+{
+}
+
+
+QByteArray
+PlayerCommandProcessor::process( QIODevice* device )
+{
+    // take every complete line that has arrived, players skipping tracks
+    // quickly send lots of commands in one go
+    QList<QByteArray> lines;
+    while (device->canReadLine())
+        lines += device->readLine();
+
+    return lines.count() ? process( lines ) : QByteArray();
+}
+
+
+QByteArray
+PlayerCommandProcessor::process( const QList<QByteArray>& lines )
+{
+    QList<PlayerEvent> events;
+    QByteArray const responses = parse( m_parser, lines, events );
+    dispatch( events );
+    return responses;
+}
+
+
+/** the net effect of the commands a player sent in one read */
+struct PendingCommands
+{
+    PendingCommands() : start( false ), tail( CommandInit ), hasTail( false ) {}
+
+    QString id;
+    QString name;
+    bool start; // a START survived, line is the one to start
+    QByteArray line;
+    PlayerCommand tail; // the PAUSE, RESUME or STOP that came after it
+    bool hasTail;
+
+    void flush( QList<PlayerEvent>& events )
+    {
+        if (start)
+            events += PlayerEvent( id, name, CommandStart, line );
+        if (hasTail)
+            events += PlayerEvent( id, name, tail );
+
+        start = hasTail = false;
+        line.clear();
+    }
+};
+
+
+QByteArray
+PlayerCommandProcessor::parse( PlayerCommandParser& parser, const QList<QByteArray>& lines, QList<PlayerEvent>& events )
+{
+    QByteArray responses;
+    QList<PendingCommands> pending;
+    QHash<QString, int> index;
+
+    foreach (QByteArray const& line, lines)
+    {
+        if (parser.parse( line ) != PlayerCommandParser::NoError)
+        {
+            const char* error = PlayerCommandParser::errorString( parser.error() );
+            qWarning() << line << error;
+            responses += "ERROR: ";
+            responses += error;
+            responses += '\n';
+            continue;
+        }
+
+        responses += "OK\n";
+
+        QString const id = parser.playerId();
+        if (!index.contains( id ))
+        {
+            index[id] = pending.count();
+            pending += PendingCommands();
+            pending.last().id = id;
+            pending.last().name = parser.playerName();
+        }
+        PendingCommands& p = pending[index[id]];
+
+        switch (parser.command())
+        {
+            case CommandStart:
+                // anything sent before a START is obsolete
+                p.start = true;
+                p.line = line;
+                p.hasTail = false;
+                break;
+
+            case CommandPause:
+            case CommandResume:
+                // a STOP stands until a START replaces it
+                if (p.hasTail && p.tail == CommandStop)
+                    break;
+
+                // only the last of these matters, the connection
+                // ignores a pause when paused and a resume when playing
+                p.tail = parser.command();
+                p.hasTail = true;
+                break;
+
+            case CommandStop:
+                p.start = false;
+                p.line.clear();
+                p.tail = CommandStop;
+                p.hasTail = true;
+                break;
+
+            default:
+                // INIT, TERM and BOOTSTRAP can't be collapsed, so apply
+                // whatever is pending for this player first
+                p.flush( events );
+                events += PlayerEvent( id, p.name, parser.command() );
+                break;
+        }
+    }
+
+    for (int i = 0; i < pending.count(); ++i)
+        pending[i].flush( events );
+
+    return responses;
+}
+
+
+void
+PlayerCommandProcessor::dispatch( const QList<PlayerEvent>& events )
+{
+    foreach (PlayerEvent const& e, events)
+    {
+        PlayerConnection* connection = 0;
+
+        if (!m_connections.contains( e.id ))
+        {
+            connection = m_connections[e.id] = new PlayerConnection( e.id, e.name );
+            emit newConnection( connection );
+        }
+        else
+            connection = m_connections[e.id];
+
+        switch (e.command)
+        {
+            case CommandBootstrap:
+                emit bootstrapCompleted( e.id );
+                break;
+
+            case CommandTerm:
+                delete connection;
+                m_connections.remove( e.id );
+                break;
+
+            case CommandStart:
+                if (m_parser.parse( e.line ) == PlayerCommandParser::NoError)
+                    connection->handleCommand( e.command, m_parser.track() );
+                break;
+
+            default:
+                connection->handleCommand( e.command );
+                break;
+        }
+    }
+}
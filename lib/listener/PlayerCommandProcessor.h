@@ -0,0 +1,93 @@
+/*
+   Copyright 2005-2009 Last.fm Ltd. 
+      - Primarily authored by Max Howell, Jono Cole and Doug Mansell
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PLAYER_COMMAND_PROCESSOR_H
+#define PLAYER_COMMAND_PROCESSOR_H
+
+#include <QObject>
+#include <QMap>
+#include <QMetaType>
+
+#include "common/HideStupidWarnings.h"
+#include "PlayerCommandParser.h"
+#include "lib/DllExportMacro.h"
+
+class QIODevice;
+class PlayerConnection;
+
+
+/** what is left of a player's commands once they have been parsed and
+  * collapsed, small enough to post between threads */
+struct PlayerEvent
+{
+    PlayerEvent() : command( CommandInit ) {}
+    PlayerEvent( const QString& id, const QString& name, PlayerCommand command, const QByteArray& line = QByteArray() )
+        : id( id ), name( name ), command( command ), line( line )
+    {}
+
+    QString id;
+    QString name;
+    PlayerCommand command;
+    /** the START line, the Track is built from it by dispatch() so that
+      * it belongs to the main thread */
+    QByteArray line;
+};
+
+Q_DECLARE_METATYPE( QList<PlayerEvent> )
+
+
+/** The transport independent part of the player listeners. Feed it the lines
+  * a plugin sent, it keeps the PlayerConnections up to date and gives you
+  * back the responses to send */
+class LISTENER_DLLEXPORT PlayerCommandProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlayerCommandProcessor( QObject* parent = 0 );
+
+    /** reads every complete line available from the device and processes
+      * them as one batch, incomplete lines are left for next time
+      * @returns the responses, write them back in one go */
+    QByteArray process( QIODevice* );
+
+    /** parses and applies all the lines we read in one go, commands made
+      * obsolete by later ones from the same player are dropped
+      * @returns the responses for every line, in order */
+    QByteArray process( const QList<QByteArray>& lines );
+
+    /** the first half of process(), it doesn't touch any PlayerConnections
+      * so you can call it from an I/O thread, with a parser of its own, and
+      * post the events to dispatch() on the main thread */
+    static QByteArray parse( PlayerCommandParser&, const QList<QByteArray>& lines, QList<PlayerEvent>& events );
+
+public slots:
+    /** the second half of process(), applies the events to the connections */
+    void dispatch( const QList<PlayerEvent>& events );
+
+signals:
+    void newConnection( class PlayerConnection* );
+    void bootstrapCompleted( const QString& playerId );
+
+private:
+    QMap<QString, PlayerConnection*> m_connections;
+    PlayerCommandParser m_parser;
+};
+
+#endif
@@ -72,6 +72,13 @@ void PlayerConnection::forcePaused()
     emit paused();
 }
 
+void
+PlayerConnection::setNextTrack( const Track& t )
+{
+    m_nextTrack = t;
+    emit nextTrackChanged( t );
+}
+
 void
 PlayerConnection::handleCommand( PlayerCommand command, Track t )
 {
@@ -149,6 +156,7 @@ void
 PlayerConnection::onStopped()
 {
     m_track = Track();
+    m_nextTrack = Track();
 
     if (m_state == Stopped)
     {
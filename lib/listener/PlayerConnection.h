@@ -42,6 +42,7 @@ protected:
     
     State m_state;
     Track m_track;
+    Track m_nextTrack;
     
 public:    
     PlayerConnection( const QString& id, const QString& name, QObject* parent = 0 );
@@ -64,7 +65,12 @@ public:
     void setElapsed( uint i ) { m_elapsed = i; }
     uint elapsed() const { return m_elapsed; }
     
-    void clear() { m_state = Stopped; m_track = Track(); m_elapsed = 0; }
+    void clear() { m_state = Stopped; m_track = Track(); m_nextTrack = Track(); m_elapsed = 0; }
+
+    /** what the player says it will play after track(), null if it doesn't
+      * say. Only a hint, shuffle and the user can both change it. */
+    Track nextTrack() const { return m_nextTrack; }
+    void setNextTrack( const Track& );
     
     /** only pass the track for CommandStart */
     void handleCommand( PlayerCommand, Track = Track() );    
@@ -74,6 +80,7 @@ public:
     
 signals:
     void trackStarted( const lastfm::Track&, const lastfm::Track& );
+    void nextTrackChanged( const lastfm::Track& );
     void paused();
     void resumed();
     void stopped();
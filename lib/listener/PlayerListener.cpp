@@ -18,8 +18,7 @@
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "PlayerListener.h"
-#include "PlayerCommandParser.h"
-#include "PlayerConnection.h"
+#include "PlayerCommandProcessor.h"
 #include <QLocalSocket>
 #include <QDir>
 #include <QFile>
@@ -30,12 +29,19 @@
 #else
 #include <lastfm/misc.h>
 #endif
+#ifdef Q_OS_LINUX
+#include "linux/UnixSocketServer.h"
+#endif
 
 PlayerListener::PlayerListener( QObject* parent )
               : QLocalServer( parent )
 {
     connect( this, SIGNAL(newConnection()), SLOT(onNewConnection()) );
 
+    m_processor = new PlayerCommandProcessor( this );
+    connect( m_processor, SIGNAL(newConnection(PlayerConnection*)), SIGNAL(newConnection(PlayerConnection*)) );
+    connect( m_processor, SIGNAL(bootstrapCompleted(QString)), SIGNAL(bootstrapCompleted(QString)) );
+
     // Create a user-unique name to listen on.
     // User-unique so that different logged-on users 
     // can run their own scrobbler instances.
@@ -56,9 +62,19 @@ PlayerListener::PlayerListener( QObject* parent )
     if( QFile::exists( fullPath ))
         QFile::remove( fullPath );
 
+#ifdef Q_OS_LINUX
+    // serve the socket from an I/O thread so that plugins get their
+    // responses straight away even if the GUI thread is busy
+    qRegisterMetaType<QList<PlayerEvent> >( "QList<PlayerEvent>" );
+
+    UnixSocketServer* unixSocketServer = new UnixSocketServer( fullPath, this );
+    connect( unixSocketServer, SIGNAL(eventsReady(QList<PlayerEvent>)), m_processor, SLOT(dispatch(QList<PlayerEvent>)), Qt::QueuedConnection );
+    unixSocketServer->start();
+#else
     bool success = listen( fullPath );
     Q_ASSERT( success );
 #endif
+#endif
 }
 
 void
@@ -80,54 +96,13 @@ PlayerListener::onDataReady()
     QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
     if (!socket) return;
 
-    while (socket->canReadLine())
-    {
-        QString const line = QString::fromUtf8( socket->readLine() );
-        QString response = processLine( line );
-        socket->write( response.toUtf8() );
-    }
+    QByteArray const responses = m_processor->process( socket );
+    if (responses.size())
+        socket->write( responses );
 }
 
 QString
 PlayerListener::processLine( const QString& line )
 {
-    QString response = "OK\n";
-
-    try
-    {
-        PlayerCommandParser parser( line );
-        QString const id = parser.playerId();
-        PlayerConnection* connection = 0;
-
-        if (!m_connections.contains( id ))
-        {
-            connection = m_connections[id] = new PlayerConnection( parser.playerId(), parser.playerName() );
-            emit newConnection( connection );
-        }
-        else
-            connection = m_connections[id];
-
-        switch (parser.command())
-        {
-            case CommandBootstrap:
-                emit bootstrapCompleted( parser.playerId() );
-                break;
-
-            case CommandTerm:
-                delete connection;
-                m_connections.remove( parser.playerId() );
-                break;
-
-            default:
-                connection->handleCommand( parser.command(), parser.track() );
-                break;
-        }
-    }
-    catch (std::invalid_argument& e)
-    {
-        qWarning() << e.what();
-        response = "ERROR: " + QString::fromStdString(e.what()) + "\n";
-    }
-
-    return response;
+    return QString::fromUtf8( m_processor->process( QList<QByteArray>() << line.toUtf8() ) );
 }
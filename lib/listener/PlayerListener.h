@@ -21,12 +21,13 @@
 #define PLAYER_LISTENER_H
 
 #include <QLocalServer>
-#include <QMap>
 
 #include "common/HideStupidWarnings.h"
 #include "PlayerConnection.h"
 #include "lib/DllExportMacro.h"
 
+class PlayerCommandProcessor;
+
 /** listens to external clients via a TcpSocket and notifies a receiver to their
   * commands */
 class LISTENER_DLLEXPORT PlayerListener : public QLocalServer
@@ -46,8 +47,8 @@ private slots:
 
     QString processLine( const QString& line );
 
-private:    
-    QMap<QString, PlayerConnection*> m_connections;
+private:
+    PlayerCommandProcessor* m_processor;
 };
 
 
@@ -18,16 +18,19 @@
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "LegacyPlayerListener.h"
-#include "../PlayerCommandParser.h"
-#include "../PlayerConnection.h"
+#include "../PlayerCommandProcessor.h"
 #include <QTcpSocket>
 
 
-LegacyPlayerListener::LegacyPlayerListener( QObject* parent )
+LegacyPlayerListener::LegacyPlayerListener( QObject* parent, uint port )
                     : QTcpServer( parent )
 {
+    m_processor = new PlayerCommandProcessor( this );
+    connect( m_processor, SIGNAL(newConnection(PlayerConnection*)), SIGNAL(newConnection(PlayerConnection*)) );
+    connect( m_processor, SIGNAL(bootstrapCompleted(QString)), SIGNAL(bootstrapCompleted(QString)) );
+
     connect( this, SIGNAL(newConnection()), SLOT(onNewConnection()) );
-    if (!listen( QHostAddress::LocalHost, port() ))
+    if (!listen( QHostAddress::LocalHost, port ))
         qWarning() << "Couldn't start legacy player listener";
 }
 
@@ -39,6 +42,7 @@ LegacyPlayerListener::onNewConnection()
     {
         QTcpSocket* socket = nextPendingConnection();
         connect( socket, SIGNAL(readyRead()), SLOT(onDataReady()) );
+        connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );
     }
 }
 
@@ -49,47 +53,9 @@ LegacyPlayerListener::onDataReady()
     QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
     if (!socket) return;
 
-    connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );    
-    
-    while (socket->canReadLine())
-    {
-        QString line = QString::fromUtf8( socket->readLine() );
-        
-		try
-        {
-            PlayerCommandParser parser( line );
-
-            QString const id = parser.playerId();
-            PlayerConnection* connection = 0;
-
-            if (!m_connections.contains( id )) {
-                connection = m_connections[id] = new PlayerConnection( parser.playerId(), parser.playerName() );
-                emit newConnection( connection );
-            }
-            else
-                connection = m_connections[id];
-            
-            switch (parser.command())
-            {
-                case CommandTerm:
-                    m_connections.remove( id );
-                    // FALL THROUGH
-                    
-                default:
-                    connection->handleCommand( parser.command(), parser.track() );
-                    break;
-            }
-            
-            socket->write( "OK\n" );
-        }
-        catch (std::invalid_argument& e)
-        {
-            QString const error = QString::fromUtf8( e.what() );
-            qWarning() << line << error;
-            QString s = "ERROR: " + error + "\n";
-            socket->write( s.toUtf8() );
-        }
-    }
-    
-    socket->close();
+    // we leave the socket open, plugins that keep their connection alive
+    // save a TCP handshake per event, the old ones just disconnect
+    QByteArray const responses = m_processor->process( socket );
+    if (responses.size())
+        socket->write( responses );
 }
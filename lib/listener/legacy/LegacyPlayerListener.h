@@ -23,8 +23,8 @@
 #include "lib/DllExportMacro.h"
 #include "../PlayerConnection.h"
 #include <QTcpServer>
-#include <QMap>
 class PlayerConnection;
+class PlayerCommandProcessor;
 
 
 /** listens to external clients via a TcpSocket and notifies a receiver to their
@@ -34,22 +34,22 @@ class LISTENER_DLLEXPORT LegacyPlayerListener : public QTcpServer
     Q_OBJECT
 
 public:
-    LegacyPlayerListener( QObject* parent );
+    /** pass 0 for any free port, the tests do so they can run alongside the
+      * scrobbler, serverPort() tells you which one you got */
+    LegacyPlayerListener( QObject* parent, uint port = LegacyPlayerListener::port() );
     
     static uint port() { return 33367; }
     
 signals:
     void newConnection( class PlayerConnection* );
-    
+    void bootstrapCompleted( const QString& playerId );
+
 private slots:
     void onNewConnection();
     void onDataReady();
 
 private:
-    /** handles the TERM command as conecerning this class */
-    void term( QTcpSocket* );
-
-    QMap<QString, PlayerConnection*> m_connections;
+    PlayerCommandProcessor* m_processor;
 };
 
 #endif
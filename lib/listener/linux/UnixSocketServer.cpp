@@ -0,0 +1,281 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDebug>
+#include <QFile>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "UnixSocketServer.h"
+
+#define MAX_EVENTS 16
+#define BUFSIZE 4096
+#define MAX_LINE_LENGTH (64 * 1024)
+
+
+UnixSocketServer::UnixSocketServer( const QString& path, QObject* parent )
+    : QThread( parent )
+    , m_path( path )
+    , m_listenFd( -1 )
+    , m_epollFd( -1 )
+    , m_wakeFd( eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK ) )
+{
+}
+
+
+UnixSocketServer::~UnixSocketServer()
+{
+    stop();
+    ::close( m_wakeFd );
+}
+
+
+void
+UnixSocketServer::stop()
+{
+    if (!isRunning())
+        return;
+
+    uint64_t const one = 1;
+    if (::write( m_wakeFd, &one, sizeof one ) != sizeof one)
+        qWarning() << "Couldn't wake the scrobsub thread" << strerror( errno );
+    wait();
+}
+
+
+bool
+UnixSocketServer::listen()
+{
+    QByteArray const path = QFile::encodeName( m_path );
+
+    sockaddr_un addr;
+    memset( &addr, 0, sizeof addr );
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= int(sizeof addr.sun_path))
+    {
+        qWarning() << "Socket path too long" << m_path;
+        return false;
+    }
+    memcpy( addr.sun_path, path.constData(), path.size() );
+
+    m_listenFd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if (m_listenFd == -1)
+    {
+        qWarning() << "socket() failed" << strerror( errno );
+        return false;
+    }
+
+    unlink( path.constData() );
+
+    if (bind( m_listenFd, (sockaddr*)&addr, sizeof addr ) == -1
+            || ::listen( m_listenFd, SOMAXCONN ) == -1)
+    {
+        qWarning() << "Couldn't listen on" << m_path << strerror( errno );
+        return false;
+    }
+
+    return true;
+}
+
+
+void
+UnixSocketServer::run()
+{
+    m_epollFd = epoll_create1( EPOLL_CLOEXEC );
+
+    if (m_epollFd == -1 || !listen())
+    {
+        qWarning() << "Couldn't start the scrobsub listener";
+        if (m_listenFd != -1) ::close( m_listenFd );
+        if (m_epollFd != -1) ::close( m_epollFd );
+        m_listenFd = m_epollFd = -1;
+        return;
+    }
+
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = m_listenFd;
+    epoll_ctl( m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev );
+    ev.data.fd = m_wakeFd;
+    epoll_ctl( m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev );
+
+    epoll_event events[MAX_EVENTS];
+    bool running = true;
+
+    while (running)
+    {
+        int const n = epoll_wait( m_epollFd, events, MAX_EVENTS, -1 );
+        if (n == -1)
+        {
+            if (errno == EINTR) continue;
+            qWarning() << "epoll_wait failed" << strerror( errno );
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            int const fd = events[i].data.fd;
+
+            if (fd == m_wakeFd)
+                running = false;
+            else if (fd == m_listenFd)
+                accept();
+            else
+            {
+                bool ok = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    ok = read( fd );
+                if (ok && events[i].events & EPOLLOUT)
+                    ok = write( fd );
+                if (!ok)
+                    close( fd );
+            }
+        }
+    }
+
+    foreach (int fd, m_clients.keys())
+        close( fd );
+
+    ::close( m_listenFd );
+    ::close( m_epollFd );
+    unlink( QFile::encodeName( m_path ).constData() );
+    m_listenFd = m_epollFd = -1;
+}
+
+
+void
+UnixSocketServer::accept()
+{
+    int fd;
+    while ((fd = accept4( m_listenFd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC )) != -1)
+    {
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl( m_epollFd, EPOLL_CTL_ADD, fd, &ev );
+        m_clients.insert( fd, Client() );
+    }
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+        qWarning() << "accept failed" << strerror( errno );
+}
+
+
+bool
+UnixSocketServer::read( int fd )
+{
+    Client& client = m_clients[fd];
+    bool open = true;
+
+    QList<QByteArray> lines;
+    char buffer[BUFSIZE];
+    for (;;)
+    {
+        ssize_t const n = ::read( fd, buffer, sizeof buffer );
+        if (n > 0)
+        {
+            client.in.append( buffer, n );
+
+            int start = 0;
+            int end;
+            while ((end = client.in.indexOf( '\n', start )) != -1)
+            {
+                lines += client.in.mid( start, end + 1 - start );
+                start = end + 1;
+            }
+            client.in.remove( 0, start );
+
+            // no command is anywhere near this long, whoever it is isn't a
+            // player. The lines before it still get handled and answered
+            if (client.in.size() > MAX_LINE_LENGTH)
+            {
+                qWarning() << "Line too long, closing the connection";
+                client.in.clear();
+                open = false;
+                break;
+            }
+        }
+        else if (n == -1 && errno == EINTR)
+            continue;
+        else
+        {
+            // 0 is EOF, otherwise EAGAIN means we've drained it
+            open = n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            break;
+        }
+    }
+
+    if (lines.count())
+    {
+        QList<PlayerEvent> events;
+        client.out += PlayerCommandProcessor::parse( m_parser, lines, events );
+
+        if (events.count())
+            emit eventsReady( events );
+    }
+
+    return write( fd ) && open;
+}
+
+
+bool
+UnixSocketServer::write( int fd )
+{
+    Client& client = m_clients[fd];
+
+    while (client.out.size())
+    {
+        ssize_t const n = ::send( fd, client.out.constData(), client.out.size(), MSG_NOSIGNAL );
+        if (n == -1)
+        {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            break;
+        }
+        client.out.remove( 0, n );
+    }
+
+    // only ask for EPOLLOUT while we have something to send
+    if (client.writing == client.out.isEmpty())
+    {
+        client.writing = !client.writing;
+
+        epoll_event ev;
+        ev.events = client.writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl( m_epollFd, EPOLL_CTL_MOD, fd, &ev );
+    }
+
+    return true;
+}
+
+
+void
+UnixSocketServer::close( int fd )
+{
+    epoll_ctl( m_epollFd, EPOLL_CTL_DEL, fd, 0 );
+    ::close( fd );
+    m_clients.remove( fd );
+}
@@ -0,0 +1,72 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNIXSOCKETSERVER_H
+#define UNIXSOCKETSERVER_H
+
+#include <QThread>
+#include <QHash>
+
+#include "../PlayerCommandProcessor.h"
+
+/** Serves the scrobsub unix domain socket from its own thread with epoll.
+  * Plugins get their response as soon as the line is parsed, whatever the
+  * GUI thread is doing, and only the collapsed PlayerEvents are posted to
+  * the main thread */
+class UnixSocketServer : public QThread
+{
+    Q_OBJECT
+public:
+    explicit UnixSocketServer( const QString& path, QObject* parent = 0 );
+    ~UnixSocketServer();
+
+    /** wakes the thread up and waits for it to finish */
+    void stop();
+
+signals:
+    void eventsReady( const QList<PlayerEvent>& events );
+
+private:
+    void run();
+
+    bool listen();
+    void accept();
+    /** @returns false if the client has gone away */
+    bool read( int fd );
+    bool write( int fd );
+    void close( int fd );
+
+    struct Client
+    {
+        Client() : writing( false ) {}
+
+        QByteArray in;  // an incomplete line
+        QByteArray out; // responses the socket wasn't ready for
+        bool writing;   // we asked epoll for EPOLLOUT
+    };
+
+    QString const m_path;
+    int m_listenFd;
+    int m_epollFd;
+    int m_wakeFd;
+    QHash<int, Client> m_clients;
+    PlayerCommandParser m_parser;
+};
+
+#endif // UNIXSOCKETSERVER_H
@@ -18,6 +18,7 @@ SOURCES += \
 	PlayerListener.cpp \
 	PlayerConnection.cpp \
 	PlayerCommandParser.cpp \
+	PlayerCommandProcessor.cpp \
         legacy/LegacyPlayerListener.cpp
 
 HEADERS += \
@@ -26,6 +27,7 @@ HEADERS += \
 	PlayerListener.h \
 	PlayerConnection.h \
 	PlayerCommandParser.h \
+	PlayerCommandProcessor.h \
 	PlayerCommand.h \
         legacy/LegacyPlayerListener.h
 
@@ -39,6 +41,11 @@ unix:!mac {
                mpris2/Mpris2Service.h
 }
 
+linux* {
+    SOURCES += linux/UnixSocketServer.cpp
+    HEADERS += linux/UnixSocketServer.h
+}
+
 mac {
     SOURCES += mac/ITunesListener.cpp
 
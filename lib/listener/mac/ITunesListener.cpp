@@ -59,6 +59,16 @@ ITunesListener::ITunesListener( QObject* parent )
                                           "return artist & \"\n\" & album artist & \"\n\" & album & \"\n\" & name & \"\n\" & (duration as integer) & \"\n\" & L & \"\n\" & persistent ID & \"\n\" & podcast & \"\n\" & video kind\n"
                                       "end tell\n" );
 
+    // with shuffle on the next track in the playlist isn't what plays next
+    m_nextTrackScript = AppleScript("tell application \"iTunes\"\n"
+                                        "if shuffle of current playlist then return \"\"\n"
+                                        "set i to index of current track\n"
+                                        "tell current playlist\n"
+                                            "if i < (count of tracks) then tell track (i + 1) to return artist & \"\n\" & album & \"\n\" & name\n"
+                                        "end tell\n"
+                                    "end tell\n"
+                                    "return \"\"\n" );
+
     CFNotificationCenterAddObserver( CFNotificationCenterGetDistributedCenter(),
                                     this,
                                     callback,
@@ -216,6 +226,7 @@ ITunesListener::callback( CFDictionaryRef info )
                 t.setPodcast( podcast );
                 t.setVideo( video );
                 m_connection->start( t );
+                m_connection->setNextTrack( nextTrack() );
             }
 
             m_previousPid = pid;
@@ -278,5 +289,25 @@ ITunesListener::setupCurrentTrack()
             emit newConnection( m_connection = new ITunesConnection );
 
         m_connection->start( t );
+        m_connection->setNextTrack( nextTrack() );
     }
 }
+
+
+/** What iTunes will play after the current track, if we can tell */
+Track
+ITunesListener::nextTrack()
+{
+    QString output = m_nextTrackScript.exec();
+
+    if ( output.isEmpty() )
+        return Track();
+
+    QTextStream s( &output, QIODevice::ReadOnly | QIODevice::Text );
+
+    MutableTrack t;
+    t.setArtist( s.readLine() );
+    t.setAlbum( s.readLine() );
+    t.setTitle( s.readLine() );
+    return t;
+}
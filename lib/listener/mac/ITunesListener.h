@@ -22,6 +22,7 @@
 
 #include <QThread>
 #include <CoreFoundation/CoreFoundation.h>
+#include <lastfm/Track.h>
 
 #include "lib/unicorn/mac/AppleScript.h"
 
@@ -40,6 +41,7 @@ signals:
     
 private:
     static bool iTunesIsPlaying();
+    Track nextTrack();
 
     /** iTunes notification center callback */
     static void callback( CFNotificationCenterRef, 
@@ -59,6 +61,7 @@ private:
     struct ITunesConnection* m_connection;
 
     AppleScript m_currentTrackScript;
+    AppleScript m_nextTrackScript;
 };
 
 #endif
@@ -90,6 +90,10 @@ Mpris2Listener::addService( const QString& name )
              SIGNAL( stateChanged( const QString& )),
              this,
              SLOT(onChangedState( const QString& )) );
+    connect( service,
+             SIGNAL( nextTrackFetched( const lastfm::Track& )),
+             this,
+             SLOT( onNextTrackFetched( const lastfm::Track& )) );
 }
 
 
@@ -177,6 +181,9 @@ Mpris2Listener::onChangedState( const QString& state )
             {
                 m_connection->start( t );
                 m_lastTrack = t;
+
+                // so the app can get ready for it while this one plays
+                service->fetchNextTrack();
             }
         }
         else if ( state == "Paused" )
@@ -190,3 +197,13 @@ Mpris2Listener::onChangedState( const QString& state )
         m_lastPlayerState = state;
     }
 }
+
+
+void
+Mpris2Listener::onNextTrackFetched( const lastfm::Track& track )
+{
+    Mpris2Service* service = static_cast<Mpris2Service*>(sender());
+
+    if ( m_connection && service->name() == m_currentService )
+        m_connection->setNextTrack( track );
+}
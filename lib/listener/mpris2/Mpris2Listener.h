@@ -55,6 +55,7 @@ private slots:
             const QString& oldOwner,
             const QString& newOwner );
     void onChangedState( const QString& state );
+    void onNextTrackFetched( const lastfm::Track& track );
 };
 
 #endif
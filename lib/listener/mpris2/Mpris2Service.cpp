@@ -20,12 +20,15 @@
 #include "Mpris2Service.h"
 
 #include <QDBusInterface>
-#include <QDBusReply>
 #include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusReply>
 
 #define MPRIS2_PATH         "/org/mpris/MediaPlayer2"
 #define MPRIS2_ROOT_IFACE   "org.mpris.MediaPlayer2"
 #define MPRIS2_PLAYER_IFACE "org.mpris.MediaPlayer2.Player"
+#define MPRIS2_TRACKLIST_IFACE "org.mpris.MediaPlayer2.TrackList"
 #define DBUS_PROPS_IFACE    "org.freedesktop.DBus.Properties"
 
 
@@ -42,9 +45,23 @@ QVariantMap demarshallMetadata(const QVariant &value)
 }
 
 
+static
+QDBusObjectPath trackId( const QVariantMap& metadata )
+{
+    QVariant const id = metadata.value( "mpris:trackid" );
+
+    // some players send the track id as a plain string
+    if ( id.canConvert<QDBusObjectPath>() )
+        return id.value<QDBusObjectPath>();
+    return QDBusObjectPath( id.toString() );
+}
+
+
 Mpris2Service::Mpris2Service( const QString& name, QObject * parent )
-    : QObject( parent )
+    : QObject( parent ), m_nextTrackRequest( 0 )
 {
+    qDBusRegisterMetaType<QList<QDBusObjectPath> >();
+
     m_state = "Stopped";
 
     m_propsIface = new QDBusInterface( name,
@@ -131,6 +148,121 @@ Mpris2Service::url() const
 }
 
 
+QDBusPendingCall
+Mpris2Service::asyncGetProp( const QString& interface, const QString& prop ) const
+{
+    QDBusMessage message = QDBusMessage::createMethodCall( name(), MPRIS2_PATH, DBUS_PROPS_IFACE, "Get" );
+    message << interface << prop;
+    return QDBusConnection::sessionBus().asyncCall( message );
+}
+
+
+void
+Mpris2Service::fetchNextTrack()
+{
+    // the player may be slow to answer, so we never wait for it
+    ++m_nextTrackRequest;
+    watchNextTrackCall( asyncGetProp( MPRIS2_ROOT_IFACE, "HasTrackList" ), SLOT(onHasTrackList(QDBusPendingCallWatcher*)) );
+}
+
+
+void
+Mpris2Service::watchNextTrackCall( const QDBusPendingCall& call, const char* slot )
+{
+    QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher( call, this );
+    watcher->setProperty( "request", m_nextTrackRequest );
+    connect( watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), slot );
+}
+
+
+/** false if the track changed and the next track was asked for again since */
+bool
+Mpris2Service::isNextTrackReply( QDBusPendingCallWatcher* watcher ) const
+{
+    watcher->deleteLater();
+    return watcher->property( "request" ).toInt() == m_nextTrackRequest;
+}
+
+
+void
+Mpris2Service::onHasTrackList( QDBusPendingCallWatcher* watcher )
+{
+    if ( !isNextTrackReply( watcher ) )
+        return;
+
+    QDBusPendingReply<QDBusVariant> reply = *watcher;
+    if ( reply.isError() || !reply.value().variant().toBool() )
+    {
+        emit nextTrackFetched( lastfm::Track() );
+        return;
+    }
+
+    watchNextTrackCall( asyncGetProp( MPRIS2_TRACKLIST_IFACE, "Tracks" ), SLOT(onTracks(QDBusPendingCallWatcher*)) );
+}
+
+
+void
+Mpris2Service::onTracks( QDBusPendingCallWatcher* watcher )
+{
+    if ( !isNextTrackReply( watcher ) )
+        return;
+
+    QDBusPendingReply<QDBusVariant> reply = *watcher;
+    QVariant const value = reply.isError() ? QVariant() : reply.value().variant();
+    if ( !value.canConvert<QDBusArgument>() )
+    {
+        emit nextTrackFetched( lastfm::Track() );
+        return;
+    }
+
+    QList<QDBusObjectPath> tracks;
+    value.value<QDBusArgument>() >> tracks;
+
+    QString const current = trackId( m_metadata ).path();
+    int i = 0;
+    while ( i < tracks.count() && tracks[i].path() != current )
+        ++i;
+
+    if ( i + 1 >= tracks.count() )
+    {
+        emit nextTrackFetched( lastfm::Track() );
+        return;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall( name(), MPRIS2_PATH, MPRIS2_TRACKLIST_IFACE, "GetTracksMetadata" );
+    message << QVariant::fromValue( QList<QDBusObjectPath>() << tracks[i + 1] );
+    watchNextTrackCall( QDBusConnection::sessionBus().asyncCall( message ), SLOT(onTracksMetadata(QDBusPendingCallWatcher*)) );
+}
+
+
+void
+Mpris2Service::onTracksMetadata( QDBusPendingCallWatcher* watcher )
+{
+    if ( !isNextTrackReply( watcher ) )
+        return;
+
+    QDBusMessage const reply = watcher->reply();
+    QList<QVariantMap> metadata;
+
+    if ( reply.type() == QDBusMessage::ReplyMessage && !reply.arguments().isEmpty() )
+        reply.arguments().first().value<QDBusArgument>() >> metadata;
+
+    if ( metadata.isEmpty() )
+    {
+        emit nextTrackFetched( lastfm::Track() );
+        return;
+    }
+
+    lastfm::MutableTrack t;
+    QStringList const artists = metadata.first().value( "xesam:artist" ).toStringList();
+    if ( !artists.isEmpty() )
+        t.setArtist( artists.first() );
+    t.setTitle( metadata.first().value( "xesam:title" ).toString() );
+    t.setAlbum( metadata.first().value( "xesam:album" ).toString() );
+    emit nextTrackFetched( t );
+}
+
+
 void
 Mpris2Service::propsChanged( const QString& str,
                                   const QVariantMap& changedProperties,
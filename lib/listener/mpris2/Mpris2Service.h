@@ -22,8 +22,11 @@
 
 #include <QString>
 #include <QVariantMap>
+#include <lastfm/Track.h>
 
 class QDBusInterface;
+class QDBusPendingCall;
+class QDBusPendingCallWatcher;
 
 class Mpris2Service : public QObject
 {
@@ -41,20 +44,38 @@ public:
     uint length() const;
     QString url() const;
 
+    /** Asks the player for the track after the current one in its
+      * TrackList without waiting for it, nextTrackFetched() has the answer.
+      * Only the answer to the last ask is given. */
+    void fetchNextTrack();
+
 signals:
     void stateChanged( const QString& );
 
+    /** a null track if the player doesn't have one or doesn't implement
+      * TrackList */
+    void nextTrackFetched( const lastfm::Track& );
+
 private:
     QString m_state;
     QDBusInterface* m_propsIface;
     QVariantMap m_metadata;
 
+    int m_nextTrackRequest;
+
     QVariant getProp( const QString& interface, const QString& prop ) const;
+    QDBusPendingCall asyncGetProp( const QString& interface, const QString& prop ) const;
+    void watchNextTrackCall( const QDBusPendingCall& call, const char* slot );
+    bool isNextTrackReply( QDBusPendingCallWatcher* watcher ) const;
 
 private slots:
     void propsChanged( const QString& interface,
             const QVariantMap& changedProperties,
             const QStringList& invalidatedProperties );
+
+    void onHasTrackList( QDBusPendingCallWatcher* watcher );
+    void onTracks( QDBusPendingCallWatcher* watcher );
+    void onTracksMetadata( QDBusPendingCallWatcher* watcher );
 };
 
 #endif
@@ -0,0 +1,257 @@
+/*
+   Copyright 2005-2009 Last.fm Ltd. 
+      - Primarily authored by Max Howell, Jono Cole and Doug Mansell
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Headless load generator for the scrobsub protocol. Starts a PlayerListener
+  * and PlayerMediator in process, hammers them with N concurrent clients the
+  * way ScrobSocket talks to them, and reports round trip latency percentiles
+  * and throughput. Exits non-zero on protocol errors or if p99 is above
+  * --max-p99, so CI can catch regressions.
+  *
+  *     test_listenerload [--clients N] [--commands N] [--max-p99 usecs] */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QtAlgorithms>
+#include <lastfm/misc.h>
+#include <cstdio>
+
+#include "PlayerListener.h"
+#include "PlayerMediator.h"
+
+
+struct Metadata
+{
+    const char* artist;
+    const char* title;
+    const char* album;
+    const char* path;
+};
+
+static const Metadata kTracks[] =
+{
+    { "佐橋俊彦", "対峙", "TV Animation ジパング original Soundtrack", "/home/tester/15%20対峙.mp3" },
+    { "Simon && Garfunkel", "The Boxer", "Bridge Over Troubled Water", "/home/tester/boxer.mp3" },
+    { "Кино", "Группа крови", "Группа крови", "/home/tester/%D0%BA%D0%B8%D0%BD%D0%BE.mp3" },
+    { "Sigur Rós", "Hoppípolla", "Takk...", "/home/tester/hoppipolla.ogg" },
+    { "Björk", "Jóga", "Homogenic", "/home/tester/joga.flac" },
+    { "Mötley Crüe", "Kickstart My Heart", "Dr. Feelgood", "/home/tester/kickstart.mp3" }
+};
+
+
+/** one plugin, sends its commands one at a time and waits for each response */
+class LoadClient : public QThread
+{
+    QString const m_path;
+    QString const m_id;
+    int const m_commands;
+
+public:
+    LoadClient( const QString& path, int id, int commands )
+        : m_path( path ), m_id( "lg" + QString::number( id ) ), m_commands( commands ), errors( 0 )
+    {
+        latencies.reserve( commands );
+    }
+
+    QVector<qint64> latencies; // nanoseconds
+    int errors;
+
+protected:
+    void run()
+    {
+        QLocalSocket socket;
+
+        // the listener may still be setting up its socket
+        for (int i = 0; i < 50 && socket.state() != QLocalSocket::ConnectedState; ++i)
+        {
+            socket.connectToServer( m_path );
+            if (!socket.waitForConnected( 100 ))
+                msleep( 20 );
+        }
+
+        if (socket.state() != QLocalSocket::ConnectedState)
+        {
+            fprintf( stderr, "%s: couldn't connect to %s\n", qPrintable( m_id ), qPrintable( m_path ) );
+            errors = m_commands;
+            return;
+        }
+
+        qsrand( qHash( m_id ) );
+        bool playing = false;
+        bool paused = false;
+
+        for (int i = 0; i < m_commands; ++i)
+        {
+            QByteArray line;
+            int const r = qrand() % 20;
+
+            if (!playing || r == 0)
+            {
+                Metadata const& t = kTracks[qrand() % (sizeof kTracks / sizeof kTracks[0])];
+                line = "START c=" + m_id.toUtf8() + "&a=" + t.artist + "&t=" + t.title + "&b=" + t.album
+                     + "&l=" + QByteArray::number( 120 + qrand() % 300 ) + "&p=" + t.path + "\n";
+                playing = true;
+                paused = false;
+            }
+            else if (r == 1)
+            {
+                line = "STOP c=" + m_id.toUtf8() + "\n";
+                playing = false;
+            }
+            else
+            {
+                line = (paused ? "RESUME c=" : "PAUSE c=") + m_id.toUtf8() + "\n";
+                paused = !paused;
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+
+            socket.write( line );
+            socket.flush();
+
+            while (!socket.canReadLine())
+                if (!socket.waitForReadyRead( 5000 ))
+                {
+                    fprintf( stderr, "%s: timed out waiting for a response\n", qPrintable( m_id ) );
+                    errors += m_commands - i;
+                    return;
+                }
+
+            QByteArray const response = socket.readLine();
+            latencies += timer.nsecsElapsed();
+
+            if (response != "OK\n")
+            {
+                fprintf( stderr, "%s: %s -> %s", qPrintable( m_id ), line.constData(), response.constData() );
+                ++errors;
+            }
+        }
+
+        socket.disconnectFromServer();
+    }
+};
+
+
+static qint64 percentile( const QVector<qint64>& sorted, double p )
+{
+    if (sorted.isEmpty()) return 0;
+    int const i = qMin( sorted.size() - 1, int( p * sorted.size() ) );
+    return sorted[i];
+}
+
+
+int main( int argc, char** argv )
+{
+    QCoreApplication app( argc, argv );
+
+    int clients = 8;
+    int commands = 2000;
+    qint64 maxP99 = 0; // microseconds, 0 means don't check
+
+    QStringList const args = app.arguments();
+    for (int i = 1; i < args.count() - 1; ++i)
+    {
+        if (args[i] == "--clients") clients = args[++i].toInt();
+        else if (args[i] == "--commands") commands = args[++i].toInt();
+        else if (args[i] == "--max-p99") maxP99 = args[++i].toLongLong();
+    }
+
+    QString const path = lastfm::dir::runtimeData().absolutePath() + "/lastfm_scrobsub";
+
+    // PlayerListener takes the socket over, don't do that to a real scrobbler
+    {
+        QLocalSocket probe;
+        probe.connectToServer( path );
+        if (probe.waitForConnected( 500 ))
+        {
+            fprintf( stderr, "A scrobbler is already listening on %s, quit it first\n", qPrintable( path ) );
+            return 2;
+        }
+    }
+
+    PlayerMediator* mediator = new PlayerMediator( &app );
+    PlayerListener* listener = new PlayerListener( mediator );
+    QObject::connect( listener, SIGNAL(newConnection(PlayerConnection*)), mediator, SLOT(follow(PlayerConnection*)) );
+
+    QList<LoadClient*> threads;
+    for (int i = 0; i < clients; ++i)
+    {
+        threads += new LoadClient( path, i, commands );
+        // quit once the last one is done
+        QObject::connect( threads.last(), SIGNAL(finished()), &app, SLOT(quit()) );
+    }
+
+    QElapsedTimer wall;
+    wall.start();
+
+    foreach (LoadClient* t, threads)
+        t->start();
+
+    // finished() quits the event loop, go round again until they all have
+    forever
+    {
+        bool running = false;
+        foreach (LoadClient* t, threads)
+            running |= !t->isFinished();
+        if (!running)
+            break;
+        app.exec();
+    }
+
+    qint64 const elapsed = wall.elapsed();
+
+    QVector<qint64> latencies;
+    int errors = 0;
+    foreach (LoadClient* t, threads)
+    {
+        t->wait();
+        latencies += t->latencies;
+        errors += t->errors;
+        delete t;
+    }
+
+    qSort( latencies );
+
+    qint64 const p50 = percentile( latencies, 0.50 ) / 1000;
+    qint64 const p99 = percentile( latencies, 0.99 ) / 1000;
+    qint64 const p999 = percentile( latencies, 0.999 ) / 1000;
+    qint64 const max = latencies.isEmpty() ? 0 : latencies.last() / 1000;
+
+    printf( "clients: %d, commands: %d, errors: %d\n", clients, latencies.size(), errors );
+    printf( "throughput: %.0f commands/s\n", elapsed ? latencies.size() * 1000.0 / elapsed : 0.0 );
+    printf( "latency: p50 %lld us, p99 %lld us, p999 %lld us, max %lld us\n", p50, p99, p999, max );
+
+    delete mediator;
+
+    if (errors)
+        return 1;
+
+    if (maxP99 && p99 > maxP99)
+    {
+        fprintf( stderr, "p99 latency %lld us is above the %lld us limit\n", p99, maxP99 );
+        return 1;
+    }
+
+    return 0;
+}
@@ -36,6 +36,10 @@ private slots:
     void testInvalidCommand();
     void testDuplicatedArgument();
     void testUnicode();
+    void testEscapedAmpersand();
+    void testReuse();
+
+    void benchmarkParse();
 };
 
 
@@ -98,65 +102,32 @@ TestPlayerCommandParser::testBootstrap()
 void
 TestPlayerCommandParser::testEmptyLine()
 {
-    // The PlayerCommandParser should throw an exception on empty lines
-    try
-    {
-        PlayerCommandParser pcp ( "" );
-        
-        QFAIL( "PlayerCommandParser did not throw an exception on an empty line." );
-    }
-    catch ( PlayerCommandParser::Exception e )
-    {
-        // Success
-    }
+    PlayerCommandParser pcp ( "" );
+    QCOMPARE( pcp.error(), PlayerCommandParser::EmptyLine );
+
+    PlayerCommandParser pcp2 ( " \r\n" );
+    QCOMPARE( pcp2.error(), PlayerCommandParser::EmptyLine );
 }
 
 void
 TestPlayerCommandParser::testMissingArgument()
 {
-    // The PlayerCommandParser should throw an exception when arguments are missing
-    try
-    {
-        PlayerCommandParser pcp ( "START c=testap" );
-        
-        QFAIL( "PlayerCommandParser did not throw an exception when arguments are missing." );
-    }
-    catch ( PlayerCommandParser::Exception e )
-    {
-        // Success
-    }
+    PlayerCommandParser pcp ( "START c=testap" );
+    QCOMPARE( pcp.error(), PlayerCommandParser::MissingArgument );
 }
 
 void
 TestPlayerCommandParser::testInvalidCommand()
 {
-    // The PlayerCommandParser should throw an exception when passed a invalid command
-    try
-    {
-        PlayerCommandParser pcp ( "SUPERSTART c=testap" );
-        
-        QFAIL( "PlayerCommandParser did not throw an exception when passed a invalid command." );
-    }
-    catch ( PlayerCommandParser::Exception e )
-    {
-        // Success
-    }
+    PlayerCommandParser pcp ( "SUPERSTART c=testap" );
+    QCOMPARE( pcp.error(), PlayerCommandParser::InvalidCommand );
 }
 
 void
 TestPlayerCommandParser::testDuplicatedArgument()
 {
-    // The PlayerCommandParser should throw an exception when arguments are duplicated
-    try
-    {
-        PlayerCommandParser pcp ( "START c=testap&c=testapp2" );
-        
-        QFAIL( "PlayerCommandParser did not throw an exception when arguments are duplicated." );
-    }
-    catch ( PlayerCommandParser::Exception e )
-    {
-        // Success
-    }
+    PlayerCommandParser pcp ( "START c=testap&c=testapp2" );
+    QCOMPARE( pcp.error(), PlayerCommandParser::DuplicatedField );
 }
 
 void
@@ -178,6 +149,63 @@ TestPlayerCommandParser::testUnicode()
     QCOMPARE( pcp.track().url().path(), QString( "/home/tester/15 対峙.mp3" ) );
 }
 
+void
+TestPlayerCommandParser::testEscapedAmpersand()
+{
+    PlayerCommandParser pcp( "START c=testapp"
+                                   "&a=Simon && Garfunkel"
+                                   "&t=The Boxer"
+                                   "&b=Bridge Over Troubled Water"
+                                   "&l=308"
+                                   "&p=/home/tester/boxer.mp3\n" );
+
+    QCOMPARE( pcp.error(), PlayerCommandParser::NoError );
+    QCOMPARE( pcp.track().artist(), Artist( "Simon & Garfunkel" ) );
+    QCOMPARE( pcp.track().title(), QString( "The Boxer" ) );
+}
+
+void
+TestPlayerCommandParser::testReuse()
+{
+    PlayerCommandParser pcp;
+
+    QCOMPARE( pcp.parse( "BOOTSTRAP c=testapp&u=TestUser" ), PlayerCommandParser::NoError );
+    QCOMPARE( pcp.username(), QString( "TestUser" ) );
+
+    QCOMPARE( pcp.parse( "STOP c=" ), PlayerCommandParser::EmptyPlayerId );
+
+    QCOMPARE( pcp.parse( "pause c=otherapp" ), PlayerCommandParser::NoError );
+    QCOMPARE( pcp.command(), CommandPause );
+    QCOMPARE( pcp.playerId(), QString( "otherapp" ) );
+    QVERIFY( pcp.username().isEmpty() );
+}
+
+/** each iteration parses kLines lines, so lines per second is
+  * kLines * 1000 / msecs per iteration */
+void
+TestPlayerCommandParser::benchmarkParse()
+{
+    const int kLines = 1000;
+
+    // the bursts we get while a user scrubs through a playlist
+    QList<QByteArray> lines;
+    lines << "START c=testapp&a=佐橋俊彦&t=対峙&b=TV Animation ジパング original Soundtrack&l=123&p=/home/tester/15%20対峙.mp3\n"
+          << "PAUSE c=testapp\n"
+          << "RESUME c=testapp\n"
+          << "START c=testapp&a=Simon && Garfunkel&t=The Boxer&b=Bridge Over Troubled Water&l=308&p=/home/tester/boxer.mp3\n";
+
+    PlayerCommandParser pcp;
+
+    QBENCHMARK
+    {
+        for (int i = 0; i < kLines; ++i)
+        {
+            if (pcp.parse( lines[i % lines.count()] ) == PlayerCommandParser::NoError)
+                pcp.track();
+        }
+    }
+}
+
 QTEST_APPLESS_MAIN(TestPlayerCommandParser)
 #include "TestPlayerCommandParser.moc"
 
@@ -0,0 +1,277 @@
+/*
+   Copyright 2005-2009 Last.fm Ltd. 
+      - Primarily authored by Max Howell, Jono Cole and Doug Mansell
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QtTest>
+#include <QBuffer>
+#include <QTcpSocket>
+#include <QThread>
+#include "PlayerCommandProcessor.h"
+#include "PlayerConnection.h"
+#include "legacy/LegacyPlayerListener.h"
+
+
+/** sends count events to the legacy listener, either over a single
+  * connection or connecting afresh for every event like the old plugins */
+class EventClient : public QThread
+{
+    quint16 const m_port;
+    bool const m_persistent;
+    int const m_count;
+
+public:
+    EventClient( quint16 port, bool persistent, int count ) : m_port( port ), m_persistent( persistent ), m_count( count ), sent( 0 )
+    {}
+
+    int sent;
+
+protected:
+    void run()
+    {
+        QTcpSocket* socket = 0;
+
+        for (int i = 0; i < m_count; ++i)
+        {
+            if (!socket)
+            {
+                socket = new QTcpSocket;
+                socket->connectToHost( QHostAddress::LocalHost, m_port );
+                if (!socket->waitForConnected())
+                    break;
+            }
+
+            socket->write( i % 2 ? "PAUSE c=bench\n" : "RESUME c=bench\n" );
+
+            while (!socket->canReadLine())
+                if (!socket->waitForReadyRead())
+                    goto done;
+            socket->readLine();
+            ++sent;
+
+            if (!m_persistent)
+            {
+                socket->disconnectFromHost();
+                if (socket->state() != QAbstractSocket::UnconnectedState)
+                    socket->waitForDisconnected();
+                delete socket;
+                socket = 0;
+            }
+        }
+
+    done:
+        delete socket;
+    }
+};
+
+
+class TestPlayerCommandProcessor : public QObject
+{
+    Q_OBJECT
+
+    QList<PlayerConnection*> m_connections;
+    QStringList m_started;
+    int m_stopped;
+
+private slots:
+    void init();
+
+    void testResponses();
+    void testCollapseStartStopStart();
+    void testCollapseStopPause();
+    void testCollapsePauseResume();
+    void testBootstrap();
+    void testPartialLine();
+
+    void benchmarkEvents_data();
+    void benchmarkEvents();
+
+    // from the PlayerConnections we are given
+    void onNewConnection( PlayerConnection* );
+    void onTrackStarted( const lastfm::Track& );
+    void onStopped() { ++m_stopped; }
+};
+
+
+void
+TestPlayerCommandProcessor::init()
+{
+    m_connections.clear();
+    m_started.clear();
+    m_stopped = 0;
+}
+
+
+void
+TestPlayerCommandProcessor::onNewConnection( PlayerConnection* connection )
+{
+    m_connections += connection;
+    connect( connection, SIGNAL(trackStarted(lastfm::Track, lastfm::Track)), SLOT(onTrackStarted(lastfm::Track)) );
+    connect( connection, SIGNAL(stopped()), SLOT(onStopped()) );
+}
+
+
+void
+TestPlayerCommandProcessor::onTrackStarted( const lastfm::Track& t )
+{
+    m_started += t.title();
+}
+
+
+void
+TestPlayerCommandProcessor::testResponses()
+{
+    PlayerCommandProcessor processor;
+
+    QList<QByteArray> lines;
+    lines << "START c=testapp&a=Artist&t=Title&b=Album&l=100&p=/test.mp3\n"
+          << "SUPERSTART c=testapp\n"
+          << "STOP c=testapp\n";
+
+    QCOMPARE( processor.process( lines ), QByteArray( "OK\nERROR: Invalid command\nOK\n" ) );
+}
+
+
+void
+TestPlayerCommandProcessor::testCollapseStartStopStart()
+{
+    PlayerCommandProcessor processor;
+    connect( &processor, SIGNAL(newConnection(PlayerConnection*)), SLOT(onNewConnection(PlayerConnection*)) );
+
+    QList<QByteArray> lines;
+    lines << "START c=testapp&a=Artist&t=One&b=Album&l=100&p=/one.mp3\n"
+          << "STOP c=testapp\n"
+          << "START c=testapp&a=Artist&t=Two&b=Album&l=100&p=/two.mp3\n";
+
+    processor.process( lines );
+
+    QCOMPARE( m_started, QStringList() << "Two" );
+    QCOMPARE( m_stopped, 0 );
+}
+
+
+void
+TestPlayerCommandProcessor::testCollapseStopPause()
+{
+    PlayerCommandProcessor processor;
+    connect( &processor, SIGNAL(newConnection(PlayerConnection*)), SLOT(onNewConnection(PlayerConnection*)) );
+
+    processor.process( QList<QByteArray>() << "START c=testapp&a=Artist&t=One&b=Album&l=100&p=/one.mp3\n" );
+
+    QList<QByteArray> lines;
+    lines << "STOP c=testapp\n"
+          << "PAUSE c=testapp\n"
+          << "RESUME c=testapp\n";
+
+    processor.process( lines );
+
+    // the connection waits a second before it stops, in case a START follows
+    QTest::qWait( 1500 );
+
+    QCOMPARE( m_started, QStringList() << "One" );
+    QCOMPARE( m_stopped, 1 );
+    QCOMPARE( m_connections[0]->state(), Stopped );
+}
+
+
+void
+TestPlayerCommandProcessor::testCollapsePauseResume()
+{
+    PlayerCommandProcessor processor;
+    connect( &processor, SIGNAL(newConnection(PlayerConnection*)), SLOT(onNewConnection(PlayerConnection*)) );
+
+    QList<QByteArray> lines;
+    lines << "START c=testapp&a=Artist&t=One&b=Album&l=100&p=/one.mp3\n"
+          << "PAUSE c=testapp\n"
+          << "RESUME c=testapp\n"
+          << "PAUSE c=testapp\n"
+          << "START c=other&a=Artist&t=Two&b=Album&l=100&p=/two.mp3\n";
+
+    processor.process( lines );
+
+    QCOMPARE( m_connections.count(), 2 );
+    QCOMPARE( m_started, QStringList() << "One" << "Two" );
+    QCOMPARE( m_connections[0]->state(), Paused );
+}
+
+
+void
+TestPlayerCommandProcessor::testBootstrap()
+{
+    PlayerCommandProcessor processor;
+    QSignalSpy spy( &processor, SIGNAL(bootstrapCompleted(QString)) );
+
+    processor.process( QList<QByteArray>() << "BOOTSTRAP c=testapp&u=TestUser\n" );
+
+    QCOMPARE( spy.count(), 1 );
+    QCOMPARE( spy.at( 0 ).at( 0 ).toString(), QString( "testapp" ) );
+}
+
+
+void
+TestPlayerCommandProcessor::testPartialLine()
+{
+    PlayerCommandProcessor processor;
+
+    QBuffer buffer;
+    buffer.open( QIODevice::ReadWrite );
+    buffer.write( "PAUSE c=testapp\nRESUME c=tes" );
+    buffer.seek( 0 );
+
+    QCOMPARE( processor.process( &buffer ), QByteArray( "OK\n" ) );
+    QCOMPARE( buffer.bytesAvailable(), qint64( 12 ) );
+}
+
+
+void
+TestPlayerCommandProcessor::benchmarkEvents_data()
+{
+    QTest::addColumn<bool>( "persistent" );
+
+    QTest::newRow( "reconnect per event" ) << false;
+    QTest::newRow( "persistent connection" ) << true;
+}
+
+
+/** each iteration sends kEvents events, so events per second is
+  * kEvents * 1000 / msecs per iteration */
+void
+TestPlayerCommandProcessor::benchmarkEvents()
+{
+    QFETCH( bool, persistent );
+
+    const int kEvents = 500;
+
+    // any free port, so a running scrobbler doesn't get in the way
+    LegacyPlayerListener listener( this, 0 );
+    QVERIFY( listener.isListening() );
+
+    QBENCHMARK
+    {
+        EventClient client( listener.serverPort(), persistent, kEvents );
+        QEventLoop loop;
+        connect( &client, SIGNAL(finished()), &loop, SLOT(quit()) );
+        client.start();
+        loop.exec();
+
+        QCOMPARE( client.sent, kEvents );
+    }
+}
+
+
+QTEST_MAIN(TestPlayerCommandProcessor)
+#include "TestPlayerCommandProcessor.moc"
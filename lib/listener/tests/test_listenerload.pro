@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = test_listenerload
+QT = core network
+CONFIG += listener unicorn logger
+CONFIG -= app_bundle
+INCLUDEPATH += ..
+include( ../../../admin/include.qmake )
+
+unix:!mac:QT += dbus
+
+DEFINES += LASTFM_COLLAPSE_NAMESPACE
+SOURCES = ListenerLoadTest.cpp
@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = test_playercommandprocessor
+QT = testlib network
+CONFIG += core types
+INCLUDEPATH += ..
+include( ../../../admin/include.qmake )
+
+DEFINES += LASTFM_COLLAPSE_NAMESPACE _LISTENER_DLLEXPORT
+SOURCES = TestPlayerCommandProcessor.cpp \
+          ../PlayerCommandProcessor.cpp \
+          ../PlayerCommandParser.cpp \
+          ../PlayerConnection.cpp \
+          ../legacy/LegacyPlayerListener.cpp
+HEADERS = ../PlayerCommandProcessor.h \
+          ../PlayerConnection.h \
+          ../legacy/LegacyPlayerListener.h
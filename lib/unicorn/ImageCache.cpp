@@ -0,0 +1,326 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegExp>
+
+#include <lastfm/misc.h>
+#include <lastfm/ws.h>
+
+#include "ImageCache.h"
+#include "UnicornSettings.h"
+
+// plenty for the avatars of a long friends list and a few albums' artwork
+#define MEMORY_CACHE_SIZE ( 8 * 1024 * 1024 )
+
+// how long an image without a max-age is used before we revalidate it
+#define DEFAULT_FRESHNESS ( 24 * 60 * 60 )
+
+#define META_VERSION 1
+
+unicorn::ImageReply::ImageReply( const QUrl& url, QObject* parent )
+    :QObject( parent ), m_url( url )
+{
+}
+
+void
+unicorn::ImageReply::finish( const QByteArray& data )
+{
+    m_data = data;
+
+    // callers connect to us after get() returns, even when we already have it
+    QMetaObject::invokeMethod( this, "finished", Qt::QueuedConnection );
+}
+
+
+unicorn::ImageCache::ImageCache( const QString& path, qint64 maxDiskSize, QObject* parent )
+    :QObject( parent ),
+     m_dir( path ),
+     m_diskSize( 0 ),
+     m_maxDiskSize( maxDiskSize ),
+     m_memoryHits( 0 ),
+     m_diskHits( 0 ),
+     m_revalidated( 0 ),
+     m_coalesced( 0 ),
+     m_misses( 0 )
+{
+    m_memory.setMaxCost( MEMORY_CACHE_SIZE );
+
+    if ( !m_dir.exists() )
+        m_dir.mkpath( "." );
+
+    foreach ( const QFileInfo& file, m_dir.entryInfoList( QDir::Files ) )
+        m_diskSize += file.size();
+
+    trim();
+}
+
+unicorn::ImageCache& //static
+unicorn::ImageCache::instance()
+{
+    static ImageCache* cache = 0;
+
+    if ( !cache )
+        cache = new ImageCache( lastfm::dir::cache().filePath( "images" ), unicorn::Settings().imageCacheSize(), qApp );
+
+    return *cache;
+}
+
+void
+unicorn::ImageCache::setMaxDiskSize( qint64 maxDiskSize )
+{
+    m_maxDiskSize = maxDiskSize;
+    trim();
+}
+
+QString //static
+unicorn::ImageCache::key( const QUrl& url )
+{
+    return QCryptographicHash::hash( url.toEncoded(), QCryptographicHash::Sha1 ).toHex();
+}
+
+/** When the image the reply brought us should next be revalidated */
+QDateTime //static
+unicorn::ImageCache::expires( QNetworkReply* reply )
+{
+    int freshness = DEFAULT_FRESHNESS;
+
+    QRegExp maxAge( "max-age=(\\d+)" );
+    if ( maxAge.indexIn( reply->rawHeader( "Cache-Control" ) ) != -1 )
+        freshness = maxAge.cap( 1 ).toInt();
+
+    return QDateTime::currentDateTime().toUTC().addSecs( freshness );
+}
+
+unicorn::ImageReply*
+unicorn::ImageCache::get( const QUrl& url )
+{
+    ImageReply* reply = new ImageReply( url, this );
+
+    if ( url.isEmpty() || !url.isValid() )
+    {
+        reply->finish( QByteArray() );
+        return reply;
+    }
+
+    QString const key = ImageCache::key( url );
+
+    if ( QByteArray* data = m_memory.object( key ) )
+    {
+        ++m_memoryHits;
+        reply->finish( *data );
+        emit statsChanged();
+        return reply;
+    }
+
+    if ( m_waiting.contains( key ) )
+    {
+        ++m_coalesced;
+        m_waiting[key] << reply;
+        emit statsChanged();
+        return reply;
+    }
+
+    Entry entry;
+    bool const cached = readEntry( key, entry );
+
+    if ( cached && entry.expires > QDateTime::currentDateTime().toUTC() )
+    {
+        ++m_diskHits;
+
+        // rewriting the meta file marks the image as recently used
+        writeMeta( key, entry );
+        m_memory.insert( key, new QByteArray( entry.data ), entry.data.size() );
+
+        reply->finish( entry.data );
+        emit statsChanged();
+        return reply;
+    }
+
+    m_waiting[key] << reply;
+    fetch( url, key, entry );
+
+    return reply;
+}
+
+void
+unicorn::ImageCache::fetch( const QUrl& url, const QString& key, const Entry& stale )
+{
+    QNetworkRequest request( url );
+
+    if ( !stale.etag.isEmpty() )
+        request.setRawHeader( "If-None-Match", stale.etag );
+    if ( !stale.lastModified.isEmpty() )
+        request.setRawHeader( "If-Modified-Since", stale.lastModified );
+
+    QNetworkReply* reply = lastfm::nam()->get( request );
+    m_fetches[reply] = key;
+    connect( reply, SIGNAL(finished()), SLOT(onFetched()) );
+}
+
+void
+unicorn::ImageCache::onFetched()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>( sender() );
+    reply->deleteLater();
+
+    QString const key = m_fetches.take( reply );
+    int const status = reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+
+    Entry entry;
+
+    if ( reply->error() == QNetworkReply::NoError && status == 304 && readEntry( key, entry ) )
+    {
+        ++m_revalidated;
+
+        if ( reply->hasRawHeader( "ETag" ) )
+            entry.etag = reply->rawHeader( "ETag" );
+        if ( reply->hasRawHeader( "Last-Modified" ) )
+            entry.lastModified = reply->rawHeader( "Last-Modified" );
+        entry.expires = expires( reply );
+
+        writeMeta( key, entry );
+    }
+    else if ( reply->error() == QNetworkReply::NoError && status != 304 )
+    {
+        ++m_misses;
+
+        entry.data = reply->readAll();
+        entry.etag = reply->rawHeader( "ETag" );
+        entry.lastModified = reply->rawHeader( "Last-Modified" );
+        entry.expires = expires( reply );
+
+        if ( !entry.data.isEmpty() )
+            writeEntry( key, entry );
+    }
+    else
+    {
+        qWarning() << "Couldn't fetch" << reply->url() << reply->errorString();
+
+        // an out of date image is better than no image
+        if ( !readEntry( key, entry ) )
+            ++m_misses;
+    }
+
+    if ( !entry.data.isEmpty() )
+        m_memory.insert( key, new QByteArray( entry.data ), entry.data.size() );
+
+    deliver( key, entry.data );
+    emit statsChanged();
+}
+
+void
+unicorn::ImageCache::deliver( const QString& key, const QByteArray& data )
+{
+    foreach ( const QPointer<ImageReply>& reply, m_waiting.take( key ) )
+        if ( reply )
+            reply->finish( data );
+}
+
+bool
+unicorn::ImageCache::readEntry( const QString& key, Entry& entry ) const
+{
+    QFile meta( m_dir.filePath( key + ".meta" ) );
+    QFile data( m_dir.filePath( key ) );
+
+    if ( !meta.open( QIODevice::ReadOnly ) || !data.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream stream( &meta );
+    qint32 version;
+    stream >> version;
+
+    if ( version != META_VERSION )
+        return false;
+
+    stream >> entry.etag >> entry.lastModified >> entry.expires;
+    entry.data = data.readAll();
+
+    return stream.status() == QDataStream::Ok && !entry.data.isEmpty();
+}
+
+void
+unicorn::ImageCache::writeMeta( const QString& key, const Entry& entry ) const
+{
+    QFile meta( m_dir.filePath( key + ".meta" ) );
+
+    if ( meta.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        QDataStream stream( &meta );
+        stream << qint32( META_VERSION ) << entry.etag << entry.lastModified << entry.expires;
+    }
+}
+
+void
+unicorn::ImageCache::writeEntry( const QString& key, const Entry& entry )
+{
+    QFile data( m_dir.filePath( key ) );
+
+    m_diskSize -= data.size();
+
+    if ( !data.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        qWarning() << "Couldn't cache image in" << data.fileName();
+        return;
+    }
+
+    m_diskSize += data.write( entry.data );
+    data.close();
+
+    // the meta file is written last so an image is never read half written
+    QString const metaPath = m_dir.filePath( key + ".meta" );
+    m_diskSize -= QFileInfo( metaPath ).size();
+    writeMeta( key, entry );
+    m_diskSize += QFileInfo( metaPath ).size();
+
+    trim();
+}
+
+/** Removes the least recently used images until we're well under the cap */
+void
+unicorn::ImageCache::trim()
+{
+    if ( m_diskSize <= m_maxDiskSize )
+        return;
+
+    qint64 const target = m_maxDiskSize - m_maxDiskSize / 10;
+
+    // the meta file is rewritten each time its image is used
+    QFileInfoList const metas = m_dir.entryInfoList( QStringList() << "*.meta", QDir::Files, QDir::Time | QDir::Reversed );
+
+    foreach ( const QFileInfo& meta, metas )
+    {
+        if ( m_diskSize <= target )
+            break;
+
+        QString const key = meta.completeBaseName();
+        QFileInfo const data( m_dir.filePath( key ) );
+
+        m_diskSize -= meta.size() + data.size();
+        QFile::remove( meta.filePath() );
+        QFile::remove( data.filePath() );
+    }
+}
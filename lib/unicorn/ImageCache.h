@@ -0,0 +1,148 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNICORN_IMAGE_CACHE_H
+#define UNICORN_IMAGE_CACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QUrl>
+
+#include "lib/DllExportMacro.h"
+
+class QNetworkReply;
+
+namespace unicorn
+{
+    /** What ImageCache::get() gives you. Use it like a QNetworkReply: it
+      * emits finished() once, never before get() has returned, and you
+      * deleteLater() it in your slot. Deleting it before then just means
+      * you aren't told, the fetch carries on for anyone else waiting. */
+    class UNICORN_DLLEXPORT ImageReply : public QObject
+    {
+        Q_OBJECT
+    public:
+        QUrl url() const { return m_url; }
+
+        /** the bytes of the image file, empty if we couldn't get them */
+        QByteArray data() const { return m_data; }
+        bool isError() const { return m_data.isEmpty(); }
+
+    signals:
+        void finished();
+
+    private:
+        friend class ImageCache;
+
+        ImageReply( const QUrl& url, QObject* parent );
+        void finish( const QByteArray& data );
+
+    private:
+        QUrl m_url;
+        QByteArray m_data;
+    };
+
+
+    /** The artwork and avatars we show, shared by everything that shows them.
+      *
+      * Images are kept in memory, least recently used going first, and on
+      * disk under the SHA-1 of their url with their ETag, Last-Modified and
+      * expiry alongside. A fresh disk copy is used as is, a stale one is
+      * revalidated with a conditional GET, and if that fails the stale copy
+      * is better than nothing. When the disk copies go over the size cap the
+      * least recently used are removed.
+      *
+      * Any number of gets for a url that is already being fetched wait on
+      * that one fetch.
+      */
+    class UNICORN_DLLEXPORT ImageCache : public QObject
+    {
+        Q_OBJECT
+    public:
+        ImageCache( const QString& path, qint64 maxDiskSize, QObject* parent = 0 );
+
+        /** the one the application uses, kept in the lastfm cache directory */
+        static ImageCache& instance();
+
+        ImageReply* get( const QUrl& url );
+
+        qint64 diskSize() const { return m_diskSize; }
+        qint64 maxDiskSize() const { return m_maxDiskSize; }
+        void setMaxDiskSize( qint64 maxDiskSize );
+
+        int memoryHits() const { return m_memoryHits; }
+        int diskHits() const { return m_diskHits; }
+        /** stale disk copies the server told us were still good */
+        int revalidated() const { return m_revalidated; }
+        /** gets that waited on a fetch someone else had started */
+        int coalesced() const { return m_coalesced; }
+        /** images that had to be downloaded, or couldn't be */
+        int misses() const { return m_misses; }
+
+    signals:
+        void statsChanged();
+
+    private slots:
+        void onFetched();
+
+    private:
+        struct Entry
+        {
+            QByteArray data;
+            QByteArray etag;
+            QByteArray lastModified;
+            QDateTime expires;
+        };
+
+        static QString key( const QUrl& url );
+        static QDateTime expires( QNetworkReply* reply );
+
+        bool readEntry( const QString& key, Entry& entry ) const;
+        void writeEntry( const QString& key, const Entry& entry );
+        void writeMeta( const QString& key, const Entry& entry ) const;
+        void trim();
+
+        void fetch( const QUrl& url, const QString& key, const Entry& stale );
+        void deliver( const QString& key, const QByteArray& data );
+
+    private:
+        QDir m_dir;
+        qint64 m_diskSize;
+        qint64 m_maxDiskSize;
+
+        QCache<QString, QByteArray> m_memory;
+
+        QHash<QNetworkReply*, QString> m_fetches;
+        QHash<QString, QList<QPointer<ImageReply> > > m_waiting;
+
+        int m_memoryHits;
+        int m_diskHits;
+        int m_revalidated;
+        int m_coalesced;
+        int m_misses;
+    };
+}
+
+#endif // UNICORN_IMAGE_CACHE_H
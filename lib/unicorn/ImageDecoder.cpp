@@ -0,0 +1,122 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QBuffer>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QtConcurrentRun>
+
+#include "ImageDecoder.h"
+
+unicorn::ImageDecoder::ImageDecoder( const QByteArray& data, const QSize& size, Scale scale, QObject* parent )
+    :QObject( parent ),
+     m_cancelled( new QAtomicInt( 0 ) )
+{
+    m_watcher = new QFutureWatcher<QImage>( this );
+    connect( m_watcher, SIGNAL(finished()), SLOT(onDecoded()) );
+    m_watcher->setFuture( QtConcurrent::run( &ImageDecoder::decode, data, size, scale, m_cancelled ) );
+}
+
+unicorn::ImageDecoder::~ImageDecoder()
+{
+    // the decode holds its own reference to the flag, so it can outlive us
+    m_cancelled->fetchAndStoreOrdered( 1 );
+}
+
+void
+unicorn::ImageDecoder::onDecoded()
+{
+    m_image = m_watcher->result();
+    emit finished();
+}
+
+QSize //static
+unicorn::ImageDecoder::scaledSize( const QSize& imageSize, const QSize& size, Scale scale )
+{
+    if ( imageSize.isEmpty() )
+        return imageSize;
+
+    switch ( scale )
+    {
+        case ScaleAuto:
+            if ( size.width() <= 0 || size.height() <= 0 )
+                break;
+
+            // relatively taller than the space, so fit the width and let the height overhang
+            if ( qint64( imageSize.height() ) * size.width() > qint64( size.height() ) * imageSize.width() )
+                return scaledSize( imageSize, size, ScaleWidth );
+            else
+                return scaledSize( imageSize, size, ScaleHeight );
+
+        case ScaleWidth:
+            if ( size.width() <= 0 )
+                break;
+
+            return QSize( size.width(), qMax( 1, qRound( qreal( imageSize.height() ) * size.width() / imageSize.width() ) ) );
+
+        case ScaleHeight:
+            if ( size.height() <= 0 )
+                break;
+
+            return QSize( qMax( 1, qRound( qreal( imageSize.width() ) * size.height() / imageSize.height() ) ), size.height() );
+
+        case ScaleNone:
+            break;
+    }
+
+    return imageSize;
+}
+
+/** Runs on the thread pool */
+QImage //static
+unicorn::ImageDecoder::decode( QByteArray data, QSize size, Scale scale, QSharedPointer<QAtomicInt> cancelled )
+{
+    // we were deleted while we waited for a thread
+    if ( *cancelled )
+        return QImage();
+
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::ReadOnly );
+    QImageReader reader( &buffer );
+
+    QSize target;
+
+    if ( reader.size().isValid() )
+    {
+        target = scaledSize( reader.size(), size, scale );
+
+        // JPEGs can be decoded straight to a smaller size, which is far quicker
+        if ( target != reader.size() && reader.supportsOption( QImageIOHandler::ScaledSize ) )
+            reader.setScaledSize( target );
+    }
+
+    QImage image = reader.read();
+
+    if ( image.isNull() || *cancelled )
+        return QImage();
+
+    if ( !target.isValid() )
+        target = scaledSize( image.size(), size, scale );
+
+    if ( image.size() != target )
+        image = image.scaled( target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+
+    // the formats QPixmap::fromImage can take without converting
+    return image.convertToFormat( image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32 );
+}
@@ -0,0 +1,83 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNICORN_IMAGE_DECODER_H
+#define UNICORN_IMAGE_DECODER_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSharedPointer>
+#include <QSize>
+
+#include "lib/DllExportMacro.h"
+
+namespace unicorn
+{
+    /** Decodes an image file's bytes, and scales the result, on the thread
+      * pool so a lot of images arriving at once don't stall the GUI.
+      *
+      * It starts as soon as it is made and emits finished() when the image
+      * is ready to draw. Delete it to cancel, a decode that hasn't started
+      * yet is skipped and one that has is thrown away.
+      */
+    class UNICORN_DLLEXPORT ImageDecoder : public QObject
+    {
+        Q_OBJECT
+    public:
+        enum Scale
+        {
+            ScaleNone,
+            ScaleAuto, // to whichever of width or height leaves no gaps
+            ScaleWidth,
+            ScaleHeight
+        };
+
+        ImageDecoder( const QByteArray& data, const QSize& size = QSize(), Scale scale = ScaleNone, QObject* parent = 0 );
+        ~ImageDecoder();
+
+        /** null if the data wasn't an image we can read */
+        QImage image() const { return m_image; }
+
+        /** only call this from the GUI thread */
+        QPixmap pixmap() const { return QPixmap::fromImage( m_image ); }
+
+        /** The size an image of the given size ends up at. Public so that
+          * everyone scaling images for us agrees. */
+        static QSize scaledSize( const QSize& imageSize, const QSize& size, Scale scale );
+
+    signals:
+        void finished();
+
+    private slots:
+        void onDecoded();
+
+    private:
+        static QImage decode( QByteArray data, QSize size, Scale scale, QSharedPointer<QAtomicInt> cancelled );
+
+    private:
+        QSharedPointer<QAtomicInt> m_cancelled;
+        QFutureWatcher<QImage>* m_watcher;
+        QImage m_image;
+    };
+}
+
+#endif // UNICORN_IMAGE_DECODER_H
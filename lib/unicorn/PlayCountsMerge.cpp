@@ -0,0 +1,150 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtAlgorithms>
+
+#include "PlayCountsMerge.h"
+
+namespace
+{
+    bool
+    idLessThan( const unicorn::PlayCountsMerge::PlayCount& a, const unicorn::PlayCountsMerge::PlayCount& b )
+    {
+        return a.id < b.id;
+    }
+}
+
+unicorn::PlayCountsMerge::PlayCountsMerge()
+    :m_sorted( true ), m_cursor( 0 ), m_lastId( 0 ), m_seeks( 0 ), m_probes( 0 )
+{
+}
+
+void
+unicorn::PlayCountsMerge::addPrevious( quint64 id, int playCount, uint lastPlayed )
+{
+    if ( !m_previous.isEmpty() && id < m_previous.last().id )
+        m_sorted = false;
+
+    PlayCount previous;
+    previous.id = id;
+    previous.playCount = playCount;
+    previous.lastPlayed = lastPlayed;
+    m_previous.append( previous );
+
+    m_cursor = 0;
+    m_lastId = 0;
+}
+
+void
+unicorn::PlayCountsMerge::sort()
+{
+    qStableSort( m_previous.begin(), m_previous.end(), idLessThan );
+    m_sorted = true;
+}
+
+/** The first index in [first, last) whose id isn't less than id, or last */
+int
+unicorn::PlayCountsMerge::lowerBound( int first, int last, quint64 id )
+{
+    const PlayCount* previous = m_previous.constData();
+
+    while ( first < last )
+    {
+        const int middle = first + ( last - first ) / 2;
+        ++m_probes;
+
+        if ( previous[middle].id < id )
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+const unicorn::PlayCountsMerge::PlayCount*
+unicorn::PlayCountsMerge::find( quint64 id )
+{
+    if ( !m_sorted )
+        sort();
+
+    const int n = m_previous.count();
+    const PlayCount* previous = m_previous.constData();
+
+    if ( id >= m_lastId )
+    {
+        // the merge, the ids usually come in order so the next one is close.
+        // Gallop to a window that has it so a jump costs O(log distance)
+        const int start = m_cursor;
+        int first = start;
+        int probe = start;
+        int step = 1;
+
+        while ( probe < n && previous[probe].id < id )
+        {
+            ++m_probes;
+            first = probe + 1;
+            probe = start + step;
+            step *= 2;
+        }
+
+        m_cursor = lowerBound( first, qMin( probe, n ), id );
+
+        if ( m_cursor - start > 2 )
+            ++m_seeks;
+    }
+    else
+    {
+        // everything from the cursor on is at least the last id
+        m_cursor = lowerBound( 0, m_cursor, id );
+        ++m_seeks;
+    }
+
+    m_lastId = id;
+
+    if ( m_cursor < n && previous[m_cursor].id == id )
+        return previous + m_cursor;
+
+    return 0;
+}
+
+bool //static
+unicorn::PlayCountsMerge::decodePersistentId( const QString& id, quint64* key )
+{
+    if ( id.length() != 16 )
+        return false;
+
+    quint64 k = 0;
+
+    for ( int i = 0; i < 16; ++i )
+    {
+        const ushort c = id.at( i ).unicode();
+        int digit;
+
+        if ( c >= '0' && c <= '9' ) digit = c - '0';
+        else if ( c >= 'A' && c <= 'F' ) digit = c - 'A' + 10;
+        else if ( c >= 'a' && c <= 'f' ) digit = c - 'a' + 10;
+        else return false;
+
+        k = ( k << 4 ) | digit;
+    }
+
+    *key = k;
+    return true;
+}
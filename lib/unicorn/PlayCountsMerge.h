@@ -0,0 +1,89 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PLAY_COUNTS_MERGE_H
+#define PLAY_COUNTS_MERGE_H
+
+#include "lib/DllExportMacro.h"
+
+#include <QString>
+#include <QVector>
+
+namespace unicorn
+{
+    /** The play counts a media library had at the last sync, kept sorted by
+      * a 64 bit id so the library's tracks can be merge-joined against them.
+      *
+      * Tracks looked up in ascending id order are found by galloping forward
+      * from the last one, probing 1, 2, 4... ahead and then binary searching
+      * that window, so a sorted library costs about one pass over both.
+      * Any other lookup is a search of O(log n), so an unsorted library
+      * costs O(n log n) rather than a walk per track.
+      *
+      * Used by twiddly's PlayCountsDatabase, keyed by iTunes persistent id,
+      * and the Linux iPod scrobbler, keyed by iPod track id.
+      */
+    class UNICORN_DLLEXPORT PlayCountsMerge
+    {
+    public:
+        struct PlayCount
+        {
+            quint64 id;
+            int playCount;
+            uint lastPlayed; // 0 if it isn't known
+        };
+
+        PlayCountsMerge();
+
+        void reserve( int count ) { m_previous.reserve( count ); }
+
+        /** Adding them in ascending id order saves a sort */
+        void addPrevious( quint64 id, int playCount, uint lastPlayed = 0 );
+
+        /** @returns the previous play count for id, or 0 if there wasn't one.
+          * The pointer is valid until the next addPrevious() */
+        const PlayCount* find( quint64 id );
+
+        int count() const { return m_previous.count(); }
+
+        /** how many finds weren't at or next to the last one, for
+          * diagnostics */
+        int seeks() const { return m_seeks; }
+
+        /** how many ids finds have compared, for diagnostics */
+        qint64 probes() const { return m_probes; }
+
+        /** iTunes persistent ids are 16 hex digits.
+          * @returns false if id isn't one */
+        static bool decodePersistentId( const QString& id, quint64* key );
+
+    private:
+        void sort();
+        int lowerBound( int first, int last, quint64 id );
+
+        QVector<PlayCount> m_previous;
+        bool m_sorted;
+
+        int m_cursor;
+        quint64 m_lastId;
+        int m_seeks;
+        qint64 m_probes;
+    };
+}
+
+#endif // PLAY_COUNTS_MERGE_H
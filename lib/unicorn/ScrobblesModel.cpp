@@ -26,11 +26,13 @@
 #include "ScrobblesModel.h"
 
 ScrobblesModel::Scrobble::Scrobble( const lastfm::Track track )
-    :m_track( track ), m_scrobblingEnabled( true )
+    :m_track( track ), m_scrobblingEnabled( true ), m_invalidity( lastfm::ScrobbleCache::TooShort )
 {
     bool ok;
     int count = m_track.extra( "playCount" ).toInt( &ok );
     m_originalPlayCount = ok ? count : 1;
+
+    m_valid = lastfm::ScrobbleCache::isValid( m_track, &m_invalidity );
 }
 
 lastfm::Track
@@ -124,6 +126,11 @@ ScrobblesModel::ScrobblesModel( QObject* parent )
 void
 ScrobblesModel::addTracks( const QList<lastfm::Track>& tracks )
 {
+    if ( tracks.isEmpty() )
+        return;
+
+    m_scrobbleList.reserve( m_scrobbleList.count() + tracks.count() );
+
     beginInsertRows( QModelIndex(), m_scrobbleList.count(), m_scrobbleList.count() + tracks.count() - 1 );
 
     foreach( lastfm::Track t, tracks )
@@ -167,17 +174,16 @@ ScrobblesModel::data( const QModelIndex& index, int role ) const
         return m_scrobbleList.at( index.row() ).attribute( index.column() );
     else if ( role == Qt::TextColorRole && !m_readOnly )
     {
-        if ( !lastfm::ScrobbleCache::isValid( m_scrobbleList.at( index.row() ).track() ) )
+        if ( !m_scrobbleList.at( index.row() ).isValid() )
             return QColor( Qt::red );
     }
     else if ( role == Qt::ToolTipRole && !m_readOnly )
     {
-        Scrobble s = m_scrobbleList.at( index.row() );
-        lastfm::ScrobbleCache::Invalidity invalidity;
+        const Scrobble& s = m_scrobbleList.at( index.row() );
 
-        if ( !lastfm::ScrobbleCache::isValid( s.track(), &invalidity ) )
+        if ( !s.isValid() )
         {
-            switch ( invalidity )
+            switch ( s.invalidity() )
             {
             case lastfm::ScrobbleCache::TooShort:
                 return tr( "This track is under 30 seconds" );
@@ -200,7 +206,7 @@ ScrobblesModel::data( const QModelIndex& index, int role ) const
     {
         if ( m_readOnly )
             return QVariant();
-        else if ( !lastfm::ScrobbleCache::isValid( m_scrobbleList.at( index.row() ).track() ) )
+        else if ( !m_scrobbleList.at( index.row() ).isValid() )
             return Qt::Unchecked;
         else
             return m_scrobbleList.at( index.row() ).isScrobblingEnabled() ? Qt::Checked : Qt::Unchecked;
@@ -281,3 +287,15 @@ ScrobblesModel::tracksToScrobble() const
 
     return tracks;
 }
+
+QList<lastfm::Track>
+ScrobblesModel::validTracksToScrobble() const
+{
+    QList<lastfm::Track> tracks;
+
+    for ( int i = 0 ; i < m_scrobbleList.count() ; i ++ )
+        if ( m_scrobbleList.at( i ).isScrobblingEnabled() && m_scrobbleList.at( i ).isValid() )
+            tracks.append( m_scrobbleList.at( i ).track() );
+
+    return tracks;
+}
@@ -24,6 +24,7 @@
 #include <QAbstractTableModel>
 #include <QStringList>
 
+#include <lastfm/ScrobbleCache.h>
 #include <lastfm/Track.h>
 
 #include "lib/DllExportMacro.h"
@@ -57,7 +58,10 @@ public:
     Qt::ItemFlags flags( const QModelIndex& index ) const;
     bool setData( const QModelIndex& index, const QVariant& value, int role );
 
+    /** the tracks that are ticked, valid or not */
     QList<lastfm::Track> tracksToScrobble() const;
+    /** the tracks that are ticked and that the scrobble cache will accept */
+    QList<lastfm::Track> validTracksToScrobble() const;
 
 private:
     class Scrobble
@@ -73,6 +77,11 @@ private:
         bool isLoved() const;
         bool isScrobblingEnabled() const;
 
+        /** as lastfm::ScrobbleCache::isValid, worked out once when the
+          * scrobble is added rather than every time a cell is painted */
+        bool isValid() const { return m_valid; }
+        lastfm::ScrobbleCache::Invalidity invalidity() const { return m_invalidity; }
+
         void setEnableScrobbling( bool allow );
 
         QVariant attribute( int index ) const;
@@ -85,6 +94,8 @@ private:
         lastfm::Track m_track;
         bool m_scrobblingEnabled;
         int m_originalPlayCount;
+        bool m_valid;
+        lastfm::ScrobbleCache::Invalidity m_invalidity;
     };
 
 private:
@@ -18,6 +18,8 @@
    along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "TrackImageFetcher.h"
+#include "ImageCache.h"
+#include "ImageDecoder.h"
 #include <lastfm/Track.h>
 #include <lastfm/ws.h>
 #include <lastfm/XmlQuery.h>
@@ -40,7 +42,7 @@ TrackImageFetcher::startAlbum()
         QUrl imageUrl = url( "album" );
 
         if ( imageUrl.isValid() )
-            connect( lastfm::nam()->get( QNetworkRequest( imageUrl ) ), SIGNAL(finished()), SLOT(onAlbumImageDownloaded()) );
+            connect( unicorn::ImageCache::instance().get( imageUrl ), SIGNAL(finished()), SLOT(onAlbumImageDownloaded()) );
         else
             connect( album().getInfo(), SIGNAL(finished()), SLOT(onAlbumGotInfo()) );
     }
@@ -54,7 +56,7 @@ TrackImageFetcher::startTrack()
     QUrl imageUrl = url( "track" );
 
     if ( imageUrl.isValid() )
-        connect( lastfm::nam()->get( QNetworkRequest( imageUrl ) ), SIGNAL(finished()), SLOT(onTrackImageDownloaded()) );
+        connect( unicorn::ImageCache::instance().get( imageUrl ), SIGNAL(finished()), SLOT(onTrackImageDownloaded()) );
     else
         trackGetInfo();
 }
@@ -66,7 +68,7 @@ TrackImageFetcher::startArtist()
     QUrl imageUrl = url( "artist" );
 
     if ( imageUrl.isValid() )
-        connect( lastfm::nam()->get( QNetworkRequest( imageUrl ) ), SIGNAL(finished()), SLOT(onArtistImageDownloaded()) );
+        connect( unicorn::ImageCache::instance().get( imageUrl ), SIGNAL(finished()), SLOT(onArtistImageDownloaded()) );
     else
         artistGetInfo();
 }
@@ -118,6 +120,7 @@ TrackImageFetcher::onTrackGotInfo( const QByteArray& data )
     else
     {
         qWarning() << lfm.parseError().message();
+        startArtist();
     }
 }
 
@@ -131,40 +134,46 @@ TrackImageFetcher::onArtistGotInfo()
 void
 TrackImageFetcher::onAlbumImageDownloaded()
 {
-    QPixmap i;
+    decodeImage( "album" );
+}
 
-    if ( i.loadFromData( qobject_cast<QNetworkReply*>(sender())->readAll() ) )
-        emit finished( i );
-    else
-        startTrack();
+void
+TrackImageFetcher::onTrackImageDownloaded()
+{
+    decodeImage( "track" );
+}
 
-    sender()->deleteLater(); //always deleteLater from slots connected to sender()
+void
+TrackImageFetcher::onArtistImageDownloaded()
+{
+    decodeImage( "artist" );
 }
 
 void
-TrackImageFetcher::onTrackImageDownloaded()
+TrackImageFetcher::decodeImage( const QString& root_node )
 {
-    QPixmap i;
+    m_decodingNode = root_node;
 
-    if ( i.loadFromData( qobject_cast<QNetworkReply*>(sender())->readAll() ) )
-        emit finished( i );
-    else
-        startArtist();
+    unicorn::ImageDecoder* decoder = new unicorn::ImageDecoder( qobject_cast<unicorn::ImageReply*>(sender())->data(), QSize(), unicorn::ImageDecoder::ScaleNone, this );
+    connect( decoder, SIGNAL(finished()), SLOT(onImageDecoded()) );
 
     sender()->deleteLater(); //always deleteLater from slots connected to sender()
 }
 
 void
-TrackImageFetcher::onArtistImageDownloaded()
+TrackImageFetcher::onImageDecoded()
 {
-    QPixmap i;
+    unicorn::ImageDecoder* decoder = qobject_cast<unicorn::ImageDecoder*>(sender());
+    decoder->deleteLater();
 
-    if ( i.loadFromData( qobject_cast<QNetworkReply*>(sender())->readAll() ) )
-        emit finished( i );
+    if ( !decoder->image().isNull() )
+        emit finished( decoder->pixmap() );
+    else if ( m_decodingNode == "album" )
+        startTrack();
+    else if ( m_decodingNode == "track" )
+        startArtist();
     else
         fail();
-    
-    sender()->deleteLater(); //always deleteLater from slots connected to sender()
 }
 
 
@@ -204,7 +213,7 @@ TrackImageFetcher::downloadImage( QNetworkReply* reply, const QString& root_node
 
     if ( imageUrl.isValid() )
     {
-        QNetworkReply* get = lastfm::nam()->get( QNetworkRequest( imageUrl ) );
+        unicorn::ImageReply* get = unicorn::ImageCache::instance().get( imageUrl );
 
         if ( root_node == "album" )
             connect( get, SIGNAL(finished()), SLOT(onAlbumImageDownloaded()) );
@@ -265,5 +274,5 @@ TrackImageFetcher::url( const QString& root_node )
 void
 TrackImageFetcher::fail()
 {
-    //emit finished( QPixmap() );
+    emit failed();
 }
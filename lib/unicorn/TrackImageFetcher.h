@@ -53,12 +53,15 @@ private:
     void artistGetInfo();
     void fail();
     bool downloadImage( QNetworkReply*, const QString& root_node_name );
+    void decodeImage( const QString& root_node_name );
     
     Album album() const { return m_track.album(); }
     Artist artist() const { return m_track.artist(); }
 
 signals:
     void finished( const class QPixmap& );
+    /** there is no album, track or artist image to be had */
+    void failed();
 
 private slots:
     void onAlbumGotInfo();
@@ -67,9 +70,11 @@ private slots:
     void onAlbumImageDownloaded();
     void onTrackImageDownloaded();
     void onArtistImageDownloaded();
+    void onImageDecoded();
 
 private:
     lastfm::Track::ImageSize m_size;
+    QString m_decodingNode;
 };
 
 #endif
@@ -141,6 +141,18 @@ unicorn::Settings::setCheckForUpdates( bool checkForUpdates )
     setValue( "checkForUpdates", checkForUpdates );
 }
 
+qint64
+unicorn::Settings::imageCacheSize() const
+{
+    return value( "imageCacheSize", 50 * 1024 * 1024 ).toLongLong();
+}
+
+void
+unicorn::Settings::setImageCacheSize( qint64 imageCacheSize )
+{
+    setValue( "imageCacheSize", imageCacheSize );
+}
+
 unicorn::AppSettings::AppSettings( QString appname )
     : QSettings( unicorn::organizationName(), appname.isEmpty() ? qApp->applicationName() : appname )
 {}
@@ -63,6 +63,10 @@ namespace unicorn
         bool checkForUpdates() const;
         void setCheckForUpdates( bool checkForUpdates );
 
+        /** the most the image cache keeps on disk, in bytes */
+        qint64 imageCacheSize() const;
+        void setImageCacheSize( qint64 imageCacheSize );
+
 
     private:
         void showWhere();
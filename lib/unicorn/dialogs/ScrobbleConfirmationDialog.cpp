@@ -24,16 +24,18 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QSortFilterProxyModel>
+#include <QStyleOptionViewItem>
 #include <QTableView>
 #include <QVBoxLayout>
 
-#include <lastfm/ScrobbleCache.h>
-
 #include "../ScrobblesModel.h"
 
 #include "ScrobbleConfirmationDialog.h"
 #include "ui_ScrobbleConfirmationDialog.h"
 
+// how many of the rows added at once we measure to size the columns
+#define COLUMN_SAMPLE_ROWS 200
+
 ScrobbleConfirmationDialog::ScrobbleConfirmationDialog( const QList<lastfm::Track>& tracks, QWidget* parent )
     : QDialog( parent ), ui( new Ui::ScrobbleConfirmationDialog )
 {
@@ -43,10 +45,13 @@ ScrobbleConfirmationDialog::ScrobbleConfirmationDialog( const QList<lastfm::Trac
 
     m_scrobblesModel = new ScrobblesModel( this );
     QSortFilterProxyModel* proxyModel = new QSortFilterProxyModel( this );
+    // added rows are slotted into place rather than the whole view resorted
+    proxyModel->setDynamicSortFilter( true );
     proxyModel->setSourceModel( m_scrobblesModel );
     ui->scrobblesView->setModel( proxyModel );
 
     ui->scrobblesView->sortByColumn( ScrobblesModel::TimeStamp, Qt::DescendingOrder );
+    ui->scrobblesView->horizontalHeader()->setResizeMode( QHeaderView::Interactive );
 
     ui->scrobblesView->hideColumn( ScrobblesModel::Loved );
     ui->scrobblesView->hideColumn( ScrobblesModel::Album );
@@ -94,15 +99,46 @@ ScrobbleConfirmationDialog::autoScrobble() const
 void
 ScrobbleConfirmationDialog::addTracks( const QList<lastfm::Track>& tracks )
 {
+    int const first = m_scrobblesModel->rowCount();
+
     m_scrobblesModel->addTracks( tracks );
 
-    // a hack to get the view to sort for the added tracks
-    ui->scrobblesView->setSortingEnabled( false );
-    ui->scrobblesView->setSortingEnabled( true );
+    resizeColumns( first, m_scrobblesModel->rowCount() - 1 );
+}
 
-    ui->scrobblesView->horizontalHeader()->setResizeMode( QHeaderView::Interactive );
+/** Widens the columns to fit the rows first to last. resizeColumnsToContents()
+  * measures every cell, so we measure an even spread of at most
+  * COLUMN_SAMPLE_ROWS of them instead. */
+void
+ScrobbleConfirmationDialog::resizeColumns( int first, int last )
+{
+    if ( last < first )
+        return;
+
+    QTableView* view = ui->scrobblesView;
+    QHeaderView* header = view->horizontalHeader();
 
-    ui->scrobblesView->resizeColumnsToContents();
+    QStyleOptionViewItem option;
+    option.initFrom( view );
+
+    int const step = qMax( 1, ( last - first + 1 ) / COLUMN_SAMPLE_ROWS );
+
+    for ( int column = 0 ; column < m_scrobblesModel->columnCount() ; ++column )
+    {
+        if ( view->isColumnHidden( column ) )
+            continue;
+
+        // the first tracks set the widths, later ones can only widen them
+        int width = first == 0 ? header->sectionSizeHint( column ) : view->columnWidth( column );
+
+        for ( int row = first ; row <= last ; row += step )
+        {
+            QModelIndex const index = m_scrobblesModel->index( row, column );
+            width = qMax( width, view->itemDelegate( index )->sizeHint( option, index ).width() );
+        }
+
+        view->setColumnWidth( column, width );
+    }
 }
 
 void
@@ -120,13 +156,7 @@ ScrobbleConfirmationDialog::files() const
 QList<lastfm::Track>
 ScrobbleConfirmationDialog::tracksToScrobble() const
 {
-    QList<lastfm::Track> validTracks;
-
-    foreach ( lastfm::Track track, m_scrobblesModel->tracksToScrobble() )
-        if ( lastfm::ScrobbleCache::isValid( track ) )
-            validTracks << track;
-
-    return validTracks;
+    return m_scrobblesModel->validTracksToScrobble();
 }
 
 void
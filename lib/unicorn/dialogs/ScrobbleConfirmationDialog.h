@@ -52,6 +52,9 @@ public:
 private slots:
     void toggleSelection();
 
+private:
+    void resizeColumns( int first, int last );
+
 private:
     Ui::ScrobbleConfirmationDialog* ui;
 
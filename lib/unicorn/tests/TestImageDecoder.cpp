@@ -0,0 +1,281 @@
+/*
+   Copyright 2012 Last.fm Ltd.
+
+   This file is part of the Last.fm Desktop Application Suite.
+
+   lastfm-desktop is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   lastfm-desktop is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with lastfm-desktop.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QImageWriter>
+#include <QPainter>
+#include <QThreadPool>
+
+#include "ImageDecoder.h"
+
+using unicorn::ImageDecoder;
+
+#define AVATAR_SIZE 64
+
+
+/** An image file of the given size, a gradient so it compresses like a
+  * photo rather than like a flat colour */
+static QByteArray
+imageFile( const QSize& size, int seed = 0, const char* format = "PNG" )
+{
+    QImage image( size, QImage::Format_RGB32 );
+
+    {
+        QPainter p( &image );
+        QLinearGradient gradient( 0, 0, size.width(), size.height() );
+        gradient.setColorAt( 0, QColor::fromHsv( seed * 7 % 360, 200, 250 ) );
+        gradient.setColorAt( 1, QColor::fromHsv( seed * 13 % 360, 255, 80 ) );
+        p.fillRect( image.rect(), gradient );
+        p.drawEllipse( image.rect().adjusted( seed % 20, seed % 30, -10, -10 ) );
+    }
+
+    QByteArray data;
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::WriteOnly );
+    image.save( &buffer, format );
+
+    return data;
+}
+
+
+/** Takes a friends list worth of avatars that all arrive in the same event
+  * loop iteration, as they do when they come out of the image cache, and
+  * measures the longest the event loop goes without a frame */
+class AvatarList : public QObject
+{
+    Q_OBJECT
+public:
+    AvatarList( const QList<QByteArray>& avatars, bool decoder )
+        :m_avatars( avatars ), m_decoder( decoder ), m_shown( 0 ), m_worstFrame( 0 )
+    {
+        m_frames.setInterval( 16 );
+        connect( &m_frames, SIGNAL(timeout()), SLOT(onFrame()) );
+    }
+
+    void run()
+    {
+        m_timer.start();
+        m_lastFrame.start();
+        m_frames.start();
+
+        for ( int i = 0 ; i < m_avatars.count() ; ++i )
+            QMetaObject::invokeMethod( this, "onAvatarLoaded", Qt::QueuedConnection, Q_ARG( int, i ) );
+
+        while ( m_shown < m_avatars.count() && m_timer.elapsed() < 60000 )
+            QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents );
+
+        m_elapsed = m_timer.elapsed();
+        m_frames.stop();
+        onFrame();
+    }
+
+    int shown() const { return m_shown; }
+    qint64 elapsed() const { return m_elapsed; }
+    qint64 worstFrame() const { return m_worstFrame; }
+
+private slots:
+    void onAvatarLoaded( int i )
+    {
+        if ( m_decoder )
+        {
+            ImageDecoder* decoder = new ImageDecoder( m_avatars[i], QSize( AVATAR_SIZE, AVATAR_SIZE ), ImageDecoder::ScaleAuto, this );
+            connect( decoder, SIGNAL(finished()), SLOT(onAvatarDecoded()) );
+        }
+        else
+        {
+            // what HttpImageWidget used to do
+            QPixmap px;
+            if ( px.loadFromData( m_avatars[i] ) )
+                show( px.scaledToWidth( AVATAR_SIZE, Qt::SmoothTransformation ) );
+        }
+    }
+
+    void onAvatarDecoded()
+    {
+        ImageDecoder* decoder = static_cast<ImageDecoder*>( sender() );
+        decoder->deleteLater();
+        show( decoder->pixmap() );
+    }
+
+    void onFrame()
+    {
+        m_worstFrame = qMax( m_worstFrame, m_lastFrame.restart() );
+    }
+
+private:
+    void show( const QPixmap& pixmap )
+    {
+        if ( !pixmap.isNull() )
+            ++m_shown;
+    }
+
+private:
+    QList<QByteArray> m_avatars;
+    bool m_decoder;
+    int m_shown;
+
+    QTimer m_frames;
+    QElapsedTimer m_timer;
+    QElapsedTimer m_lastFrame;
+    qint64 m_elapsed;
+    qint64 m_worstFrame;
+};
+
+
+class TestImageDecoder : public QObject
+{
+    Q_OBJECT
+
+    static QImage decode( const QByteArray& data, const QSize& size = QSize(), ImageDecoder::Scale scale = ImageDecoder::ScaleNone )
+    {
+        ImageDecoder decoder( data, size, scale );
+        QSignalSpy spy( &decoder, SIGNAL(finished()) );
+
+        QElapsedTimer timer;
+        timer.start();
+
+        while ( spy.isEmpty() && timer.elapsed() < 10000 )
+            QTest::qWait( 10 );
+
+        return decoder.image();
+    }
+
+private slots:
+    void testScaledSize_data();
+    void testScaledSize();
+    void testDecodesAndScales();
+    void testBrokenData();
+    void testCancel();
+
+    void benchmarkFriendAvatars_data();
+    void benchmarkFriendAvatars();
+};
+
+
+void
+TestImageDecoder::testScaledSize_data()
+{
+    QTest::addColumn<QSize>( "image" );
+    QTest::addColumn<QSize>( "size" );
+    QTest::addColumn<int>( "scale" );
+    QTest::addColumn<QSize>( "expected" );
+
+    QTest::newRow( "none" ) << QSize( 300, 200 ) << QSize( 64, 64 ) << int( ImageDecoder::ScaleNone ) << QSize( 300, 200 );
+    QTest::newRow( "width" ) << QSize( 300, 200 ) << QSize( 150, 10 ) << int( ImageDecoder::ScaleWidth ) << QSize( 150, 100 );
+    QTest::newRow( "height" ) << QSize( 300, 200 ) << QSize( 10, 50 ) << int( ImageDecoder::ScaleHeight ) << QSize( 75, 50 );
+    QTest::newRow( "auto wide" ) << QSize( 300, 200 ) << QSize( 64, 64 ) << int( ImageDecoder::ScaleAuto ) << QSize( 96, 64 );
+    QTest::newRow( "auto tall" ) << QSize( 200, 300 ) << QSize( 64, 64 ) << int( ImageDecoder::ScaleAuto ) << QSize( 64, 96 );
+    QTest::newRow( "no space" ) << QSize( 300, 200 ) << QSize( 0, 0 ) << int( ImageDecoder::ScaleAuto ) << QSize( 300, 200 );
+}
+
+void
+TestImageDecoder::testScaledSize()
+{
+    QFETCH( QSize, image );
+    QFETCH( QSize, size );
+    QFETCH( int, scale );
+    QFETCH( QSize, expected );
+
+    QCOMPARE( ImageDecoder::scaledSize( image, size, ImageDecoder::Scale( scale ) ), expected );
+}
+
+void
+TestImageDecoder::testDecodesAndScales()
+{
+    QByteArray const data = imageFile( QSize( 400, 300 ) );
+
+    QCOMPARE( decode( data ).size(), QSize( 400, 300 ) );
+    QCOMPARE( decode( data, QSize( 100, 100 ), ImageDecoder::ScaleWidth ).size(), QSize( 100, 75 ) );
+    QCOMPARE( decode( data, QSize( 100, 100 ), ImageDecoder::ScaleAuto ).size(), QSize( 133, 100 ) );
+}
+
+void
+TestImageDecoder::testBrokenData()
+{
+    QVERIFY( decode( "not an image" ).isNull() );
+    QVERIFY( decode( imageFile( QSize( 100, 100 ) ).left( 40 ) ).isNull() );
+}
+
+void
+TestImageDecoder::testCancel()
+{
+    QByteArray const data = imageFile( QSize( 1000, 1000 ) );
+    QList<ImageDecoder*> decoders;
+    QSignalSpy* spies[100];
+
+    for ( int i = 0 ; i < 100 ; ++i )
+    {
+        decoders << new ImageDecoder( data, QSize( 64, 64 ), ImageDecoder::ScaleAuto );
+        spies[i] = new QSignalSpy( decoders.last(), SIGNAL(finished()) );
+    }
+
+    qDeleteAll( decoders );
+
+    // the decodes still queued are skipped and nothing is told about any of them
+    QThreadPool::globalInstance()->waitForDone();
+    QTest::qWait( 50 );
+
+    for ( int i = 0 ; i < 100 ; ++i )
+    {
+        QCOMPARE( spies[i]->count(), 0 );
+        delete spies[i];
+    }
+}
+
+
+void
+TestImageDecoder::benchmarkFriendAvatars_data()
+{
+    QTest::addColumn<bool>( "decoder" );
+
+    QTest::newRow( "GUI thread" ) << false;
+    QTest::newRow( "ImageDecoder" ) << true;
+}
+
+/** Shows 500 friends' avatars, decoded either on the GUI thread as they used
+  * to be or with ImageDecoder, and reports the worst frame time */
+void
+TestImageDecoder::benchmarkFriendAvatars()
+{
+    QFETCH( bool, decoder );
+
+    // avatars are mostly JPEGs, which have their own fast path
+    const char* format = QImageWriter::supportedImageFormats().contains( "jpeg" ) ? "JPEG" : "PNG";
+
+    QList<QByteArray> avatars;
+    for ( int i = 0 ; i < 500 ; ++i )
+        avatars << imageFile( QSize( 300, 300 ), i, format );
+
+    AvatarList list( avatars, decoder );
+
+    QBENCHMARK_ONCE
+    {
+        list.run();
+    }
+
+    qDebug() << list.shown() << format << "avatars in" << list.elapsed() << "ms, worst frame" << list.worstFrame() << "ms";
+
+    QCOMPARE( list.shown(), avatars.count() );
+}
+
+
+QTEST_MAIN( TestImageDecoder )
+#include "TestImageDecoder.moc"
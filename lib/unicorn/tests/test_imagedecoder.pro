@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = test_imagedecoder
+QT = core gui testlib
+CONFIG -= app_bundle
+INCLUDEPATH += ..
+include( ../../../admin/include.qmake )
+
+DEFINES += _UNICORN_DLLEXPORT
+SOURCES = TestImageDecoder.cpp \
+          ../ImageDecoder.cpp
+HEADERS = ../ImageDecoder.h
@@ -50,7 +50,10 @@ SOURCES += \
     UnicornCoreApplication.cpp \
     UnicornApplication.cpp \
     TrackImageFetcher.cpp \
+    ImageCache.cpp \
+    ImageDecoder.cpp \
     ScrobblesModel.cpp \
+    PlayCountsMerge.cpp \
     qtwin.cpp \
     qtsingleapplication/qtsinglecoreapplication.cpp \
     qtsingleapplication/qtsingleapplication.cpp \
@@ -108,8 +111,11 @@ HEADERS += \
     UnicornCoreApplication.h \
     UnicornApplication.h \
     TrackImageFetcher.h \
+    ImageCache.h \
+    ImageDecoder.h \
     SignalBlocker.h \
     ScrobblesModel.h \
+    PlayCountsMerge.h \
     qtwin.h \
     qtsingleapplication/qtsinglecoreapplication.h \
     qtsingleapplication/qtsingleapplication.h \
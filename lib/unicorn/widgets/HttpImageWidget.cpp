@@ -22,6 +22,7 @@
 #include "HttpImageWidget.h"
 
 #include "lib/unicorn/DesktopServices.h"
+#include "lib/unicorn/ImageCache.h"
 
 HttpImageWidget::HttpImageWidget( QWidget* parent )
     :QLabel( parent ), m_mouseDown( false )
@@ -34,7 +35,12 @@ void
 HttpImageWidget::loadUrl( const QUrl& url, ScaleType scale )
 {
     m_scale = scale;
-    connect( lastfm::nam()->get(QNetworkRequest(url)), SIGNAL(finished()), SLOT(onUrlLoaded()));
+
+    // only the last url we were given should end up on show
+    delete m_reply;
+    delete m_decoder;
+    m_reply = unicorn::ImageCache::instance().get( url );
+    connect( m_reply, SIGNAL(finished()), SLOT(onUrlLoaded()));
 }
 
 void HttpImageWidget::setHref( const QUrl& url )
@@ -79,39 +85,30 @@ void HttpImageWidget::onClick()
 
 void HttpImageWidget::onUrlLoaded()
 {
-    QNetworkReply* reply = static_cast<QNetworkReply*>(sender());
+    unicorn::ImageReply* reply = static_cast<unicorn::ImageReply*>(sender());
     reply->deleteLater();
 
-    if ( reply->error() == QNetworkReply::NoError )
+    if ( reply->isError() )
     {
-        QPixmap px;
-        if ( px.loadFromData( reply->readAll() ) )
-        {
-            switch ( m_scale )
-            {
-            case ScaleAuto:
-                // Decide which way to scale based on the ratio of height to width
-                // of the image and the area that the image is going to be drawn to
-                if ( (px.height() * 1000) / px.width() > (height() * 1000) / width() )
-                    px = px.scaledToWidth( contentsRect().width(), Qt::SmoothTransformation );
-                else
-                    px = px.scaledToHeight( contentsRect().height(), Qt::SmoothTransformation );
-
-                break;
-            case ScaleNone:
-                break;
-            case ScaleWidth:
-                px = px.scaledToWidth( contentsRect().width(), Qt::SmoothTransformation );
-                break;
-            case ScaleHeight:
-                px = px.scaledToHeight( contentsRect().height(), Qt::SmoothTransformation );
-                break;
-            }
-
-            setPixmap( px );
-        }
+        emit loaded();
+        return;
     }
 
-    emit loaded();
+    // decoding and scaling a lot of avatars here would stall the GUI
+    m_decoder = new unicorn::ImageDecoder( reply->data(),
+                                           contentsRect().size(),
+                                           static_cast<unicorn::ImageDecoder::Scale>( m_scale ),
+                                           this );
+    connect( m_decoder, SIGNAL(finished()), SLOT(onImageDecoded()));
 }
 
+void HttpImageWidget::onImageDecoded()
+{
+    unicorn::ImageDecoder* decoder = static_cast<unicorn::ImageDecoder*>(sender());
+    decoder->deleteLater();
+
+    if ( !decoder->image().isNull() )
+        setPixmap( decoder->pixmap() );
+
+    emit loaded();
+}
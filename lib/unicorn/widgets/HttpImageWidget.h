@@ -26,20 +26,24 @@
 #include <QDesktopServices>
 #include <QPainter>
 #include <QMouseEvent>
+#include <QPointer>
 #include "lib/DllExportMacro.h"
+#include "lib/unicorn/ImageDecoder.h"
 
 #include <lastfm/ws.h>
 
+namespace unicorn { class ImageReply; }
+
 class UNICORN_DLLEXPORT HttpImageWidget : public QLabel
 {
     Q_OBJECT
 public:
     enum ScaleType
     {
-        ScaleNone,
-        ScaleAuto,
-        ScaleWidth,
-        ScaleHeight
+        ScaleNone = unicorn::ImageDecoder::ScaleNone,
+        ScaleAuto = unicorn::ImageDecoder::ScaleAuto,
+        ScaleWidth = unicorn::ImageDecoder::ScaleWidth,
+        ScaleHeight = unicorn::ImageDecoder::ScaleHeight
     };
 
     HttpImageWidget( QWidget* parent = 0 );
@@ -55,6 +59,7 @@ protected:
 private slots:
     void onClick();
     void onUrlLoaded();
+    void onImageDecoded();
 
 signals:
     void clicked();
@@ -64,6 +69,8 @@ private:
     bool m_mouseDown;
     ScaleType m_scale;
     QUrl m_href;
+    QPointer<unicorn::ImageReply> m_reply;
+    QPointer<unicorn::ImageDecoder> m_decoder;
 };
 
 #endif
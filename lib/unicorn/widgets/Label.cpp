@@ -124,10 +124,22 @@ unicorn::Label::anchor( const QString& url, const QString& text )
 void
 unicorn::Label::prettyTime( Label& timestampLabel, const QDateTime& timestamp, QTimer* callback )
 {
-    QDateTime now = QDateTime::currentDateTime();
+    int msecsUntilChange = 0;
 
     // Full time in the tool tip
     timestampLabel.setToolTip( timestamp.toString( Qt::DefaultLocaleLongDate ) );
+    timestampLabel.setText( prettyTime( timestamp, &msecsUntilChange ) );
+
+    if ( callback && msecsUntilChange > 0 )
+        callback->start( msecsUntilChange );
+}
+
+QString
+unicorn::Label::prettyTime( const QDateTime& timestamp, int* msecsUntilChange )
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QString text;
+    int msecs = 0;
 
     int secondsAgo = timestamp.secsTo( now );
 
@@ -135,30 +147,35 @@ unicorn::Label::prettyTime( Label& timestampLabel, const QDateTime& timestamp, Q
     {
         // Less than an hour ago
         int minutesAgo = ( timestamp.secsTo( now ) / 60 );
-        timestampLabel.setText( tr( "%n minute(s) ago", "", minutesAgo ) );
-        if ( callback ) callback->start( now.secsTo( timestamp.addSecs(((minutesAgo + 1 ) * 60 ) + 1 ) ) * 1000 );
+        text = tr( "%n minute(s) ago", "", minutesAgo );
+        msecs = now.secsTo( timestamp.addSecs(((minutesAgo + 1 ) * 60 ) + 1 ) ) * 1000;
     }
     else if ( secondsAgo < (60 * 60 * 6) || now.date() == timestamp.date() )
     {
         // Less than 6 hours ago or on the same date
         int hoursAgo = ( timestamp.secsTo( now ) / (60 * 60) );
-        timestampLabel.setText( tr( "%n hour(s) ago", "", hoursAgo ) );
-        if ( callback ) callback->start( now.secsTo( timestamp.addSecs( ( (hoursAgo + 1) * 60 * 60 ) + 1 ) ) * 1000 );
+        text = tr( "%n hour(s) ago", "", hoursAgo );
+        msecs = now.secsTo( timestamp.addSecs( ( (hoursAgo + 1) * 60 * 60 ) + 1 ) ) * 1000;
     }
     else if ( secondsAgo < (60 * 60 * 24 * 365) )
     {
         // less than a year ago
-        timestampLabel.setText( timestamp.toString( Qt::DefaultLocaleShortDate ) );
+        text = timestamp.toString( Qt::DefaultLocaleShortDate );
         // We don't need to set the timer because this date will never change (well, it might in a year's time)
     }
     else
     {
-        timestampLabel.setText( timestamp.toString( Qt::DefaultLocaleLongDate ) );
+        text = timestamp.toString( Qt::DefaultLocaleLongDate );
         // We don't need to set the timer because this date will never change
     }
 
     if ( secondsAgo < 0 )
-        timestampLabel.setText( tr( "Time is broken" ) ); // in the future!
+        text = tr( "Time is broken" ); // in the future!
+
+    if ( msecsUntilChange )
+        *msecsUntilChange = msecs;
+
+    return text;
 }
 
 QString
@@ -44,6 +44,8 @@ public:
 
     // Gives you a pretty time string and will call your slot when it's time to change it again
     static void prettyTime( Label& timestampLabel, const class QDateTime& timestamp, QTimer* callback = 0 );
+    // The same pretty time string, for things that paint it themselves
+    static QString prettyTime( const class QDateTime& timestamp, int* msecsUntilChange = 0 );
     static QString price( const QString& price, const QString& currency );
 
 private:
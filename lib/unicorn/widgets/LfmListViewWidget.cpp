@@ -27,6 +27,9 @@
 #include <lastfm/Artist.h>
 #include <lastfm/Track.h>
 
+#include "lib/unicorn/ImageCache.h"
+#include "lib/unicorn/ImageDecoder.h"
+
 #include <iostream>
 
 LfmDelegate::LfmDelegate( QAbstractItemView* parent ):QStyledItemDelegate(parent)
@@ -100,12 +103,21 @@ void LfmDelegate::setDefaultImage( QPixmap defaultImage )
 void
 LfmItem::onImageLoaded()
 {
-    QNetworkReply* reply = static_cast<QNetworkReply*>(sender());
+    unicorn::ImageReply* reply = static_cast<unicorn::ImageReply*>(sender());
     reply->deleteLater();
 
-    QPixmap px;
-    px.loadFromData( reply->readAll() );
-    m_icon = QIcon( px );
+    unicorn::ImageDecoder* decoder = new unicorn::ImageDecoder( reply->data(), QSize(), unicorn::ImageDecoder::ScaleNone, this );
+    connect( decoder, SIGNAL(finished()), SLOT(onImageDecoded()));
+}
+
+
+void
+LfmItem::onImageDecoded()
+{
+    unicorn::ImageDecoder* decoder = static_cast<unicorn::ImageDecoder*>(sender());
+    decoder->deleteLater();
+
+    m_icon = QIcon( decoder->pixmap() );
     emit updated();
 }
 
@@ -114,7 +126,7 @@ void LfmItem::loadImage( const QUrl& url )
 {
     QString imageUrl = url.toString();
    
-    QNetworkReply* reply = lastfm::nam()->get(QNetworkRequest( url ));
+    unicorn::ImageReply* reply = unicorn::ImageCache::instance().get( url );
     connect( reply, SIGNAL( finished()), this, SLOT( onImageLoaded()));
 }
 
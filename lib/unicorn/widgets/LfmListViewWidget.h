@@ -77,6 +77,7 @@ signals:
 
 protected slots:
     void onImageLoaded();
+    void onImageDecoded();
 };
 
 namespace lastfm {
@@ -29,6 +29,7 @@
 #include "UserMenu.h"
 
 #include "../UnicornSettings.h"
+#include "../ImageCache.h"
 
 using namespace lastfm;
 
@@ -58,20 +59,20 @@ UserToolButton::onSessionChanged( const unicorn::Session& /*session*/ )
 void 
 UserToolButton::onUserGotInfo( const User& user )
 {
-    connect( lastfm::nam()->get(QNetworkRequest( user.imageUrl( lastfm::User::MediumImage))), SIGNAL( finished()),
-                                                                          SLOT( onImageDownloaded()));
+    connect( unicorn::ImageCache::instance().get( user.imageUrl( lastfm::User::MediumImage ) ), SIGNAL( finished()),
+                                                                                    SLOT( onImageDownloaded()));
 }
 
 void 
 UserToolButton::onImageDownloaded()
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>( sender() );
+    unicorn::ImageReply* reply = qobject_cast<unicorn::ImageReply*>( sender() );
     Q_ASSERT( reply );
 
     reply->deleteLater();
 
     QPixmap pm;
-    if( !pm.loadFromData( reply->readAll()) )
+    if( !pm.loadFromData( reply->data()) )
         pm = QPixmap(":lastfm/default_user_small.png");
 
     QPixmap on( ":lastfm/profile_on.png" );